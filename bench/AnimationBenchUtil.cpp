@@ -0,0 +1,147 @@
+#include "AnimationBenchUtil.h"
+
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <numbers>
+#include <string>
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <Graphics/MipMapGenerator.h>
+#include <Graphics/Texture.h>
+#include <Graphics/UploadManager.h>
+#include <util/GltfLoader.h>
+
+#include <AnimationCache.h>
+#include <MaterialCache.h>
+#include <MeshCache.h>
+#include <SkeletonCache.h>
+#include <TextureCache.h>
+
+namespace bench
+{
+Scene loadModel(const std::filesystem::path& modelPath)
+{
+    const auto srcPath = std::filesystem::path{ASSETS_DIR} / modelPath;
+    const auto tmpDir = std::filesystem::temp_directory_path() / "webgpu_bench_assets";
+    std::filesystem::remove_all(tmpDir);
+    std::filesystem::create_directories(tmpDir);
+    std::filesystem::copy(srcPath.parent_path(), tmpDir, std::filesystem::copy_options::recursive);
+
+    // loadSceneData doesn't touch the GPU, so all GPU objects can be null
+    const wgpu::Device device;
+    const wgpu::Queue queue;
+    const wgpu::BindGroupLayout materialLayout;
+    const wgpu::Sampler sampler;
+    const std::shared_ptr<const Texture> whiteTexture;
+    MipMapGenerator mipMapGenerator;
+    UploadManager uploadManager;
+    MaterialCache materialCache;
+    TextureCache textureCache;
+    MeshCache meshCache;
+    SkeletonCache skeletonCache;
+    AnimationCache animationCache;
+
+    auto requiredLimits = wgpu::RequiredLimits{};
+    requiredLimits.limits.minStorageBufferOffsetAlignment = 256;
+
+    const auto ctx = util::LoadContext{
+        .device = device,
+        .queue = queue,
+        .materialLayout = materialLayout,
+        .nearestSampler = sampler,
+        .linearSampler = sampler,
+        .whiteTexture = whiteTexture,
+        .mipMapGenerator = mipMapGenerator,
+        .uploadManager = uploadManager,
+        .materialCache = materialCache,
+        .textureCache = textureCache,
+        .meshCache = meshCache,
+        .skeletonCache = skeletonCache,
+        .animationCache = animationCache,
+        .requiredLimits = requiredLimits,
+    };
+
+    util::SceneLoader loader;
+    util::SceneLoadData data;
+    loader.loadSceneData(ctx, data, tmpDir / srcPath.filename());
+    for (auto& skeleton : data.scene.skeletons) {
+        calculateJointDepths(skeleton);
+    }
+    return std::move(data.scene);
+}
+
+SyntheticRig makeSyntheticRig(std::size_t numJoints, float duration, float phase)
+{
+    assert(numJoints > 0 && numJoints < NULL_JOINT_ID);
+    static constexpr float FPS = 30.f;
+    static constexpr float TWO_PI = 2.f * std::numbers::pi_v<float>;
+
+    SyntheticRig rig;
+
+    auto& skeleton = rig.skeleton;
+    skeleton.parents.resize(numJoints);
+    skeleton.inverseBindMatrices.resize(numJoints, glm::mat4{1.f});
+    skeleton.joints.resize(numJoints);
+    skeleton.jointNames.resize(numJoints);
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        skeleton.parents[jointId] =
+            (jointId == 0) ? NULL_JOINT_ID : static_cast<JointId>((jointId - 1) / 3);
+        auto& joint = skeleton.joints[jointId];
+        joint.id = static_cast<JointId>(jointId);
+        joint.localTransform.position = glm::vec3{0.f, 0.1f, 0.f};
+        skeleton.jointNames[jointId] = "joint_" + std::to_string(jointId);
+    }
+    calculateJointDepths(skeleton);
+
+    const auto numKeys = static_cast<std::size_t>(std::round(duration * FPS)) + 1;
+    rig.rawTracks.resize(numJoints);
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        auto& tracks = rig.rawTracks[jointId];
+        // each joint swings around one of the axes with its own amplitude and phase
+        auto axis = glm::vec3{0.f};
+        axis[static_cast<int>(jointId % 3)] = 1.f;
+        const auto amplitude = 0.2f + 0.1f * static_cast<float>(jointId % 5);
+        const auto jointPhase = phase + 0.3f * static_cast<float>(jointId);
+
+        for (std::size_t key = 0; key < numKeys; ++key) {
+            const auto time = static_cast<float>(key) / FPS;
+            const auto angle = amplitude * std::sin(TWO_PI * time / duration + jointPhase);
+            tracks.rotationTimes.push_back(time);
+            tracks.rotations.push_back(glm::angleAxis(angle, axis));
+            // like most exported clips, constant translations are keyed every frame too
+            tracks.translationTimes.push_back(time);
+            if (jointId == 0) {
+                tracks.translations.push_back(glm::vec3{
+                    0.f, 0.05f * std::sin(2.f * TWO_PI * time / duration + phase), time});
+            } else {
+                tracks.translations.push_back(skeleton.joints[jointId].localTransform.position);
+            }
+        }
+    }
+
+    auto& animation = rig.animation;
+    animation.name = "synthetic";
+    animation.duration = static_cast<float>(numKeys - 1) / FPS;
+    animation.looped = true;
+    rig.compressionStats = compressAnimation(skeleton, rig.rawTracks, animation);
+
+    return rig;
+}
+
+std::size_t getClipSizeBytes(const SkeletalAnimation& animation)
+{
+    const auto getTrackSize = [](const auto& track) {
+        return track.times.size() * sizeof(float) + track.keys.size() * sizeof(track.keys[0]);
+    };
+
+    std::size_t size = 0;
+    for (const auto& tracks : animation.tracks) {
+        size += getTrackSize(tracks.translations) + getTrackSize(tracks.rotations) +
+                getTrackSize(tracks.scales);
+    }
+    return size;
+}
+
+} // end of namespace bench
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+#include <Graphics/AnimationCompression.h>
+#include <Graphics/Scene.h>
+#include <Graphics/SkeletalAnimation.h>
+#include <Graphics/Skeleton.h>
+
+namespace bench
+{
+// Loads skeletons and animations of a glTF model from the game's assets
+// (e.g. "models/cato.gltf"). The model's directory is copied to a temporary
+// one first, so that animations are always compressed from glTF (which prints
+// their compression stats) and cooked scenes aren't written into the source tree.
+// Skeletons' joint depths are calculated.
+Scene loadModel(const std::filesystem::path& modelPath);
+
+// Tree of joints (each joint has up to 3 children) with a looped clip which
+// rotates all of them and moves the root. Keys are at 30 FPS, phase shifts
+// the motion so that different clips can be made for the same skeleton.
+struct SyntheticRig {
+    Skeleton skeleton;
+    std::vector<RawAnimationTracks> rawTracks;
+    SkeletalAnimation animation;
+    AnimationCompressionStats compressionStats;
+};
+
+SyntheticRig makeSyntheticRig(std::size_t numJoints, float duration = 2.f, float phase = 0.f);
+
+// memory used by clip's key times and keys
+std::size_t getClipSizeBytes(const SkeletalAnimation& animation);
+
+} // end of namespace bench
@@ -0,0 +1,99 @@
+#include <Graphics/AnimationCompression.h>
+#include <Graphics/SkeletalAnimation.h>
+#include <Graphics/Skeleton.h>
+#include <Graphics/SkeletonAnimator.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "AnimationBenchUtil.h"
+#include "BenchUtil.h"
+
+// Reports compression ratio and max joint error of clips with different error
+// bounds and measures sampling (which decompresses keys) of many clips per frame.
+// Stats of Cato's clips are printed when they're loaded.
+int main()
+{
+    static constexpr std::size_t NUM_JOINTS = 60;
+    static constexpr std::size_t NUM_CLIPS = 32;
+    static constexpr float CLIP_DURATION = 4.f;
+
+    bench::loadModel("models/cato.gltf");
+
+    std::vector<bench::SyntheticRig> rigs;
+    rigs.reserve(NUM_CLIPS);
+    for (std::size_t i = 0; i < NUM_CLIPS; ++i) {
+        rigs.push_back(
+            bench::makeSyntheticRig(NUM_JOINTS, CLIP_DURATION, static_cast<float>(i) * 0.2f));
+    }
+
+    { // same clips compressed with different error bounds
+        struct Settings {
+            const char* name;
+            AnimationCompressionSettings settings;
+        };
+        const auto allSettings = std::vector<Settings>{
+            // keys are only quantized
+            {"no reduction",
+             {.maxTranslationError = 0.f, .maxRotationError = 0.f, .maxScaleError = 0.f}},
+            {"default", {}},
+            {"coarse",
+             {.maxTranslationError = 0.001f, .maxRotationError = 0.01f, .maxScaleError = 0.001f}},
+        };
+
+        std::printf(
+            "%zu clips, %zu joints, %.1f s at 30 FPS\n", NUM_CLIPS, NUM_JOINTS, CLIP_DURATION);
+        std::printf(
+            "%-12s %14s %18s %10s %20s\n",
+            "settings",
+            "raw (B)",
+            "compressed (B)",
+            "ratio",
+            "max joint error");
+        for (const auto& [name, settings] : allSettings) {
+            AnimationCompressionStats totalStats;
+            for (const auto& rig : rigs) {
+                SkeletalAnimation animation;
+                animation.duration = rig.animation.duration; // error is measured over it
+                const auto stats =
+                    compressAnimation(rig.skeleton, rig.rawTracks, animation, settings);
+                totalStats.rawSizeBytes += stats.rawSizeBytes;
+                totalStats.compressedSizeBytes += stats.compressedSizeBytes;
+                totalStats.maxJointError = std::max(totalStats.maxJointError, stats.maxJointError);
+            }
+            std::printf(
+                "%-12s %14zu %18zu %10.2f %20.6f\n",
+                name,
+                totalStats.rawSizeBytes,
+                totalStats.compressedSizeBytes,
+                totalStats.getRatio(),
+                totalStats.maxJointError);
+        }
+    }
+
+    { // many animators, each clip is played by several of them at different times
+        static constexpr std::size_t NUM_FRAMES = 200;
+        std::printf("\n%10s %16s %14s\n", "animators", "frame (ms)", "joint (ns)");
+        for (const std::size_t numAnimators : {32, 256, 1024}) {
+            std::vector<SkeletonAnimator> animators(numAnimators);
+            for (std::size_t i = 0; i < numAnimators; ++i) {
+                const auto& rig = rigs[i % NUM_CLIPS];
+                animators[i].setAnimation(rig.skeleton, rig.animation);
+                animators[i].setNormalizedProgress(
+                    static_cast<float>(i) / static_cast<float>(numAnimators));
+            }
+
+            const auto frameMs = bench::measureMs(NUM_FRAMES, [&]() {
+                for (std::size_t i = 0; i < numAnimators; ++i) {
+                    animators[i].update(rigs[i % NUM_CLIPS].skeleton, 1.f / 60.f);
+                }
+            });
+            std::printf(
+                "%10zu %16.3f %14.1f\n",
+                numAnimators,
+                frameMs,
+                frameMs * 1e6 / static_cast<double>(numAnimators * NUM_JOINTS));
+        }
+    }
+}
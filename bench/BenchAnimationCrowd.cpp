@@ -0,0 +1,220 @@
+#include <Graphics/SkeletalAnimation.h>
+#include <Graphics/Skeleton.h>
+#include <Graphics/SkeletonAnimator.h>
+#include <Jobs/JobSystem.h>
+#include <PoseCache.h>
+
+#include <atomic>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <glm/mat3x4.hpp>
+
+#include "AnimationBenchUtil.h"
+#include "BenchUtil.h"
+
+// Measures animation update of crowds of characters with the same skeleton,
+// done like in Game::updateAnimations: all characters are evaluated in a
+// parallelFor and their joint matrices are copied into one staging array.
+// With the pose cache, characters which play the clip at the same time share
+// one evaluated pose.
+namespace
+{
+struct Crowd {
+    const Skeleton& skeleton;
+    std::vector<SkeletonAnimator> animators;
+    std::vector<glm::mat3x4> jointMatrices; // all characters, like the GPU buffer
+};
+
+// numPhases > 0 - characters start at one of numPhases times
+Crowd makeCrowd(
+    const Skeleton& skeleton,
+    const SkeletalAnimation& animation,
+    std::size_t numCharacters,
+    std::size_t numPhases = 0)
+{
+    auto crowd = Crowd{
+        .skeleton = skeleton,
+        .animators = std::vector<SkeletonAnimator>(numCharacters),
+        .jointMatrices = std::vector<glm::mat3x4>(numCharacters * skeleton.joints.size()),
+    };
+
+    // characters don't move in sync
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> progressDist(0.f, 1.f);
+    for (std::size_t i = 0; i < numCharacters; ++i) {
+        auto& animator = crowd.animators[i];
+        animator.setAnimation(skeleton, animation);
+        animator.setNormalizedProgress(
+            numPhases > 0 ? static_cast<float>(i % numPhases) / static_cast<float>(numPhases) :
+                            progressDist(rng));
+    }
+    return crowd;
+}
+
+void updateCrowd(JobSystem& jobSystem, Crowd& crowd, float dt)
+{
+    const auto numJoints = crowd.skeleton.joints.size();
+    jobSystem.parallelFor(crowd.animators.size(), 4, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            auto& animator = crowd.animators[i];
+            animator.update(crowd.skeleton, dt);
+            std::memcpy(
+                crowd.jointMatrices.data() + i * numJoints,
+                animator.getJointMatrices().data(),
+                sizeof(glm::mat3x4) * numJoints);
+        }
+    });
+}
+
+// Returns the number of evaluated poses
+std::size_t updateCrowdWithPoseCache(
+    JobSystem& jobSystem,
+    PoseCache& poseCache,
+    std::vector<std::size_t>& poseOwners,
+    Crowd& crowd,
+    float dt)
+{
+    const auto numCharacters = crowd.animators.size();
+    poseCache.clear();
+    poseOwners.resize(numCharacters);
+    for (std::size_t i = 0; i < numCharacters; ++i) {
+        auto& animator = crowd.animators[i];
+        animator.advance(dt);
+        poseOwners[i] = poseCache.findOrAdd(
+            0,
+            *animator.getAnimation(),
+            animator.getProgress(),
+            SkeletonAnimator::ALL_JOINTS_DEPTH,
+            i);
+    }
+
+    const auto numJoints = crowd.skeleton.joints.size();
+    const auto copyJointMatrices = [&crowd, numJoints](std::size_t i, std::size_t poseOwner) {
+        std::memcpy(
+            crowd.jointMatrices.data() + i * numJoints,
+            crowd.animators[poseOwner].getJointMatrices().data(),
+            sizeof(glm::mat3x4) * numJoints);
+    };
+    // owners are evaluated first, so that others can copy from them
+    jobSystem.parallelFor(numCharacters, 4, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (poseOwners[i] == i) {
+                auto& animator = crowd.animators[i];
+                animator.evaluate(crowd.skeleton, poseCache.quantizeTime(animator.getProgress()));
+                copyJointMatrices(i, i);
+            }
+        }
+    });
+    jobSystem.parallelFor(numCharacters, 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            if (poseOwners[i] != i) {
+                copyJointMatrices(i, poseOwners[i]);
+            }
+        }
+    });
+    return poseCache.getStats().misses;
+}
+
+// Cost per character as the crowd grows: the crowd is split into groups which
+// play the clip in sync, so with the pose cache only one pose per group is evaluated
+void benchPoseCache(const Skeleton& skeleton, const SkeletalAnimation& animation)
+{
+    static constexpr std::size_t NUM_FRAMES = 50;
+    static constexpr std::size_t NUM_PHASES = 8;
+
+    JobSystem jobSystem;
+    jobSystem.init();
+
+    std::printf(
+        "cost per character (us), %zu threads, %zu groups in sync\n",
+        jobSystem.getNumThreads(),
+        NUM_PHASES);
+    std::printf(
+        "%10s %12s %12s %12s %10s\n", "characters", "no cache", "pose cache", "poses", "speedup");
+    for (const std::size_t numCharacters : {10, 50, 100, 250, 500, 1000}) {
+        auto crowd = makeCrowd(skeleton, animation, numCharacters, NUM_PHASES);
+        const auto noCacheMs = bench::measureMs(
+            NUM_FRAMES, [&]() { updateCrowd(jobSystem, crowd, 1.f / 60.f); });
+
+        PoseCache poseCache;
+        std::vector<std::size_t> poseOwners;
+        std::size_t numPoses = 0;
+        const auto poseCacheMs = bench::measureMs(NUM_FRAMES, [&]() {
+            numPoses =
+                updateCrowdWithPoseCache(jobSystem, poseCache, poseOwners, crowd, 1.f / 60.f);
+        });
+
+        const auto toUsPerCharacter = [numCharacters](double ms) {
+            return ms * 1000.0 / static_cast<double>(numCharacters);
+        };
+        std::printf(
+            "%10zu %12.3f %12.3f %12zu %10.2f\n",
+            numCharacters,
+            toUsPerCharacter(noCacheMs),
+            toUsPerCharacter(poseCacheMs),
+            numPoses,
+            noCacheMs / poseCacheMs);
+    }
+}
+
+void benchCrowdScaling(const Skeleton& skeleton, const SkeletalAnimation& animation)
+{
+    static constexpr std::size_t NUM_FRAMES = 50;
+
+    std::vector<std::size_t> numWorkersList{0};
+    const auto maxNumWorkers = JobSystem::getDefaultNumWorkers();
+    for (std::size_t numThreads = 2; numThreads <= maxNumWorkers; numThreads *= 2) {
+        numWorkersList.push_back(numThreads - 1);
+    }
+    if (maxNumWorkers > 0 && numWorkersList.back() != maxNumWorkers) {
+        numWorkersList.push_back(maxNumWorkers);
+    }
+
+    std::printf("frame time (ms) by number of threads (speedup)\n%10s", "characters");
+    for (const auto numWorkers : numWorkersList) {
+        std::printf(" %16zu", numWorkers + 1);
+    }
+    std::printf("\n");
+
+    for (const std::size_t numCharacters : {100, 250, 500, 1000}) {
+        auto crowd = makeCrowd(skeleton, animation, numCharacters);
+        std::printf("%10zu", numCharacters);
+        double singleThreadMs = 0.0;
+        for (const auto numWorkers : numWorkersList) {
+            JobSystem jobSystem;
+            jobSystem.init(numWorkers);
+            const auto frameMs = bench::measureMs(
+                NUM_FRAMES, [&]() { updateCrowd(jobSystem, crowd, 1.f / 60.f); });
+            if (numWorkers == 0) {
+                singleThreadMs = frameMs;
+            }
+            std::printf(" %8.3f (%4.1fx)", frameMs, singleThreadMs / frameMs);
+        }
+        std::printf("\n");
+    }
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    const auto cato = bench::loadModel("models/cato.gltf");
+    if (!cato.skeletons.empty() && cato.animations.contains("Run")) {
+        std::printf("Cato (Run), %zu joints\n", cato.skeletons[0].joints.size());
+        benchCrowdScaling(cato.skeletons[0], cato.animations.at("Run"));
+        std::printf("\n");
+        benchPoseCache(cato.skeletons[0], cato.animations.at("Run"));
+    } else {
+        std::printf("Cato's skeleton or its \"Run\" animation is missing\n");
+    }
+
+    const auto rig = bench::makeSyntheticRig(60);
+    std::printf("\nsynthetic, %zu joints\n", rig.skeleton.joints.size());
+    benchCrowdScaling(rig.skeleton, rig.animation);
+    std::printf("\n");
+    benchPoseCache(rig.skeleton, rig.animation);
+}
@@ -0,0 +1,86 @@
+#include <Graphics/SkeletalAnimation.h>
+#include <Graphics/Skeleton.h>
+#include <Graphics/SkeletonAnimator.h>
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "AnimationBenchUtil.h"
+#include "BenchUtil.h"
+
+// Measures keyframe sampling with cached key cursors (forward playback) and
+// with binary search (seeks), and memory used by clips and animators
+namespace
+{
+void benchSampling(const char* name, const Skeleton& skeleton, const SkeletalAnimation& animation)
+{
+    static constexpr std::size_t NUM_SAMPLES = 20'000;
+
+    SkeletonAnimator animator;
+    animator.setAnimation(skeleton, animation);
+
+    // cursors advance by at most one key per sample
+    const auto forwardMs = bench::measureMs(NUM_SAMPLES, [&]() {
+        animator.advance(1.f / 60.f);
+        animator.evaluate(skeleton, animator.getProgress());
+    });
+
+    // random times: cursors are useless, every track falls back to binary search
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> progressDist(0.f, 1.f);
+    std::vector<float> seekTimes(NUM_SAMPLES);
+    for (auto& t : seekTimes) {
+        t = progressDist(rng);
+    }
+    std::size_t seekIdx = 0;
+    const auto seekMs = bench::measureMs(NUM_SAMPLES, [&]() {
+        animator.setNormalizedProgress(seekTimes[seekIdx++ % NUM_SAMPLES]);
+        animator.evaluate(skeleton, animator.getProgress());
+    });
+
+    // before key times were kept, every track was resampled at 30 FPS and
+    // stored as uncompressed vec3/quat/vec3 keys (only constant tracks had fewer keys)
+    const auto numJoints = skeleton.joints.size();
+    const auto numDenseKeys = static_cast<std::size_t>(std::ceil(animation.duration * 30.f)) + 1;
+    const auto denseSizeBytes =
+        numJoints * numDenseKeys * (sizeof(glm::vec3) + sizeof(glm::quat) + sizeof(glm::vec3));
+
+    std::printf(
+        "%-14s %7zu %14.3f %12.3f %12zu %16zu %14zu\n",
+        name,
+        numJoints,
+        forwardMs * 1000.0,
+        seekMs * 1000.0,
+        bench::getClipSizeBytes(animation),
+        denseSizeBytes,
+        animator.getMemoryUsage());
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    const auto cato = bench::loadModel("models/cato.gltf");
+    const auto rig = bench::makeSyntheticRig(250);
+
+    std::printf(
+        "%-14s %7s %14s %12s %12s %16s %14s\n",
+        "clip",
+        "joints",
+        "forward (us)",
+        "seek (us)",
+        "clip (B)",
+        "dense 30fps (B)",
+        "animator (B)");
+    if (!cato.skeletons.empty()) {
+        for (const auto& [name, animation] : cato.animations) {
+            const auto clipName = "Cato " + name;
+            benchSampling(clipName.c_str(), cato.skeletons[0], animation);
+        }
+    } else {
+        std::printf("Cato's skeleton is missing\n");
+    }
+    benchSampling("synthetic", rig.skeleton, rig.animation);
+}
@@ -0,0 +1,151 @@
+#include <util/RadixSort.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "BenchUtil.h"
+
+// Compares radix sort of packed draw keys (see Game::sortDrawList) with the
+// comparator sort of draw command indices which it replaced
+namespace
+{
+// stand-in for GPUMesh: the old comparator read materialId through a reference
+// to a mesh, which is a big struct stored elsewhere
+struct Mesh {
+    std::size_t materialId;
+    std::array<std::byte, 112> otherData;
+};
+
+struct DrawCommand {
+    const Mesh& mesh;
+    std::uint32_t pipelineId;
+    std::size_t meshId;
+    std::size_t entityId;
+};
+
+// same layout as makeDrawSortKey in Game.cpp
+std::uint64_t makeDrawSortKey(
+    std::uint32_t pipelineId,
+    std::size_t materialId,
+    std::size_t meshId,
+    float normalizedDepth)
+{
+    static constexpr std::uint64_t ID_MASK = (1 << 20) - 1;
+    const auto depth = static_cast<std::uint64_t>(normalizedDepth * static_cast<float>(ID_MASK));
+    return (static_cast<std::uint64_t>(pipelineId) << 60) |
+           ((static_cast<std::uint64_t>(materialId) & ID_MASK) << 40) |
+           ((static_cast<std::uint64_t>(meshId) & ID_MASK) << 20) | depth;
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    static constexpr std::size_t NUM_MATERIALS = 64;
+    static constexpr std::size_t NUM_DRAWS_PER_MESH = 4;
+
+    std::printf(
+        "%8s %18s %14s %16s %10s\n",
+        "draws",
+        "comparator (ms)",
+        "radix (ms)",
+        "std::sort (ms)",
+        "speedup");
+
+    for (const std::size_t numDraws : {1'000, 10'000, 100'000}) {
+        std::mt19937 rng(42);
+
+        std::vector<Mesh> meshes(numDraws / NUM_DRAWS_PER_MESH);
+        std::uniform_int_distribution<std::size_t> materialDist(0, NUM_MATERIALS - 1);
+        for (auto& mesh : meshes) {
+            mesh.materialId = materialDist(rng);
+        }
+
+        // draw commands are generated in entity order, which is random
+        // relative to materials and meshes
+        std::vector<DrawCommand> drawCommands;
+        std::vector<util::SortKey> drawSortKeys;
+        drawCommands.reserve(numDraws);
+        drawSortKeys.reserve(numDraws);
+        std::uniform_int_distribution<std::size_t> meshDist(0, meshes.size() - 1);
+        std::uniform_real_distribution<float> depthDist(0.f, 1.f);
+        for (std::size_t i = 0; i < numDraws; ++i) {
+            const auto meshId = meshDist(rng);
+            const auto& mesh = meshes[meshId];
+            drawSortKeys.push_back(util::SortKey{
+                .key = makeDrawSortKey(0, mesh.materialId, meshId, depthDist(rng)),
+                .value = static_cast<std::uint32_t>(drawCommands.size()),
+            });
+            drawCommands.push_back(DrawCommand{
+                .mesh = mesh,
+                .pipelineId = 0,
+                .meshId = meshId,
+                .entityId = i,
+            });
+        }
+
+        const auto numIterations = 10'000'000 / numDraws;
+
+        std::vector<std::size_t> sortedDrawCommands;
+        const auto comparatorMs = bench::measureMs(numIterations, [&]() {
+            sortedDrawCommands.clear();
+            sortedDrawCommands.resize(drawCommands.size());
+            std::iota(sortedDrawCommands.begin(), sortedDrawCommands.end(), 0);
+            std::sort(
+                sortedDrawCommands.begin(),
+                sortedDrawCommands.end(),
+                [&drawCommands](const auto& i1, const auto& i2) {
+                    const auto& dc1 = drawCommands[i1];
+                    const auto& dc2 = drawCommands[i2];
+                    if (dc1.mesh.materialId == dc2.mesh.materialId) {
+                        return dc1.meshId < dc2.meshId;
+                    }
+                    return dc1.mesh.materialId < dc2.mesh.materialId;
+                });
+        });
+
+        // keys are sorted in place, so each iteration sorts a fresh copy
+        std::vector<util::SortKey> keys;
+        std::vector<util::SortKey> tmp;
+        const auto radixMs = bench::measureMs(numIterations, [&]() {
+            keys = drawSortKeys;
+            util::radixSort(keys, tmp);
+        });
+
+        const auto stdSortMs = bench::measureMs(numIterations, [&]() {
+            keys = drawSortKeys;
+            std::sort(keys.begin(), keys.end(), [](const auto& k1, const auto& k2) {
+                return k1.key < k2.key;
+            });
+        });
+
+        // both sorts group draws by material, then by mesh
+        const auto isSortedByMaterial = [&](auto getDrawCommandIdx, const auto& sorted) {
+            return std::is_sorted(sorted.begin(), sorted.end(), [&](const auto& a, const auto& b) {
+                return drawCommands[getDrawCommandIdx(a)].mesh.materialId <
+                       drawCommands[getDrawCommandIdx(b)].mesh.materialId;
+            });
+        };
+        keys = drawSortKeys;
+        util::radixSort(keys, tmp);
+        if (!isSortedByMaterial([](std::size_t i) { return i; }, sortedDrawCommands) ||
+            !isSortedByMaterial([](const util::SortKey& k) { return k.value; }, keys)) {
+            std::printf("draws are not sorted by material\n");
+            return 1;
+        }
+
+        std::printf(
+            "%8zu %18.4f %14.4f %16.4f %10.2f\n",
+            numDraws,
+            comparatorMs,
+            radixMs,
+            stdSortMs,
+            comparatorMs / radixMs);
+    }
+}
@@ -0,0 +1,139 @@
+#include <Jobs/ImageDecodePool.h>
+#include <util/ImageLoader.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+
+namespace
+{
+std::vector<std::filesystem::path> findImages(const std::filesystem::path& dir)
+{
+    std::vector<std::filesystem::path> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        const auto ext = entry.path().extension();
+        if (ext == ".png" || ext == ".jpg") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+void benchDecode(const char* name, const std::vector<std::filesystem::path>& paths)
+{
+    std::size_t numPixelBytes = 0;
+    const auto serialMs = bench::measureMs(2, [&paths, &numPixelBytes]() {
+        numPixelBytes = 0;
+        for (const auto& path : paths) {
+            const auto image = util::loadImage(path);
+            numPixelBytes += static_cast<std::size_t>(image.width) * image.height * 4;
+        }
+    });
+
+    std::printf(
+        "%s: %zu images, %.1f MB of pixels, serial %.1f ms\n",
+        name,
+        paths.size(),
+        static_cast<double>(numPixelBytes) / (1024.0 * 1024.0),
+        serialMs);
+
+    const auto maxNumThreads =
+        std::max(std::size_t{2}, std::size_t{std::thread::hardware_concurrency()});
+    for (std::size_t numThreads = 1; numThreads <= maxNumThreads; numThreads *= 2) {
+        ImageDecodePool pool;
+        pool.init(numThreads, 256 * 1024 * 1024);
+        std::atomic<std::size_t> numDecoded{0};
+        const auto poolMs = bench::measureMs(2, [&pool, &paths, &numDecoded]() {
+            pool.decode(paths, [&numDecoded](std::size_t, std::shared_ptr<ImageData>) {
+                ++numDecoded;
+            });
+        });
+        std::printf(
+            "  pool %zu threads: %.1f ms (%.2fx), %zu decoded, %zu bytes in flight after\n",
+            pool.getNumThreads(),
+            poolMs,
+            serialMs / poolMs,
+            numDecoded.load(),
+            pool.getInFlightBytes());
+    }
+}
+
+// Images are passed to a consumer which releases one every few ms (like
+// uploads limited by the per-frame budget) - in-flight bytes shouldn't go
+// over the limit unless a single image is bigger than it
+void benchBoundedMemory(const std::vector<std::filesystem::path>& paths)
+{
+    static constexpr std::size_t MAX_IN_FLIGHT_BYTES = 8 * 1024 * 1024;
+
+    std::size_t maxImageSize = 0;
+    for (const auto& path : paths) {
+        maxImageSize = std::max(maxImageSize, util::getImageDataSize(path));
+    }
+
+    ImageDecodePool pool;
+    pool.init(4, MAX_IN_FLIGHT_BYTES);
+
+    std::mutex queueMutex;
+    std::deque<std::shared_ptr<ImageData>> queue;
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> peakInFlightBytes{0};
+    std::thread consumer([&]() {
+        while (true) {
+            {
+                std::lock_guard lock{queueMutex};
+                if (queue.empty() && done) {
+                    break;
+                }
+                if (!queue.empty()) {
+                    queue.pop_front();
+                }
+            }
+            peakInFlightBytes = std::max(peakInFlightBytes.load(), pool.getInFlightBytes());
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    pool.decode(paths, [&](std::size_t, std::shared_ptr<ImageData> image) {
+        std::lock_guard lock{queueMutex};
+        queue.push_back(std::move(image));
+        peakInFlightBytes = std::max(peakInFlightBytes.load(), pool.getInFlightBytes());
+    });
+    done = true;
+    consumer.join();
+
+    const auto limit = std::max(MAX_IN_FLIGHT_BYTES, maxImageSize);
+    const bool bounded = peakInFlightBytes <= limit && pool.getInFlightBytes() == 0;
+    std::printf(
+        "bounded: limit %.2f MB (largest image %.2f MB), peak in flight %.2f MB, "
+        "%zu bytes after - %s\n",
+        static_cast<double>(MAX_IN_FLIGHT_BYTES) / (1024.0 * 1024.0),
+        static_cast<double>(maxImageSize) / (1024.0 * 1024.0),
+        static_cast<double>(peakInFlightBytes.load()) / (1024.0 * 1024.0),
+        pool.getInFlightBytes(),
+        bounded ? "OK" : "FAILED");
+}
+
+} // end of anonymous namespace
+
+// Compares decoding images one after another (as loaders did before
+// ImageDecodePool) with decoding them on the pool
+int main()
+{
+    const auto assetsDir = std::filesystem::path{ASSETS_DIR};
+    const auto cityImages = findImages(assetsDir / "levels/city");
+    const auto skyboxImages = findImages(assetsDir / "textures/skybox/distant_sunset");
+
+    benchDecode("city", cityImages);
+    benchDecode("skybox", skyboxImages);
+    benchBoundedMemory(cityImages);
+}
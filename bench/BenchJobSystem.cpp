@@ -0,0 +1,75 @@
+#include <Jobs/JobSystem.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "BenchUtil.h"
+
+// Measures scheduling overhead and scaling of parallelFor from 1 to N threads
+int main()
+{
+    static constexpr std::size_t NUM_EMPTY_JOBS = 100'000;
+    static constexpr std::size_t NUM_VALUES = 1 << 22;
+
+    std::vector<float> values(NUM_VALUES);
+    const auto computeValues = [&values](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; ++i) {
+            const auto x = static_cast<float>(i) * 0.001f;
+            values[i] = std::sin(x) * std::cos(x * 2.f) + std::sqrt(x);
+        }
+    };
+
+    std::printf(
+        "%8s %16s %18s %18s %10s\n",
+        "threads",
+        "schedule (us)",
+        "parallelFor (us)",
+        "compute (ms)",
+        "speedup");
+
+    double singleThreadComputeMs = 0.0;
+    const auto maxNumWorkers = JobSystem::getDefaultNumWorkers();
+    for (std::size_t numWorkers = 0; numWorkers <= maxNumWorkers; ++numWorkers) {
+        JobSystem jobSystem;
+        jobSystem.init(numWorkers);
+
+        // schedule + run + wait of one empty job
+        const auto scheduleMs = bench::measureMs(10, [&jobSystem]() {
+            JobCounter counter;
+            for (std::size_t i = 0; i < NUM_EMPTY_JOBS; ++i) {
+                jobSystem.schedule([]() {}, &counter);
+            }
+            jobSystem.wait(counter);
+        });
+
+        // parallelFor over small batches with almost no work in them
+        const auto parallelForMs = bench::measureMs(100, [&jobSystem, &values]() {
+            jobSystem.parallelFor(
+                values.size(), values.size() / 256, [&values](std::size_t begin, std::size_t) {
+                    values[begin] += 1.f;
+                });
+        });
+
+        const auto computeMs = bench::measureMs(5, [&jobSystem, &computeValues]() {
+            jobSystem.parallelFor(NUM_VALUES, 16 * 1024, computeValues);
+        });
+        if (numWorkers == 0) {
+            singleThreadComputeMs = computeMs;
+        }
+
+        std::printf(
+            "%8zu %16.3f %18.2f %18.2f %10.2f\n",
+            jobSystem.getNumThreads(),
+            scheduleMs * 1000.0 / NUM_EMPTY_JOBS,
+            parallelForMs * 1000.0,
+            computeMs,
+            singleThreadComputeMs / computeMs);
+    }
+
+    double checksum = 0.0;
+    for (const auto& v : values) {
+        checksum += v;
+    }
+    std::printf("checksum: %f\n", checksum);
+}
@@ -0,0 +1,66 @@
+#include <Graphics/SkeletalAnimation.h>
+#include <Graphics/Skeleton.h>
+#include <Graphics/SkeletonAnimator.h>
+
+#include <cstdio>
+
+#include "AnimationBenchUtil.h"
+#include "BenchUtil.h"
+
+// Measures pose evaluation (sampling + joint matrices) of one animator
+namespace
+{
+void benchPoseEvaluation(
+    const char* name,
+    const Skeleton& skeleton,
+    const SkeletalAnimation& animation)
+{
+    static constexpr std::size_t NUM_FRAMES = 20'000;
+    static constexpr float DT = 1.f / 60.f;
+
+    SkeletonAnimator animator;
+    animator.setAnimation(skeleton, animation);
+
+    // forward playback, like in the game
+    const auto updateMs = bench::measureMs(NUM_FRAMES, [&]() { animator.update(skeleton, DT); });
+
+    // only the upper part of the skeleton is sampled, like with animation LOD
+    std::size_t numSampledJoints = 0;
+    const auto lodUpdateMs = bench::measureMs(NUM_FRAMES, [&]() {
+        animator.advance(DT);
+        numSampledJoints = animator.evaluate(skeleton, animator.getProgress(), 2);
+    });
+
+    const auto numJoints = skeleton.joints.size();
+    std::printf(
+        "%-14s %7zu %12.3f %12.1f %16zu %12.3f\n",
+        name,
+        numJoints,
+        updateMs * 1000.0,
+        updateMs * 1e6 / static_cast<double>(numJoints),
+        numSampledJoints,
+        lodUpdateMs * 1000.0);
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    const auto cato = bench::loadModel("models/cato.gltf");
+    const auto rig = bench::makeSyntheticRig(250);
+
+    std::printf(
+        "%-14s %7s %12s %12s %16s %12s\n",
+        "skeleton",
+        "joints",
+        "pose (us)",
+        "joint (ns)",
+        "depth<=2 joints",
+        "LOD (us)");
+    if (!cato.skeletons.empty() && cato.animations.contains("Run")) {
+        benchPoseEvaluation("Cato (Run)", cato.skeletons[0], cato.animations.at("Run"));
+    } else {
+        std::printf("Cato's skeleton or its \"Run\" animation is missing\n");
+    }
+    benchPoseEvaluation("synthetic", rig.skeleton, rig.animation);
+}
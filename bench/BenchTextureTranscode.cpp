@@ -0,0 +1,82 @@
+#include <util/KTX2.h>
+
+#include <Graphics/Texture.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+
+#include "BenchUtil.h"
+
+namespace
+{
+// Full mip chain of random blocks - every BC1 block is valid and random BC7
+// blocks use all of the modes
+util::KTX2Image makeRandomImage(wgpu::TextureFormat format, std::uint32_t size)
+{
+    util::KTX2Image image{
+        .format = format,
+        .width = size,
+        .height = size,
+    };
+
+    const auto bytesPerBlock = getTextureFormatInfo(format).bytesPerBlock;
+    for (auto levelSize = size; levelSize > 0; levelSize /= 2) {
+        const auto numBlocks = std::size_t{(levelSize + 3) / 4} * ((levelSize + 3) / 4);
+        image.levels.push_back(util::KTX2Image::Level{
+            .offset = image.data.size(),
+            .size = numBlocks * bytesPerBlock,
+        });
+        image.data.resize(image.data.size() + numBlocks * bytesPerBlock);
+    }
+
+    std::mt19937 rng(1234);
+    std::generate(image.data.begin(), image.data.end(), [&rng]() {
+        return static_cast<std::byte>(rng());
+    });
+    return image;
+}
+
+void benchTranscode(const char* name, wgpu::TextureFormat format, std::uint32_t size)
+{
+    const auto image = makeRandomImage(format, size);
+
+    std::size_t numTexels = 0;
+    for (std::size_t level = 0; level < image.levels.size(); ++level) {
+        numTexels += std::size_t{std::max(size >> level, 1u)} * std::max(size >> level, 1u);
+    }
+
+    std::uint32_t checksum = 0;
+    // includes copying the compressed image, which is much faster than decoding it
+    const auto ms = bench::measureMs(5, [&image, &checksum]() {
+        auto copy = image;
+        util::transcodeToRGBA8(copy);
+        for (std::size_t i = 0; i < copy.data.size(); i += 4097) {
+            checksum += static_cast<std::uint32_t>(copy.data[i]);
+        }
+    });
+
+    std::printf(
+        "%-6s %5ux%-5u %9.2f ms %10.1f Mtexels/s %8.1f MB/s of input (checksum %u)\n",
+        name,
+        size,
+        size,
+        ms,
+        static_cast<double>(numTexels) / (ms * 1000.0),
+        static_cast<double>(image.data.size()) / (ms * 1000.0),
+        checksum);
+}
+
+} // end of anonymous namespace
+
+// Measures CPU transcoding of BC textures (used when the device doesn't
+// support BC compression)
+int main()
+{
+    for (const std::uint32_t size : {256, 1024, 2048}) {
+        benchTranscode("BC1", wgpu::TextureFormat::BC1RGBAUnorm, size);
+        benchTranscode("BC5", wgpu::TextureFormat::BC5RGUnorm, size);
+        benchTranscode("BC7", wgpu::TextureFormat::BC7RGBAUnorm, size);
+    }
+}
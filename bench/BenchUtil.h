@@ -0,0 +1,23 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace bench
+{
+// Calls f() numIterations times (after one warm-up call) and returns average
+// time of a call in milliseconds
+template<typename F>
+double measureMs(std::size_t numIterations, F&& f)
+{
+    f();
+    const auto startTime = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < numIterations; ++i) {
+        f();
+    }
+    const auto totalTime =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+    return totalTime.count() / static_cast<double>(numIterations);
+}
+
+} // end of namespace bench
@@ -0,0 +1,31 @@
+#include "AnimationCache.h"
+
+AnimationId AnimationCache::addAnimation(SkeletonId skeletonId, SkeletalAnimation animation)
+{
+    const auto id = animations.size();
+    animations.push_back(std::move(animation));
+    skeletonAnimations[skeletonId].push_back(id);
+    return id;
+}
+
+const SkeletalAnimation& AnimationCache::getAnimation(AnimationId id) const
+{
+    return animations.at(id);
+}
+
+const std::vector<AnimationId>& AnimationCache::getSkeletonAnimations(SkeletonId skeletonId) const
+{
+    static const std::vector<AnimationId> noAnimations;
+    const auto it = skeletonAnimations.find(skeletonId);
+    return it != skeletonAnimations.end() ? it->second : noAnimations;
+}
+
+AnimationId AnimationCache::findAnimation(SkeletonId skeletonId, std::string_view name) const
+{
+    for (const auto id : getSkeletonAnimations(skeletonId)) {
+        if (animations[id].name == name) {
+            return id;
+        }
+    }
+    return NULL_ANIMATION_ID;
+}
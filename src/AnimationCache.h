@@ -0,0 +1,27 @@
+#pragma once
+
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <Graphics/SkeletalAnimation.h>
+#include <Graphics/Skeleton.h>
+
+// Animations are shared between all entities with the same skeleton.
+// Look up clips by name once (findAnimation) and keep their ids.
+class AnimationCache {
+public:
+    AnimationId addAnimation(SkeletonId skeletonId, SkeletalAnimation animation);
+
+    // references stay valid when new animations are added
+    const SkeletalAnimation& getAnimation(AnimationId id) const;
+
+    const std::vector<AnimationId>& getSkeletonAnimations(SkeletonId skeletonId) const;
+    // returns NULL_ANIMATION_ID if the skeleton has no animation with such name
+    AnimationId findAnimation(SkeletonId skeletonId, std::string_view name) const;
+
+private:
+    std::deque<SkeletalAnimation> animations;
+    std::unordered_map<SkeletonId, std::vector<AnimationId>> skeletonAnimations;
+};
@@ -3,6 +3,7 @@
 #include <util/GltfLoader.h>
 #include <util/ImageLoader.h>
 #include <util/InputUtil.h>
+#include <util/KTX2.h>
 #include <util/OSUtil.h>
 #include <util/SDLWebGPU.h>
 #include <util/WebGPUUtil.h>
@@ -12,11 +13,15 @@
 #include <cstdint>
 #include <webgpu/webgpu_cpp.h>
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
-#include <numeric> // iota
+#include <numeric>
 #include <vector>
 
 #include <backends/imgui_impl_sdl2.h>
@@ -59,7 +64,29 @@ void defaultValidationErrorHandler(WGPUErrorType type, char const* message, void
     std::exit(1);
 };
 
-const char* shaderSource = R"(
+// Draw sort key layout (from high to low bits):
+// [63-60] - pipeline, [59-40] - material, [39-20] - mesh, [19-0] - depth
+std::uint64_t makeDrawSortKey(
+    std::uint32_t pipelineId,
+    MaterialId materialId,
+    MeshId meshId,
+    float normalizedDepth)
+{
+    static constexpr std::uint64_t ID_MASK = (1 << 20) - 1;
+    assert(pipelineId < 16);
+    assert(materialId == NULL_MATERIAL_ID || materialId < ID_MASK);
+    assert(meshId < ID_MASK);
+
+    const auto depth = static_cast<std::uint64_t>(
+        std::clamp(normalizedDepth, 0.f, 1.f) * static_cast<float>(ID_MASK));
+    return (static_cast<std::uint64_t>(pipelineId) << 60) |
+           ((static_cast<std::uint64_t>(materialId) & ID_MASK) << 40) |
+           ((static_cast<std::uint64_t>(meshId) & ID_MASK) << 20) | depth;
+}
+
+// Mesh shader is split into common declarations, per-variant code and the
+// main functions, see makeMeshShaderSource
+const char* meshShaderCommonSource = R"(
 struct PerFrameData {
     viewProj: mat4x4f,
     invViewProj: mat4x4f,
@@ -72,43 +99,40 @@ struct DirectionalLight {
     colorAndIntensity: vec4f,
 };
 
-@group(0) @binding(0) var<uniform> fd: PerFrameData;
-@group(0) @binding(1) var<uniform> dirLight: DirectionalLight;
-
 struct MeshData {
     model: mat4x4f,
 };
 
-@group(2) @binding(0) var<uniform> meshData: MeshData;
-@group(2) @binding(1) var<storage, read> jointMatrices: array<mat4x4f>;
+@group(0) @binding(0) var<uniform> fd: PerFrameData;
+@group(0) @binding(1) var<uniform> dirLight: DirectionalLight;
+// per entity data
+@group(0) @binding(2) var<storage, read> meshData: array<MeshData>;
+// instance_index -> index into meshData
+@group(0) @binding(3) var<storage, read> instances: array<u32>;
 
 // mesh attributes
-@group(2) @binding(2) var<storage, read> positions: array<vec4f>;
-@group(2) @binding(3) var<storage, read> normals: array<vec4f>;
-@group(2) @binding(4) var<storage, read> tangents: array<vec4f>;
-@group(2) @binding(5) var<storage, read> uvs: array<vec2f>;
-// skinned meshes only
-@group(2) @binding(6) var<storage, read> jointIds: array<vec4u>;
-@group(2) @binding(7) var<storage, read> weights: array<vec4f>;
-
-fn calculateWorldPos(vertexIndex: u32, pos: vec4f) -> vec4f {
-    // FIXME: pass whether or not mesh has skeleton via other means,
-    // otherwise this won't work for meshes with four joints.
-    let hasSkeleton = (arrayLength(&jointIds) != 4);
-    if (!hasSkeleton) {
-        return meshData.model * pos;
-    }
-
-    let jointIds = jointIds[vertexIndex];
-    let weights = weights[vertexIndex];
-    let skinMatrix =
-        weights.x * jointMatrices[jointIds.x] +
-        weights.y * jointMatrices[jointIds.y] +
-        weights.z * jointMatrices[jointIds.z] +
-        weights.w * jointMatrices[jointIds.w];
-    return meshData.model * skinMatrix * pos;
+@group(2) @binding(0) var<storage, read> positions: array<vec4f>;
+@group(2) @binding(1) var<storage, read> normals: array<vec4f>;
+@group(2) @binding(2) var<storage, read> tangents: array<vec4f>;
+@group(2) @binding(3) var<storage, read> uvs: array<vec2f>;
+)";
+
+// calculateWorldPos is defined by each variant of the mesh shader
+const char* staticMeshShaderSource = R"(
+fn calculateWorldPos(vertexIndex: u32, model: mat4x4f, pos: vec4f) -> vec4f {
+    return model * pos;
 }
+)";
 
+// getSkinMatrix is defined by makeSkinningShaderSource
+const char* skinnedMeshShaderSource = R"(
+fn calculateWorldPos(vertexIndex: u32, model: mat4x4f, pos: vec4f) -> vec4f {
+    let skinnedPos = pos * getSkinMatrix(vertexIndex);
+    return model * vec4(skinnedPos, 1.0);
+}
+)";
+
+const char* meshShaderMainSource = R"(
 struct VertexOutput {
     @builtin(position) position: vec4f,
     @location(0) pos: vec3f,
@@ -117,13 +141,17 @@ struct VertexOutput {
 };
 
 @vertex
-fn vs_main(@builtin(vertex_index) vertexIndex: u32) -> VertexOutput {
+fn vs_main(
+    @builtin(vertex_index) vertexIndex: u32,
+    @builtin(instance_index) instanceIndex: u32,
+) -> VertexOutput {
     let pos = positions[vertexIndex];
     let normal = normals[vertexIndex];
     // let tangent = tangents[vertexIndex]; // unused for now
     let uv = uvs[vertexIndex];
 
-    let worldPos = calculateWorldPos(vertexIndex, pos);
+    let model = meshData[instances[instanceIndex]].model;
+    let worldPos = calculateWorldPos(vertexIndex, model, pos);
 
     var out: VertexOutput;
     out.position = fd.viewProj * worldPos;
@@ -187,6 +215,21 @@ fn fs_main(in: VertexOutput) -> @location(0) vec4f {
 }
 )";
 
+// Static variant doesn't declare joint bindings at all, so static meshes
+// only need attribute bindings and don't branch per vertex
+std::string makeMeshShaderSource(bool skinned, bool wideSkinAttribs)
+{
+    std::string source = meshShaderCommonSource;
+    if (skinned) {
+        source += makeSkinningShaderSource(2, 4, wideSkinAttribs);
+        source += skinnedMeshShaderSource;
+    } else {
+        source += staticMeshShaderSource;
+    }
+    source += meshShaderMainSource;
+    return source;
+}
+
 const char* spriteShaderSource = R"(
 struct SpriteVertex {
     positionAndUV: vec4f,
@@ -315,6 +358,7 @@ void Game::Params::validate()
 {
     assert(screenWidth > 0);
     assert(screenHeight > 0);
+    assert(crowdSize >= 0);
 }
 
 void Game::start(Params params)
@@ -331,6 +375,15 @@ void Game::init()
 {
     util::setCurrentDirToExeDir();
 
+    jobSystem.init();
+    std::cout << "Job system threads: " << jobSystem.getNumThreads() << std::endl;
+    // the async loader thread runs loading jobs too, while it waits for them
+    loaderJobSystem.init(std::max(std::size_t{1}, JobSystem::getDefaultNumWorkers() / 2));
+    asyncLoader.init();
+    // at least 2 threads, so that one big image doesn't delay all of the others
+    imageDecodePool.init(
+        std::max(std::size_t{2}, jobSystem.getNumThreads() / 2), imageDecodeMaxInFlightBytes);
+
     util::initWebGPU();
 
     const auto instanceDesc = wgpu::InstanceDescriptor{};
@@ -340,7 +393,9 @@ void Game::init()
         std::exit(1);
     }
 
-    const auto adapterOpts = wgpu::RequestAdapterOptions{};
+    const auto adapterOpts = wgpu::RequestAdapterOptions{
+        .forceFallbackAdapter = params.forceFallbackAdapter,
+    };
     adapter = util::requestAdapter(instance, &adapterOpts);
 
     auto supportedLimits = wgpu::SupportedLimits{};
@@ -353,6 +408,8 @@ void Game::init()
         std::cout << "minStorageBufferOffsetAlignment: "
                   << supportedLimits.limits.minStorageBufferOffsetAlignment << std::endl;
         std::cout << "max bind groups: " << supportedLimits.limits.maxBindGroups << std::endl;
+        std::cout << "maxStorageBuffersPerShaderStage: "
+                  << supportedLimits.limits.maxStorageBuffersPerShaderStage << std::endl;
     }
 
     // Initialize SDL
@@ -392,10 +449,7 @@ void Game::init()
     if (unsafeMode) {
         enabledToggles.push_back("skip_validation");
     }
-
-    wgpu::DawnTogglesDescriptor deviceTogglesDesc;
-    deviceTogglesDesc.enabledToggles = enabledToggles.data();
-    deviceTogglesDesc.enabledToggleCount = enabledToggles.size();
+    std::vector<const char*> disabledToggles;
 
     requiredLimits = wgpu::RequiredLimits{};
 
@@ -405,13 +459,55 @@ void Game::init()
     requiredLimits.limits.minUniformBufferOffsetAlignment =
         requiredLimits.limits.minUniformBufferOffsetAlignment;
 
+    // vertex stage of skinned mesh pipelines reads 2 storage buffers from the
+    // frame group (mesh data, instance indices) and 7 from the skinned mesh
+    // group, which is above the default limit of 8. The skinning compute pass
+    // only needs 7, so it's always used on adapters which don't allow more
+    requiredLimits.limits.maxStorageBuffersPerShaderStage =
+        supportedLimits.limits.maxStorageBuffersPerShaderStage;
+    vertexSkinningSupported = supportedLimits.limits.maxStorageBuffersPerShaderStage >= 9;
+    if (!vertexSkinningSupported) {
+        std::cout << "Vertex shader skinning is not supported (max storage buffers per stage: "
+                  << supportedLimits.limits.maxStorageBuffersPerShaderStage
+                  << "), skinning in compute pass" << std::endl;
+        gpuSkinning = true;
+    }
+
+    // compressed textures with prebuilt mips are loaded from KTX2 files
+    std::vector<wgpu::FeatureName> requiredFeatures;
+    if (params.textureCompression && adapter.HasFeature(wgpu::FeatureName::TextureCompressionBC)) {
+        requiredFeatures.push_back(wgpu::FeatureName::TextureCompressionBC);
+    }
+    if (params.gpuTiming && adapter.HasFeature(wgpu::FeatureName::TimestampQuery)) {
+        requiredFeatures.push_back(wgpu::FeatureName::TimestampQuery);
+        // timestamp queries are guarded by this toggle, and the default
+        // quantization makes timings of small passes useless
+        enabledToggles.push_back("allow_unsafe_apis");
+        disabledToggles.push_back("timestamp_quantization");
+    }
+
+    wgpu::DawnTogglesDescriptor deviceTogglesDesc;
+    deviceTogglesDesc.enabledToggles = enabledToggles.data();
+    deviceTogglesDesc.enabledToggleCount = enabledToggles.size();
+    deviceTogglesDesc.disabledToggles = disabledToggles.data();
+    deviceTogglesDesc.disabledToggleCount = disabledToggles.size();
+
     const auto deviceDesc = wgpu::DeviceDescriptor{
         .nextInChain = &deviceTogglesDesc,
         .label = "Device",
+        .requiredFeatureCount = requiredFeatures.size(),
+        .requiredFeatures = requiredFeatures.data(),
         .requiredLimits = &requiredLimits,
     };
 
     device = util::requestDevice(adapter, &deviceDesc);
+    textureCompressionBC = device.HasFeature(wgpu::FeatureName::TextureCompressionBC);
+    std::cout << "BC texture compression: " << (textureCompressionBC ? "yes" : "no") << std::endl;
+    if (params.gpuTiming) {
+        gpuTimer.init(device, GPU_TIMER_NUM_SECTIONS, "Frame timestamps");
+        std::cout << "GPU timing: " << (gpuTimer.isEnabled() ? "yes" : "not supported")
+                  << std::endl;
+    }
 
     auto onDeviceError = [](WGPUErrorType type, char const* message, void* userdata) {
         std::cout << "Uncaptured device error: type " << type;
@@ -452,6 +548,11 @@ void Game::init()
     }
 
     mipMapGenerator.init(device, fullscreenTriangleShaderModule);
+    if (params.gpuTiming) {
+        mipMapGenerator.initGPUTimer(device);
+    }
+    uploadManager.init(device);
+    skinningPass.init(device, requiredLimits.limits.minStorageBufferOffsetAlignment);
 
     { // create depth dexture
         const auto textureDesc = wgpu::TextureDescriptor{
@@ -489,10 +590,11 @@ void Game::init()
             .device = device,
             .queue = queue,
             .mipMapGenerator = mipMapGenerator,
+            .uploadManager = uploadManager,
         };
         glm::vec4 whiteColor{1.f, 1.f, 1.f, 1.f};
-        whiteTexture =
-            util::createPixelTexture(loadCtx, wgpu::TextureFormat::RGBA8Unorm, whiteColor, "white");
+        whiteTexture = std::make_shared<const Texture>(util::createPixelTexture(
+            loadCtx, wgpu::TextureFormat::RGBA8Unorm, whiteColor, "white"));
     }
 
     {
@@ -528,15 +630,6 @@ void Game::init()
         anisotropicSampler = device.CreateSampler(&samplerDesc);
     }
 
-    {
-        const auto bufferDesc = wgpu::BufferDescriptor{
-            .label = "empty storage buffer",
-            .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
-            .size = 64, // D3D12 doesn't allow to create smaller buffers
-        };
-        emptyStorageBuffer = device.CreateBuffer(&bufferDesc);
-    }
-
     initCamera();
 
     screenTextureFormat = wgpu::TextureFormat::RGBA16Float;
@@ -595,61 +688,46 @@ void Game::init()
         postFXBindGroup = device.CreateBindGroup(&bindGroupDesc);
     }
 
-    const auto catoScene = loadScene("assets/models/cato.gltf");
-    createEntitiesFromScene(catoScene);
-
-    const auto yaeScene = loadScene("assets/models/yae.gltf");
-    createEntitiesFromScene(yaeScene);
-
-    const auto levelScene = loadScene("assets/levels/city/city.gltf");
-    // const auto levelScene = loadScene("assets/levels/house/house.gltf");
-    createEntitiesFromScene(levelScene);
+    // nothing is loaded synchronously: the first frame is shown right away and
+    // content appears as it's uploaded
+    loadSkyboxAsync("assets/textures/skybox/distant_sunset");
+
+    loadSceneAsync("assets/models/cato.gltf", [this](const Scene& scene) {
+        createEntitiesFromScene(scene);
+        const glm::vec3 catoPos{1.4f, 0.0f, 0.f};
+        auto& cato = findEntityByName("Cato");
+        transformHierarchy.setLocalPosition(cato.id, catoPos);
+
+        // crowd: a square grid of Catos behind the first one
+        const auto gridSize = static_cast<int>(std::ceil(std::sqrt(params.crowdSize)));
+        const float spacing = 1.2f;
+        for (int i = 0; i < params.crowdSize; ++i) {
+            const auto row = i / gridSize;
+            const auto column = i % gridSize - gridSize / 2;
+            const auto pos = catoPos + glm::vec3{column * spacing, 0.f, -(row + 1) * spacing};
+            for (const auto& nodePtr : scene.nodes) {
+                if (nodePtr) {
+                    const auto id = createEntitiesFromNode(scene, *nodePtr);
+                    transformHierarchy.setLocalPosition(id, pos);
+                }
+            }
+        }
+    });
 
-    const glm::vec3 yaePos{1.4f, 0.f, -2.f};
-    auto& yae = findEntityByName("yae_mer");
-    yae.transform.position = yaePos;
+    loadSceneAsync("assets/models/yae.gltf", [this](const Scene& scene) {
+        createEntitiesFromScene(scene);
+        const glm::vec3 yaePos{1.4f, 0.f, -2.f};
+        auto& yae = findEntityByName("yae_mer");
+        transformHierarchy.setLocalPosition(yae.id, yaePos);
+    });
 
-    const glm::vec3 catoPos{1.4f, 0.0f, 0.f};
-    auto& cato = findEntityByName("Cato");
-    cato.transform.position = catoPos;
+    loadSceneAsync("assets/levels/city/city.gltf", [this](const Scene& scene) {
+        createEntitiesFromScene(scene);
+    });
+    // loadSceneAsync("assets/levels/house/house.gltf", ...);
 
     createSprite(sprite, "assets/textures/tree.png");
 
-    // load skybox
-    {
-        const auto loadCtx = util::TextureLoadContext{
-            .device = device,
-            .queue = queue,
-            .mipMapGenerator = mipMapGenerator,
-        };
-        skyboxTexture =
-            util::loadCubemap(loadCtx, "assets/textures/skybox/distant_sunset", true, "skybox");
-        assert(skyboxTexture.isCubemap);
-
-        // create bind group
-        // NOTE: frameDataBuffer must already be created
-        const std::array<wgpu::BindGroupEntry, 3> bindings{{
-            {
-                .binding = 0,
-                .buffer = frameDataBuffer,
-            },
-            {
-                .binding = 1,
-                .textureView = skyboxTexture.createView(),
-            },
-            {
-                .binding = 2,
-                .sampler = bilinearSampler,
-            },
-        }};
-        const auto bindGroupDesc = wgpu::BindGroupDescriptor{
-            .layout = skyboxGroupLayout.Get(),
-            .entryCount = bindings.size(),
-            .entries = bindings.data(),
-        };
-        skyboxBindGroup = device.CreateBindGroup(&bindGroupDesc);
-    }
-
     initImGui();
 }
 
@@ -699,48 +777,59 @@ void Game::initSceneData()
             .directionAndMisc = {lightDir, 0.f},
             .colorAndIntensity = {lightColor, lightIntensity},
         };
-        queue.WriteBuffer(directionalLightBuffer, 0, &dirLightData, sizeof(DirectionalLightData));
+        uploadManager.uploadBuffer(
+            directionalLightBuffer, 0, &dirLightData, sizeof(DirectionalLightData));
     }
 
-    { // per frame data
-        const std::array<wgpu::BindGroupEntry, 2> bindings{{
-            {
-                .binding = 0,
-                .buffer = frameDataBuffer,
-            },
-            {
-                .binding = 1,
-                .buffer = directionalLightBuffer,
-            },
-        }};
-        const auto bindGroupDesc = wgpu::BindGroupDescriptor{
-            .layout = perFrameDataGroupLayout.Get(),
-            .entryCount = bindings.size(),
-            .entries = bindings.data(),
-        };
-
-        perFrameBindGroup = device.CreateBindGroup(&bindGroupDesc);
-    }
+    // will grow in uploadInstanceData if needed
+    meshDataBuffer = createStorageBuffer("mesh data buffer", sizeof(MeshData) * 1024);
+    instanceDataBuffer = createStorageBuffer("instance data buffer", sizeof(std::uint32_t) * 1024);
+    createPerFrameBindGroup();
 }
 
-void Game::createMeshDrawingPipeline()
+wgpu::Buffer Game::createStorageBuffer(const char* label, std::size_t size)
 {
-    { // create shader module
-        auto shaderCodeDesc = wgpu::ShaderModuleWGSLDescriptor{};
-        shaderCodeDesc.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
-        shaderCodeDesc.code = shaderSource;
+    const auto bufferDesc = wgpu::BufferDescriptor{
+        .label = label,
+        .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+        .size = size,
+    };
+    return device.CreateBuffer(&bufferDesc);
+}
 
-        const auto shaderDesc = wgpu::ShaderModuleDescriptor{
-            .nextInChain = reinterpret_cast<wgpu::ChainedStruct*>(&shaderCodeDesc),
-            .label = "model",
-        };
+void Game::createPerFrameBindGroup()
+{
+    const std::array<wgpu::BindGroupEntry, 4> bindings{{
+        {
+            .binding = 0,
+            .buffer = frameDataBuffer,
+        },
+        {
+            .binding = 1,
+            .buffer = directionalLightBuffer,
+        },
+        {
+            .binding = 2,
+            .buffer = meshDataBuffer,
+        },
+        {
+            .binding = 3,
+            .buffer = instanceDataBuffer,
+        },
+    }};
+    const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+        .layout = perFrameDataGroupLayout.Get(),
+        .entryCount = bindings.size(),
+        .entries = bindings.data(),
+    };
 
-        meshShaderModule = device.CreateShaderModule(&shaderDesc);
-        meshShaderModule.GetCompilationInfo(util::defaultShaderCompilationCallback, (void*)"model");
-    }
+    perFrameBindGroup = device.CreateBindGroup(&bindGroupDesc);
+}
 
+void Game::createMeshDrawingPipeline()
+{
     { // per frame data layout
-        const std::array<wgpu::BindGroupLayoutEntry, 2> bindGroupLayoutEntries{{
+        const std::array<wgpu::BindGroupLayoutEntry, 4> bindGroupLayoutEntries{{
             {
                 .binding = 0,
                 .visibility = wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment,
@@ -757,6 +846,24 @@ void Game::createMeshDrawingPipeline()
                         .type = wgpu::BufferBindingType::Uniform,
                     },
             },
+            {
+                // per entity mesh data
+                .binding = 2,
+                .visibility = wgpu::ShaderStage::Vertex,
+                .buffer =
+                    {
+                        .type = wgpu::BufferBindingType::ReadOnlyStorage,
+                    },
+            },
+            {
+                // per instance mesh data indices
+                .binding = 3,
+                .visibility = wgpu::ShaderStage::Vertex,
+                .buffer =
+                    {
+                        .type = wgpu::BufferBindingType::ReadOnlyStorage,
+                    },
+            },
         }};
 
         const auto bindGroupLayoutDesc = wgpu::BindGroupLayoutDescriptor{
@@ -804,31 +911,15 @@ void Game::createMeshDrawingPipeline()
         materialGroupLayout = device.CreateBindGroupLayout(&bindGroupLayoutDesc);
     }
 
-    { // mesh data layout
-        std::vector<wgpu::BindGroupLayoutEntry> bindGroupLayoutEntries{{
-            {
-                // mesh data
-                .binding = 0,
-                .visibility = wgpu::ShaderStage::Vertex,
-                .buffer =
-                    {
-                        .type = wgpu::BufferBindingType::Uniform,
-                    },
-            },
-            {
-                // jointMatrices
-                .binding = 1,
-                .visibility = wgpu::ShaderStage::Vertex,
-                .buffer =
-                    {
-                        .type = wgpu::BufferBindingType::ReadOnlyStorage,
-                    },
-            },
-        }};
-
-        for (std::uint32_t i = 0; i < 6; ++i) {
+    { // mesh data layouts
+        // 0-3 - positions, normals, tangents, uvs
+        // skinned meshes only:
+        // 4-5 - jointIds, weights
+        // 6 - jointMatrices
+        std::vector<wgpu::BindGroupLayoutEntry> bindGroupLayoutEntries;
+        for (std::uint32_t i = 0; i < 7; ++i) {
             bindGroupLayoutEntries.push_back({
-                .binding = 2 + i,
+                .binding = i,
                 .visibility = wgpu::ShaderStage::Vertex,
                 .buffer =
                     {
@@ -839,24 +930,54 @@ void Game::createMeshDrawingPipeline()
 
         const auto bindGroupLayoutDesc = wgpu::BindGroupLayoutDescriptor{
             .label = "mesh bind group",
-            .entryCount = bindGroupLayoutEntries.size(),
+            .entryCount = 4,
             .entries = bindGroupLayoutEntries.data(),
         };
         meshGroupLayout = device.CreateBindGroupLayout(&bindGroupLayoutDesc);
+
+        const auto skinnedBindGroupLayoutDesc = wgpu::BindGroupLayoutDescriptor{
+            .label = "skinned mesh bind group",
+            .entryCount = bindGroupLayoutEntries.size(),
+            .entries = bindGroupLayoutEntries.data(),
+        };
+        skinnedMeshGroupLayout = device.CreateBindGroupLayout(&skinnedBindGroupLayoutDesc);
     }
 
-    {
+    for (std::size_t i = 0; i < meshPipelines.size(); ++i) {
+        const auto pipelineId = static_cast<MeshPipelineId>(i);
+        const auto wideSkinAttribs = (pipelineId == MeshPipelineId::SkinnedWide);
+        const auto skinned = (pipelineId == MeshPipelineId::Skinned) || wideSkinAttribs;
+        if (skinned && !vertexSkinningSupported) {
+            continue; // would fail pipeline layout validation
+        }
+        const auto label = wideSkinAttribs ? "skinned mesh (wide)" :
+                           skinned         ? "skinned mesh" :
+                                             "mesh";
+
+        const auto shaderSource = makeMeshShaderSource(skinned, wideSkinAttribs);
+        auto shaderCodeDesc = wgpu::ShaderModuleWGSLDescriptor{};
+        shaderCodeDesc.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
+        shaderCodeDesc.code = shaderSource.c_str();
+
+        const auto shaderDesc = wgpu::ShaderModuleDescriptor{
+            .nextInChain = reinterpret_cast<wgpu::ChainedStruct*>(&shaderCodeDesc),
+            .label = label,
+        };
+
+        const auto meshShaderModule = device.CreateShaderModule(&shaderDesc);
+        meshShaderModule.GetCompilationInfo(util::defaultShaderCompilationCallback, (void*)label);
+
         std::array<wgpu::BindGroupLayout, 3> groupLayouts{
             perFrameDataGroupLayout,
             materialGroupLayout,
-            meshGroupLayout,
+            skinned ? skinnedMeshGroupLayout : meshGroupLayout,
         };
         const wgpu::PipelineLayoutDescriptor layoutDesc{
             .bindGroupLayoutCount = groupLayouts.size(),
             .bindGroupLayouts = groupLayouts.data(),
         };
         wgpu::RenderPipelineDescriptor pipelineDesc{
-            .label = "mesh draw pipeline",
+            .label = label,
             .layout = device.CreatePipelineLayout(&layoutDesc),
             .primitive =
                 {
@@ -908,13 +1029,13 @@ void Game::createMeshDrawingPipeline()
         };
         pipelineDesc.fragment = &fragmentState;
 
-        meshPipeline = device.CreateRenderPipeline(&pipelineDesc);
+        meshPipelines[i] = device.CreateRenderPipeline(&pipelineDesc);
     }
 }
 
-Scene Game::loadScene(const std::filesystem::path& path)
+util::LoadContext Game::createLoadContext()
 {
-    const auto loadContext = util::LoadContext{
+    return util::LoadContext{
         .device = device,
         .queue = queue,
         .materialLayout = materialGroupLayout,
@@ -922,15 +1043,236 @@ Scene Game::loadScene(const std::filesystem::path& path)
         .linearSampler = anisotropicSampler,
         .whiteTexture = whiteTexture,
         .mipMapGenerator = mipMapGenerator,
+        .uploadManager = uploadManager,
         .materialCache = materialCache,
+        .textureCache = textureCache,
         .meshCache = meshCache,
+        .skeletonCache = skeletonCache,
+        .animationCache = animationCache,
+        .jobSystem = &jobSystem,
         .requiredLimits = requiredLimits,
     };
+}
+
+void Game::loadSceneAsync(
+    const std::filesystem::path& path,
+    std::function<void(const Scene&)> onLoaded)
+{
+    // shared between the load task and the uploads which it adds
+    struct PendingScene {
+        util::SceneLoadData data;
+        std::vector<MaterialId> materialIds;
+    };
+    auto pending = std::make_shared<PendingScene>();
+
+    asyncLoader.load([this, path, pending, onLoaded = std::move(onLoaded)]() {
+        auto& data = pending->data;
+        {
+            auto loadCtx = createLoadContext();
+            loadCtx.jobSystem = &loaderJobSystem;
+            util::SceneLoader loader;
+            loader.loadSceneData(loadCtx, data, path);
+        }
+
+        // materials are created first so that meshes can reference them,
+        // their diffuse textures are set when they're decoded (see below)
+        asyncLoader.addUpload(
+            [this, pending]() {
+                const auto loadCtx = createLoadContext();
+                for (const auto& cookedMaterial : pending->data.assets.materials) {
+                    pending->materialIds.push_back(
+                        materialCache.addMaterial(util::createMaterial(loadCtx, cookedMaterial)));
+                }
+            },
+            sizeof(MaterialData) * data.assets.materials.size());
+
+        // meshes
+        data.scene.meshes.resize(data.assets.meshes.size());
+        for (std::size_t meshIdx = 0; meshIdx < data.assets.meshes.size(); ++meshIdx) {
+            data.scene.meshes[meshIdx].primitives.resize(data.assets.meshes[meshIdx].size());
+        }
+        for (std::size_t meshIdx = 0; meshIdx < data.assets.meshes.size(); ++meshIdx) {
+            const auto& primitives = data.assets.meshes[meshIdx];
+            for (std::size_t primitiveIdx = 0; primitiveIdx < primitives.size(); ++primitiveIdx) {
+                const auto& primitive = primitives[primitiveIdx];
+                asyncLoader.addUpload(
+                    [this, pending, meshIdx, primitiveIdx]() {
+                        auto& sceneData = pending->data;
+                        const auto& cooked = sceneData.assets.meshes[meshIdx][primitiveIdx];
+                        auto gpuMesh = util::createGPUMesh(createLoadContext(), cooked);
+                        if (cooked.materialIdx != -1) {
+                            const auto materialIdx = static_cast<std::size_t>(cooked.materialIdx);
+                            gpuMesh.materialId = pending->materialIds[materialIdx];
+                        }
+                        sceneData.scene.meshes[meshIdx].primitives[primitiveIdx] =
+                            meshCache.addMesh(std::move(gpuMesh));
+                    },
+                    primitive.indexData.size() + primitive.vertexData.size());
+            }
+        }
+
+        // all meshes are resident - entities can be created
+        asyncLoader.addUpload(
+            [this, pending, onLoaded]() {
+                util::addSkeletonsAndAnimations(createLoadContext(), pending->data.scene);
+                onLoaded(pending->data.scene);
+
+                // index/vertex data is not needed anymore
+                auto& sceneData = pending->data;
+                sceneData.assets.meshes.clear();
+                sceneData.meshData.clear();
+                sceneData.cookedFile.close();
+            },
+            0);
+
+        // textures replace whiteTexture placeholders as they're decoded
+        // each image is decoded once for all materials which use it, images of
+        // textures which are already in textureCache aren't decoded at all
+        // textures with KTX2 files (see getDiffuseTextureKey) are read from them
+        // on this thread instead - they don't need decoding
+        struct DiffuseImage {
+            TextureCache::Key key;
+            std::string label; // path relative to scene dir
+            std::vector<std::size_t> materialIndices;
+        };
+        std::vector<DiffuseImage> diffuseImages;
+        std::vector<std::filesystem::path> imagePaths;
+        std::vector<DiffuseImage> ktx2Images;
+        for (std::size_t materialIdx = 0; materialIdx < data.assets.materials.size();
+             ++materialIdx) {
+            const auto& diffusePath = data.assets.materials[materialIdx].diffuseTexturePath;
+            if (diffusePath.empty()) {
+                continue;
+            }
+
+            auto key = util::getDiffuseTextureKey(data.sceneDir / diffusePath);
+            if (auto texture = textureCache.find(key)) {
+                asyncLoader.addUpload(
+                    [this, pending, materialIdx, texture = std::move(texture)]() {
+                        auto& material =
+                            materialCache.getMaterial(pending->materialIds[materialIdx]);
+                        util::setMaterialDiffuseTexture(createLoadContext(), material, texture);
+                    },
+                    0);
+                continue;
+            }
+
+            const auto isKTX2 = util::isKTX2File(key.path);
+            auto& images = isKTX2 ? ktx2Images : diffuseImages;
+            auto it = std::find_if(images.begin(), images.end(), [&key](const DiffuseImage& image) {
+                return image.key == key;
+            });
+            if (it == images.end()) {
+                images.push_back(DiffuseImage{
+                    .key = std::move(key),
+                    .label = diffusePath,
+                    .materialIndices = {materialIdx},
+                });
+                if (!isKTX2) {
+                    imagePaths.push_back(data.sceneDir / diffusePath);
+                }
+            } else {
+                it->materialIndices.push_back(materialIdx);
+            }
+        }
+
+        // block-compressed images are transcoded here if the device can't use them
+        for (const auto& diffuseImage : ktx2Images) {
+            auto image = std::make_shared<util::KTX2Image>(
+                util::loadKTX2Image(std::filesystem::path{diffuseImage.key.path}));
+            if (util::needsTranscoding(*image, textureCompressionBC)) {
+                util::transcodeToRGBA8(*image);
+            }
+            const auto imageSize = image->data.size();
+            asyncLoader.addUpload(
+                [this, pending, diffuseImage, image = std::move(image)]() {
+                    const auto loadCtx = createLoadContext();
+                    const auto texture = util::findOrLoadDiffuseTexture(
+                        loadCtx, diffuseImage.key, std::move(*image), diffuseImage.label.c_str());
+                    for (const auto materialIdx : diffuseImage.materialIndices) {
+                        auto& material =
+                            materialCache.getMaterial(pending->materialIds[materialIdx]);
+                        util::setMaterialDiffuseTexture(loadCtx, material, texture);
+                    }
+                },
+                imageSize);
+        }
+
+        // images are released by their uploads, which bounds the memory used by
+        // decoded images waiting for upload (see ImageDecodePool)
+        imageDecodePool.decode(
+            imagePaths, [&](std::size_t imageIdx, std::shared_ptr<ImageData> image) {
+                const auto imageSize =
+                    static_cast<std::size_t>(image->width * image->height * image->channels);
+                asyncLoader.addUpload(
+                    [this,
+                     pending,
+                     diffuseImage = diffuseImages[imageIdx],
+                     image = std::move(image)]() {
+                        const auto loadCtx = createLoadContext();
+                        const auto texture = util::findOrLoadDiffuseTexture(
+                            loadCtx, diffuseImage.key, *image, diffuseImage.label.c_str());
+                        for (const auto materialIdx : diffuseImage.materialIndices) {
+                            auto& material =
+                                materialCache.getMaterial(pending->materialIds[materialIdx]);
+                            util::setMaterialDiffuseTexture(loadCtx, material, texture);
+                        }
+                    },
+                    imageSize);
+            });
+    });
+}
 
-    Scene scene;
-    util::SceneLoader loader;
-    loader.loadScene(loadContext, scene, path);
-    return scene;
+void Game::loadSkyboxAsync(const std::filesystem::path& imagesDir)
+{
+    asyncLoader.load([this, imagesDir]() {
+        // all faces are needed at once, so they're moved out of decoded images
+        // (and don't count towards the decode pool's in-flight limit)
+        auto images = std::make_shared<std::array<ImageData, 6>>();
+        const auto paths = util::getCubemapImagePaths(imagesDir);
+        imageDecodePool.decode(
+            paths, [&images](std::size_t face, std::shared_ptr<ImageData> image) {
+                (*images)[face] = std::move(*image);
+            });
+        const auto& face = (*images)[0];
+        const auto imagesSize = static_cast<std::size_t>(face.width * face.height * 4 * 6);
+
+        asyncLoader.addUpload(
+            [this, images]() {
+                const auto loadCtx = util::TextureLoadContext{
+                    .device = device,
+                    .queue = queue,
+                    .mipMapGenerator = mipMapGenerator,
+                    .uploadManager = uploadManager,
+                };
+                skyboxTexture = util::loadCubemap(loadCtx, *images, true, "skybox");
+                assert(skyboxTexture.isCubemap);
+
+                // create bind group
+                // NOTE: frameDataBuffer must already be created
+                const std::array<wgpu::BindGroupEntry, 3> bindings{{
+                    {
+                        .binding = 0,
+                        .buffer = frameDataBuffer,
+                    },
+                    {
+                        .binding = 1,
+                        .textureView = skyboxTexture.createView(),
+                    },
+                    {
+                        .binding = 2,
+                        .sampler = bilinearSampler,
+                    },
+                }};
+                const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+                    .layout = skyboxGroupLayout.Get(),
+                    .entryCount = bindings.size(),
+                    .entries = bindings.data(),
+                };
+                skyboxBindGroup = device.CreateBindGroup(&bindGroupDesc);
+            },
+            imagesSize);
+    });
 }
 
 void Game::createEntitiesFromScene(const Scene& scene)
@@ -947,140 +1289,256 @@ Game::EntityId Game::createEntitiesFromNode(
     const SceneNode& node,
     EntityId parentId)
 {
-    auto& e = makeNewEntity();
+    auto& e = makeNewEntity(node.transform, parentId);
     e.tag = node.name;
 
-    // transform
-    {
-        e.transform = node.transform;
-        if (parentId == NULL_ENTITY_ID) {
-            e.worldTransform = e.transform.asMatrix();
-        } else {
-            const auto& parent = entities[parentId];
-            e.worldTransform = parent->worldTransform * node.transform.asMatrix();
+    if (node.instances.empty()) {
+        initEntityMeshes(e, scene, node);
+    } else {
+        // EXT_mesh_gpu_instancing: the mesh is only drawn at instance transforms,
+        // so create child entity for each instance. They'll be batched in sortDrawList.
+        assert(node.skinId == -1 && "instanced skinned meshes are not supported");
+        for (const auto& instanceTransform : node.instances) {
+            auto& ie = makeNewEntity(instanceTransform, e.id);
+            ie.tag = node.name;
+            initEntityMeshes(ie, scene, node);
         }
     }
 
-    { // mesh
-        e.meshes = scene.meshes[node.meshIndex].primitives;
+    // children are always created after their parent, so entity ids
+    // stay in topological order (required by TransformHierarchy)
+    for (const auto& childPtr : node.children) {
+        if (childPtr) {
+            createEntitiesFromNode(scene, *childPtr, e.id);
+        }
+    }
 
-        const auto bufferDesc = wgpu::BufferDescriptor{
-            .label = "mesh data buffer",
-            .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
-            .size = sizeof(MeshData),
-        };
+    return e.id;
+}
 
-        // TODO: do this in every frame for dynamic entities!
-        e.meshDataBuffer = device.CreateBuffer(&bufferDesc);
-        const auto md = MeshData{
-            .model = e.worldTransform,
-        };
-        queue.WriteBuffer(e.meshDataBuffer, 0, &md, sizeof(MeshData));
-
-        auto jointMatricesDataBuffer = emptyStorageBuffer;
-        { // skeleton
-            if (node.skinId != -1) {
-                e.hasSkeleton = true;
-                e.skeleton = scene.skeletons[node.skinId];
-
-                const auto bufferDesc = wgpu::BufferDescriptor{
-                    .label = "joint matrices data buffer",
-                    .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
-                    .size = sizeof(glm::mat4) * e.skeleton.joints.size(),
-                };
-                e.jointMatricesDataBuffer = device.CreateBuffer(&bufferDesc);
-                jointMatricesDataBuffer = e.jointMatricesDataBuffer;
+void Game::initEntityMeshes(Entity& e, const Scene& scene, const SceneNode& node)
+{
+    e.meshes = scene.meshes[node.meshIndex].primitives;
 
-                // FIXME: this is bad - we need to have some sort of cache
-                // and not copy animations everywhere
-                e.animations = scene.animations;
+    if (node.skinId != -1) {
+        e.hasSkeleton = true;
+        e.skeletonId = scene.skeletonIds[static_cast<std::size_t>(node.skinId)];
+        const auto& skeleton = skeletonCache.getSkeleton(e.skeletonId);
 
-                // e.skeletonAnimator.setAnimation(e.skeleton, e.animations.at("PickUp"));
-                e.skeletonAnimator.setAnimation(e.skeleton, e.animations.at("Run"));
-                e.uploadJointMatricesToGPU(queue, e.skeletonAnimator.getJointMatrices());
-            }
+        e.skinnedMeshes.reserve(e.meshes.size());
+        for (const auto& meshId : e.meshes) {
+            e.skinnedMeshes.push_back(Entity::SkinnedMesh{
+                .output = skinningPass.createOutput(device, meshCache.getMesh(meshId)),
+            });
         }
 
-        { // mesh bind group
-            for (std::size_t i = 0; i < e.meshes.size(); ++i) {
-                auto& mesh = meshCache.getMesh(e.meshes[i]);
+        e.jointMatricesOffset = allocateJointMatrices(skeleton.joints.size());
+        animatedEntities.push_back(e.id);
 
-                std::vector<wgpu::BindGroupEntry> bindings{{
-                    {
-                        .binding = 0,
-                        .buffer = e.meshDataBuffer,
-                    },
-                    {
-                        .binding = 1,
-                        .buffer = jointMatricesDataBuffer,
-                    },
-                }};
-
-                for (std::size_t i = 0; i < mesh.attribs.size(); ++i) {
-                    const auto& attrib = mesh.attribs[i];
-                    bindings.push_back({
-                        .binding = 2 + static_cast<std::uint32_t>(i),
-                        .buffer = mesh.vertexBuffer,
-                        .offset = attrib.offset,
-                        .size = attrib.size,
-                    });
-                }
+        const auto runAnimationId = animationCache.findAnimation(e.skeletonId, "Run");
+        assert(runAnimationId != NULL_ANIMATION_ID);
+        e.skeletonAnimator.setAnimation(skeleton, animationCache.getAnimation(runAnimationId));
 
-                if (!mesh.hasSkeleton) {
-                    assert(mesh.attribs.size() == 4);
-                    // bind empty array to jointIds and weights
-                    bindings.push_back({
-                        .binding = 6,
-                        .buffer = emptyStorageBuffer,
-                    });
-                    bindings.push_back({
-                        .binding = 7,
-                        .buffer = emptyStorageBuffer,
-                    });
-                }
+        createSkinnedMeshBindGroups(e);
+        return;
+    }
 
-                const auto bindGroupDesc = wgpu::BindGroupDescriptor{
-                    .label = "mesh bind group",
-                    .layout = meshGroupLayout.Get(),
-                    .entryCount = bindings.size(),
-                    .entries = bindings.data(),
-                };
+    e.meshBindGroups.reserve(e.meshes.size());
+    for (const auto& meshId : e.meshes) {
+        e.meshBindGroups.push_back(getStaticMeshBindGroup(meshId));
+    }
+}
 
-                e.meshBindGroups.push_back(device.CreateBindGroup(&bindGroupDesc));
-            }
+void Game::createSkinnedMeshBindGroups(Entity& e)
+{
+    // joint matrices are per entity, so the bind groups can't be shared
+    const auto numJoints = skeletonCache.getSkeleton(e.skeletonId).joints.size();
+    const auto jointMatricesOffset = sizeof(glm::mat3x4) * e.jointMatricesOffset;
+    const auto jointMatricesSize = sizeof(glm::mat3x4) * numJoints;
+    e.meshBindGroups.clear();
+    e.meshBindGroups.reserve(e.meshes.size());
+    for (std::size_t meshIdx = 0; meshIdx < e.meshes.size(); ++meshIdx) {
+        const auto& mesh = meshCache.getMesh(e.meshes[meshIdx]);
+        e.meshBindGroups.push_back(createSkinnedMeshBindGroup(
+            mesh, jointMatricesBuffer, jointMatricesOffset, jointMatricesSize));
+
+        auto& skinnedMesh = e.skinnedMeshes[meshIdx];
+        skinnedMesh.skinningBindGroup = skinningPass.createBindGroup(
+            device,
+            mesh,
+            jointMatricesBuffer,
+            jointMatricesOffset,
+            jointMatricesSize,
+            skinnedMesh.output);
+        if (!skinnedMesh.drawBindGroup) {
+            skinnedMesh.drawBindGroup = createSkinnedMeshDrawBindGroup(mesh, skinnedMesh.output);
         }
     }
+}
 
-    { // hierarchy
-        e.parentId = parentId;
-        for (const auto& childPtr : node.children) {
-            if (childPtr) {
-                const auto childId = createEntitiesFromNode(scene, *childPtr, e.id);
-                e.children.push_back(childId);
-            }
+wgpu::BindGroup Game::createSkinnedMeshDrawBindGroup(
+    const GPUMesh& mesh,
+    const SkinningPass::Output& skinnedMesh)
+{
+    // skinned positions and normals + mesh's tangents and uvs, drawn as a static mesh
+    const auto& tangents = mesh.attribs[2];
+    const auto& uvs = mesh.attribs[3];
+    const std::array<wgpu::BindGroupEntry, 4> bindings{{
+        {
+            .binding = 0,
+            .buffer = skinnedMesh.buffer,
+            .offset = skinnedMesh.positions.offset,
+            .size = skinnedMesh.positions.size,
+        },
+        {
+            .binding = 1,
+            .buffer = skinnedMesh.buffer,
+            .offset = skinnedMesh.normals.offset,
+            .size = skinnedMesh.normals.size,
+        },
+        {
+            .binding = 2,
+            .buffer = mesh.vertexBuffer,
+            .offset = tangents.offset,
+            .size = tangents.size,
+        },
+        {
+            .binding = 3,
+            .buffer = mesh.vertexBuffer,
+            .offset = uvs.offset,
+            .size = uvs.size,
+        },
+    }};
+
+    const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+        .label = "skinned mesh draw bind group",
+        .layout = meshGroupLayout.Get(),
+        .entryCount = bindings.size(),
+        .entries = bindings.data(),
+    };
+    return device.CreateBindGroup(&bindGroupDesc);
+}
+
+std::size_t Game::allocateJointMatrices(std::size_t numJoints)
+{
+    // bind group offsets must be aligned (alignment is in matrices)
+    // 48 byte matrices don't divide the offset alignment, hence lcm
+    const auto offsetAlignment =
+        static_cast<std::size_t>(requiredLimits.limits.minStorageBufferOffsetAlignment);
+    const auto alignment = std::lcm(sizeof(glm::mat3x4), offsetAlignment) / sizeof(glm::mat3x4);
+    const auto offset = (numJointMatrices + alignment - 1) / alignment * alignment;
+    numJointMatrices = offset + numJoints;
+
+    const auto requiredSize = sizeof(glm::mat3x4) * numJointMatrices;
+    if (!jointMatricesBuffer || requiredSize > jointMatricesBuffer.GetSize()) {
+        jointMatricesBuffer = createStorageBuffer("joint matrices buffer", requiredSize * 2);
+        // matrices are re-uploaded each frame, only bind groups need to be recreated
+        for (const auto entityId : animatedEntities) {
+            createSkinnedMeshBindGroups(*entities[entityId]);
         }
     }
+    return offset;
+}
 
-    return e.id;
+wgpu::BindGroup Game::createMeshBindGroup(const GPUMesh& mesh)
+{
+    // only positions, normals, tangents and uvs are used by static mesh pipeline
+    std::array<wgpu::BindGroupEntry, 4> bindings;
+    for (std::size_t i = 0; i < bindings.size(); ++i) {
+        const auto& attrib = mesh.attribs[i];
+        bindings[i] = {
+            .binding = static_cast<std::uint32_t>(i),
+            .buffer = mesh.vertexBuffer,
+            .offset = attrib.offset,
+            .size = attrib.size,
+        };
+    }
+
+    const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+        .label = "mesh bind group",
+        .layout = meshGroupLayout.Get(),
+        .entryCount = bindings.size(),
+        .entries = bindings.data(),
+    };
+    return device.CreateBindGroup(&bindGroupDesc);
+}
+
+wgpu::BindGroup Game::createSkinnedMeshBindGroup(
+    const GPUMesh& mesh,
+    const wgpu::Buffer& jointMatricesBuffer,
+    std::uint64_t jointMatricesOffset,
+    std::uint64_t jointMatricesSize)
+{
+    assert(mesh.hasSkeleton && mesh.attribs.size() == 6);
+    std::array<wgpu::BindGroupEntry, 7> bindings;
+    for (std::size_t i = 0; i < mesh.attribs.size(); ++i) {
+        const auto& attrib = mesh.attribs[i];
+        bindings[i] = {
+            .binding = static_cast<std::uint32_t>(i),
+            .buffer = mesh.vertexBuffer,
+            .offset = attrib.offset,
+            .size = attrib.size,
+        };
+    }
+    bindings[6] = {
+        .binding = 6,
+        .buffer = jointMatricesBuffer,
+        .offset = jointMatricesOffset,
+        .size = jointMatricesSize,
+    };
+
+    const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+        .label = "skinned mesh bind group",
+        .layout = skinnedMeshGroupLayout.Get(),
+        .entryCount = bindings.size(),
+        .entries = bindings.data(),
+    };
+    return device.CreateBindGroup(&bindGroupDesc);
 }
 
-Game::Entity& Game::makeNewEntity()
+const wgpu::BindGroup& Game::getStaticMeshBindGroup(MeshId meshId)
+{
+    auto it = staticMeshBindGroups.find(meshId);
+    if (it != staticMeshBindGroups.end()) {
+        return it->second;
+    }
+
+    const auto& mesh = meshCache.getMesh(meshId);
+    auto [newIt, inserted] =
+        staticMeshBindGroups.emplace(meshId, createMeshBindGroup(mesh));
+    assert(inserted);
+    return newIt->second;
+}
+
+Game::Entity& Game::makeNewEntity(const Transform& transform, EntityId parentId)
 {
     entities.push_back(std::make_unique<Entity>());
     auto& e = *entities.back();
     e.id = entities.size() - 1;
+
+    const auto nodeId = transformHierarchy.add(transform, parentId);
+    assert(nodeId == e.id);
+
     return e;
 }
 
 Game::Entity& Game::findEntityByName(std::string_view name) const
+{
+    if (auto* e = tryFindEntityByName(name)) {
+        return *e;
+    }
+
+    throw std::runtime_error(std::string{"failed to find entity with name "} + std::string{name});
+}
+
+Game::Entity* Game::tryFindEntityByName(std::string_view name) const
 {
     for (const auto& ePtr : entities) {
         if (ePtr->tag == name) {
-            return *ePtr;
+            return ePtr.get();
         }
     }
-
-    throw std::runtime_error(std::string{"failed to find entity with name "} + std::string{name});
+    return nullptr;
 }
 
 void Game::createSkyboxDrawingPipeline()
@@ -1406,6 +1864,7 @@ void Game::createSprite(Sprite& sprite, const std::filesystem::path& texturePath
             .device = device,
             .queue = queue,
             .mipMapGenerator = mipMapGenerator,
+            .uploadManager = uploadManager,
         };
         sprite.texture =
             util::loadTexture(loadCtx, texturePath, wgpu::TextureFormat::RGBA8UnormSrgb, false);
@@ -1420,7 +1879,7 @@ void Game::createSprite(Sprite& sprite, const std::filesystem::path& texturePath
 
         sprite.vertexBuffer = device.CreateBuffer(&bufferDesc);
 
-        queue.WriteBuffer(sprite.vertexBuffer, 0, pointData.data(), bufferDesc.size);
+        uploadManager.uploadBuffer(sprite.vertexBuffer, 0, pointData.data(), bufferDesc.size);
     }
 
     { // index buffer
@@ -1432,7 +1891,7 @@ void Game::createSprite(Sprite& sprite, const std::filesystem::path& texturePath
 
         sprite.indexBuffer = device.CreateBuffer(&bufferDesc);
 
-        queue.WriteBuffer(sprite.indexBuffer, 0, indexData.data(), bufferDesc.size);
+        uploadManager.uploadBuffer(sprite.indexBuffer, 0, indexData.data(), bufferDesc.size);
     }
 
     { // bind group
@@ -1568,6 +2027,22 @@ void Game::update(float dt)
 {
     ZoneScopedN("Update");
 
+    // everything copied through staging buffers during the previous frame
+    lastFrameUploadStats = uploadManager.getStats();
+    uploadManager.resetStats();
+    TracyPlot("Staging bytes", static_cast<std::int64_t>(lastFrameUploadStats.uploadedBytes));
+    TracyPlot("Staging stalls", static_cast<std::int64_t>(lastFrameUploadStats.numStalls));
+    TracyPlot(
+        "Staging buffers", static_cast<std::int64_t>(lastFrameUploadStats.numStagingBuffers));
+
+    // mips of textures uploaded below are generated by one submit in render
+    mipMapGenerator.beginBatch();
+    numUploadedBytes = asyncLoader.processUploads(AsyncLoader::UploadBudget{
+        .maxBytes = uploadBudgetBytes,
+        .maxTimeMs = uploadBudgetMs,
+    });
+    TracyPlot("Uploaded bytes", static_cast<std::int64_t>(numUploadedBytes));
+
     cameraController.update(camera, dt);
 
     { // per frame data
@@ -1580,61 +2055,148 @@ void Game::update(float dt)
             .pixelSize =
                 glm::vec2(1.f / (float)params.screenWidth, 1.f / (float)params.screenHeight),
         };
-        queue.WriteBuffer(frameDataBuffer, 0, &ud, sizeof(PerFrameData));
+        uploadManager.uploadBuffer(frameDataBuffer, 0, &ud, sizeof(PerFrameData));
     }
 
-    { // update cato's animation
-
-        auto& e = findEntityByName("Cato");
-        {
-            ZoneScopedN("Skeletal animation");
-            e.skeletonAnimator.update(e.skeleton, dt);
-        }
-        e.uploadJointMatricesToGPU(queue, e.skeletonAnimator.getJointMatrices());
-    }
+    updateAnimations(dt);
 
     updateEntityTransforms();
 
     updateDevTools(dt);
 }
 
-void Game::Entity::uploadJointMatricesToGPU(
-    const wgpu::Queue& queue,
-    const std::vector<glm::mat4>& jointMatrices) const
+void Game::updateAnimations(float dt)
 {
-    assert(jointMatrices.size() == skeleton.joints.size());
-    queue.WriteBuffer(
-        jointMatricesDataBuffer, 0, jointMatrices.data(), sizeof(glm::mat4) * jointMatrices.size());
+    ZoneScopedN("Skeletal animation");
+    TracyPlot("Animated entities", static_cast<std::int64_t>(animatedEntities.size()));
+    if (animatedEntities.empty()) {
+        return;
+    }
+    ++animationTick;
+
+    { // find which entities are evaluated this tick and which of them share poses
+        ZoneScopedN("Animation LOD and pose cache lookup");
+        poseCache.clear();
+        numEntitiesPerAnimationLOD.fill(0);
+        animationUpdates.resize(animatedEntities.size());
+        for (std::size_t i = 0; i < animatedEntities.size(); ++i) {
+            auto& e = *entities[animatedEntities[i]];
+            auto& animator = e.skeletonAnimator;
+            animator.advance(dt);
+
+            const auto lodIdx = calculateAnimationLOD(e);
+            ++numEntitiesPerAnimationLOD[lodIdx];
+            const auto& lod = animationLODs[lodIdx];
+
+            auto& update = animationUpdates[i];
+            update.poseOwner = i;
+            update.maxJointDepth = (lod.maxJointDepth < 0) ?
+                                       SkeletonAnimator::ALL_JOINTS_DEPTH :
+                                       static_cast<std::uint16_t>(lod.maxJointDepth);
+            // entities with the same update interval are spread between ticks
+            update.evaluate =
+                animator.getAnimation() && (animationTick + i) % lod.updateInterval == 0;
+            if (update.evaluate && usePoseCache) {
+                update.poseOwner = poseCache.findOrAdd(
+                    e.skeletonId,
+                    *animator.getAnimation(),
+                    animator.getProgress(),
+                    update.maxJointDepth,
+                    i);
+            }
+        }
+        if (usePoseCache) {
+            TracyPlot("Pose cache hits", static_cast<std::int64_t>(poseCache.getStats().hits));
+            TracyPlot(
+                "Pose cache misses", static_cast<std::int64_t>(poseCache.getStats().misses));
+        }
+    }
+
+    auto* jointMatrices = static_cast<glm::mat3x4*>(uploadManager.allocateBufferUpload(
+        jointMatricesBuffer, 0, sizeof(glm::mat3x4) * numJointMatrices));
+    const auto copyJointMatrices = [jointMatrices](const Entity& e, const Entity& poseOwner) {
+        const auto& matrices = poseOwner.skeletonAnimator.getJointMatrices();
+        std::memcpy(
+            jointMatrices + e.jointMatricesOffset,
+            matrices.data(),
+            sizeof(glm::mat3x4) * matrices.size());
+    };
+
+    // owners are evaluated first, so that others can copy from them
+    // entities which are not evaluated this tick upload their previous pose
+    // (for pose cache hits it's the owner's one, which is copied into their animators)
+    std::atomic<std::size_t> numSampledJoints{0};
+    jobSystem.parallelFor(animatedEntities.size(), 4, [&](std::size_t begin, std::size_t end) {
+        std::size_t numSampled = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto& update = animationUpdates[i];
+            if (update.poseOwner != i) {
+                continue;
+            }
+            auto& e = *entities[animatedEntities[i]];
+            if (update.evaluate) {
+                const auto time = e.skeletonAnimator.getProgress();
+                numSampled += e.skeletonAnimator.evaluate(
+                    skeletonCache.getSkeleton(e.skeletonId),
+                    usePoseCache ? poseCache.quantizeTime(time) : time,
+                    update.maxJointDepth);
+            }
+            copyJointMatrices(e, e);
+        }
+        numSampledJoints += numSampled;
+    });
+    jobSystem.parallelFor(animatedEntities.size(), 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto poseOwner = animationUpdates[i].poseOwner;
+            if (poseOwner != i) {
+                auto& e = *entities[animatedEntities[i]];
+                e.skeletonAnimator.copyJointMatrices(
+                    entities[animatedEntities[poseOwner]]->skeletonAnimator);
+                copyJointMatrices(e, e);
+            }
+        }
+    });
+
+    numJointsEvaluated = numSampledJoints;
+    TracyPlot("Joints evaluated", static_cast<std::int64_t>(numJointsEvaluated));
 }
 
-void Game::updateEntityTransforms()
+std::size_t Game::calculateAnimationLOD(const Entity& e) const
 {
-    ZoneScopedN("Update entity transforms");
-    const auto I = glm::mat4{1.f};
-    for (auto& ePtr : entities) {
-        auto& e = *ePtr;
-        if (e.parentId == NULL_MESH_ID) {
-            updateEntityTransforms(e, I);
+    if (!animationLOD || e.meshes.empty()) {
+        return 0;
+    }
+
+    // bounding sphere is in bind pose, but it's good enough for picking LOD
+    const auto sphere = math::transformSphere(
+        meshCache.getMesh(e.meshes[0]).boundingSphere,
+        transformHierarchy.getWorldTransform(e.id));
+
+    const auto distance = glm::length(sphere.center - camera.getPosition());
+    if (distance <= sphere.radius) {
+        return 0;
+    }
+    // fraction of screen height covered by the sphere
+    const auto screenSize = sphere.radius / (distance * std::tan(camera.getFOVY() * 0.5f));
+    for (std::size_t lodIdx = 0; lodIdx < animationLODs.size() - 1; ++lodIdx) {
+        if (screenSize >= animationLODs[lodIdx].minScreenSize) {
+            return lodIdx;
         }
     }
+    return animationLODs.size() - 1;
 }
 
-void Game::updateEntityTransforms(Entity& e, const glm::mat4& parentWorldTransform)
+void Game::updateEntityTransforms()
 {
-    const auto prevTransform = e.worldTransform;
-    e.worldTransform = parentWorldTransform * e.transform.asMatrix();
-    if (e.worldTransform == prevTransform) {
-        return;
-    }
+    ZoneScopedN("Update entity transforms");
 
-    MeshData md{
-        .model = e.worldTransform,
-    };
-    queue.WriteBuffer(e.meshDataBuffer, 0, &md, sizeof(MeshData));
+    numTransformsUpdated = transformHierarchy.update();
+    TracyPlot("Transforms recalculated", static_cast<std::int64_t>(numTransformsUpdated));
 
-    for (const auto& childId : e.children) {
-        auto& child = *entities[childId];
-        updateEntityTransforms(child, e.worldTransform);
+    if (numTransformsUpdated > 0) {
+        // world transforms are uploaded to meshDataBuffer as is
+        meshDataDirtyBegin = std::min(meshDataDirtyBegin, transformHierarchy.getChangedBegin());
+        meshDataDirtyEnd = std::max(meshDataDirtyEnd, transformHierarchy.getChangedEnd());
     }
 }
 
@@ -1649,16 +2211,23 @@ void updateSkeletonDisplayUI(const Skeleton& skeleton, JointId jointId)
                                ImGuiTreeNodeFlags_OpenOnDoubleClick |
                                ImGuiTreeNodeFlags_DefaultOpen;
 
-    const auto& joint = skeleton.joints[jointId];
-    const auto& children = skeleton.hierarchy[jointId].children;
-    if (children.empty()) {
+    // children always come after their parent
+    const auto numJoints = static_cast<JointId>(skeleton.parents.size());
+    const auto isChild = [&](JointId id) { return skeleton.parents[id] == jointId; };
+    bool hasChildren = false;
+    for (JointId id = jointId + 1; id < numJoints && !hasChildren; ++id) {
+        hasChildren = isChild(id);
+    }
+    if (!hasChildren) {
         flags |= ImGuiTreeNodeFlags_Leaf;
     }
 
     const auto label = jointName + ", id = " + std::to_string(jointId);
     if (ImGui::TreeNodeEx(label.c_str(), flags)) {
-        for (const auto& childIdx : children) {
-            updateSkeletonDisplayUI(skeleton, childIdx);
+        for (JointId id = jointId + 1; id < numJoints; ++id) {
+            if (isChild(id)) {
+                updateSkeletonDisplayUI(skeleton, id);
+            }
         }
         ImGui::TreePop();
     }
@@ -1688,6 +2257,115 @@ void Game::updateDevTools(float dt)
             initSwapChain(vSync);
         }
         ImGui::Checkbox("Frame limit", &frameLimit);
+        ImGui::Text(
+            "Job system threads: %d (+%d for loading)",
+            (int)jobSystem.getNumThreads(),
+            (int)loaderJobSystem.getNumThreads() - 1);
+        ImGui::Text(
+            "Async loading: %d tasks, %d uploads pending",
+            (int)asyncLoader.getNumPendingTasks(),
+            (int)asyncLoader.getNumPendingUploads());
+        ImGui::Text("Uploaded: %.2f MB", (float)numUploadedBytes / (1024.f * 1024.f));
+        int uploadBudgetMB = static_cast<int>(uploadBudgetBytes / (1024 * 1024));
+        if (ImGui::SliderInt("Upload budget (MB)", &uploadBudgetMB, 1, 64)) {
+            uploadBudgetBytes = static_cast<std::size_t>(uploadBudgetMB) * 1024 * 1024;
+        }
+        ImGui::SliderFloat("Upload budget (ms)", &uploadBudgetMs, 0.5f, 16.f);
+        ImGui::Text(
+            "Staging: %.2f MB in %d copies, %d stalls, %d buffers (%d released)",
+            (float)lastFrameUploadStats.uploadedBytes / (1024.f * 1024.f),
+            (int)lastFrameUploadStats.numCopies,
+            (int)lastFrameUploadStats.numStalls,
+            (int)lastFrameUploadStats.numStagingBuffers,
+            (int)lastFrameUploadStats.numReleasedBuffers);
+        ImGui::Checkbox("Compute mip generation", &mipMapGenerator.useCompute);
+        ImGui::Text("BC texture compression: %s", textureCompressionBC ? "yes" : "no");
+        ImGui::Text(
+            "Mips: %d textures, %d submits, %d passes, %d bind groups, %d views",
+            (int)mipMapGenerator.getStats().numTextures,
+            (int)mipMapGenerator.getStats().numSubmits,
+            (int)mipMapGenerator.getStats().numPasses,
+            (int)mipMapGenerator.getStats().numBindGroups,
+            (int)mipMapGenerator.getStats().numTextureViews);
+        if (const auto& mipStats = mipMapGenerator.getStats(); mipStats.numTextures > 0) {
+            const auto n = static_cast<float>(mipStats.numTextures);
+            ImGui::Text(
+                "Mips per texture: %.2f passes, %.2f bind groups, %.2f views",
+                (float)mipStats.numPasses / n,
+                (float)mipStats.numBindGroups / n,
+                (float)mipStats.numTextureViews / n);
+        }
+        if (mipMapGenerator.isGPUTimerEnabled()) {
+            const auto timings = mipMapGenerator.getGPUTimings();
+            const auto perTexture = [](double ms, std::size_t numTextures) {
+                return numTextures > 0 ? (float)(ms / (double)numTextures) : 0.f;
+            };
+            ImGui::Text(
+                "Mips GPU: compute %.2f ms (%.3f per texture), render %.2f ms (%.3f per texture)",
+                (float)timings.computeMs,
+                perTexture(timings.computeMs, timings.numComputeTextures),
+                (float)timings.renderMs,
+                perTexture(timings.renderMs, timings.numRenderTextures));
+        }
+        {
+            const auto textureCacheStats = textureCache.getStats();
+            ImGui::Text(
+                "Texture cache: %d textures, %d hits, %d misses, %.2f MB saved",
+                (int)textureCache.getNumTextures(),
+                (int)textureCacheStats.hits,
+                (int)textureCacheStats.misses,
+                (float)textureCacheStats.savedBytes / (1024.f * 1024.f));
+        }
+        ImGui::Text(
+            "Draws: %d (%d before instancing)",
+            (int)instancedDrawCommands.size(),
+            (int)drawCommands.size());
+        ImGui::Text("Transforms recalculated: %d", (int)numTransformsUpdated);
+        ImGui::Checkbox("Frustum culling", &frustumCulling);
+        if (!vertexSkinningSupported) {
+            ImGui::Text("GPU skinning (compute): always on");
+        } else if (ImGui::Checkbox("GPU skinning (compute)", &gpuSkinning)) {
+            gpuTimer.resetTotals();
+        }
+        if (gpuTimer.isEnabled()) {
+            ImGui::Text(
+                "GPU: skinning %.3f ms (avg %.3f), meshes %.3f ms (avg %.3f)",
+                gpuTimer.getSection(GPU_TIMER_SKINNING).lastMs,
+                gpuTimer.getAverageMs(GPU_TIMER_SKINNING),
+                gpuTimer.getSection(GPU_TIMER_MESH_DRAW).lastMs,
+                gpuTimer.getAverageMs(GPU_TIMER_MESH_DRAW));
+            if (ImGui::Button("Reset GPU timings")) {
+                gpuTimer.resetTotals();
+            }
+        }
+        ImGui::Checkbox("Pose cache", &usePoseCache);
+        if (usePoseCache) {
+            ImGui::Text(
+                "Poses: %d evaluated, %d shared",
+                (int)poseCache.getStats().misses,
+                (int)poseCache.getStats().hits);
+        }
+        ImGui::Text("Joints evaluated: %d", (int)numJointsEvaluated);
+        if (ImGui::CollapsingHeader("Animation LOD")) {
+            ImGui::Checkbox("Enabled", &animationLOD);
+            for (std::size_t lodIdx = 0; lodIdx < animationLODs.size(); ++lodIdx) {
+                auto& lod = animationLODs[lodIdx];
+                ImGui::PushID(static_cast<int>(lodIdx));
+                ImGui::Text(
+                    "LOD %d: every %d ticks, %d entities",
+                    (int)lodIdx,
+                    (int)lod.updateInterval,
+                    (int)numEntitiesPerAnimationLOD[lodIdx]);
+                // the last LOD is used for everything smaller than the previous one
+                if (lodIdx + 1 < animationLODs.size()) {
+                    ImGui::SliderFloat("Min screen size", &lod.minScreenSize, 0.f, 1.f);
+                }
+                ImGui::SliderInt("Max joint depth (-1 = all)", &lod.maxJointDepth, -1, 16);
+                ImGui::PopID();
+            }
+        }
+        ImGui::Text(
+            "Meshes: %d visible, %d culled", (int)drawCommands.size(), (int)numCulledMeshes);
 
         const auto cameraPos = camera.getPosition();
         ImGui::Text("Camera pos: %.2f, %.2f, %.2f", cameraPos.x, cameraPos.y, cameraPos.z);
@@ -1698,12 +2376,15 @@ void Game::updateDevTools(float dt)
     ImGui::End();
 
     ImGui::Begin("Animation");
-    {
-        auto& e = findEntityByName("Cato");
+    if (auto* cato = tryFindEntityByName("Cato")) {
+        auto& e = *cato;
+        const auto& skeleton = skeletonCache.getSkeleton(e.skeletonId);
+        const auto& animationIds = animationCache.getSkeletonAnimations(e.skeletonId);
         if (ImGui::BeginCombo("Animation", e.skeletonAnimator.getCurrentAnimationName().c_str())) {
-            for (const auto& [an, a] : e.animations) {
-                if (ImGui::Selectable(an.c_str())) {
-                    e.skeletonAnimator.setAnimation(e.skeleton, a);
+            for (const auto animationId : animationIds) {
+                const auto& animation = animationCache.getAnimation(animationId);
+                if (ImGui::Selectable(animation.name.c_str())) {
+                    e.skeletonAnimator.setAnimation(skeleton, animation);
                 }
             }
             ImGui::EndCombo();
@@ -1715,8 +2396,15 @@ void Game::updateDevTools(float dt)
             e.skeletonAnimator.setNormalizedProgress(timeNormalized);
         }
 
+        // skeleton and clips are shared, only animator state is per entity
+        ImGui::Text(
+            "Entity memory: %d bytes (shared: %d joints, %d clips)",
+            (int)(sizeof(Entity) + e.skeletonAnimator.getMemoryUsage()),
+            (int)skeleton.joints.size(),
+            (int)animationIds.size());
+
         if (ImGui::CollapsingHeader("Skeleton")) {
-            updateSkeletonDisplayUI(e.skeleton);
+            updateSkeletonDisplayUI(skeleton);
         }
     }
 
@@ -1728,6 +2416,10 @@ void Game::updateDevTools(float dt)
 void Game::render()
 {
     generateDrawList();
+    uploadInstanceData();
+    // everything written by update and uploadInstanceData is copied before the frame's commands
+    uploadManager.flush(queue);
+    mipMapGenerator.flushBatch(device, queue);
 
     ZoneScopedN("Draw");
 
@@ -1743,6 +2435,33 @@ void Game::render()
     const auto commandEncoderDesc = wgpu::CommandEncoderDescriptor{};
     const auto encoder = device.CreateCommandEncoder(&commandEncoderDesc);
 
+    if (gpuSkinning) {
+        ZoneScopedN("Skinning pass");
+        skinningDispatches.clear();
+        for (const auto entityId : animatedEntities) {
+            auto& e = *entities[entityId];
+            // outputs of entities which weren't evaluated this tick are still valid.
+            // Entities outside of the frustum are skinned too: skinned meshes are
+            // always drawn (see generateDrawList), so their outputs must be current
+            const auto poseVersion = e.skeletonAnimator.getPoseVersion();
+            if (e.skinnedPoseVersion == poseVersion) {
+                continue;
+            }
+            e.skinnedPoseVersion = poseVersion;
+            for (const auto& skinnedMesh : e.skinnedMeshes) {
+                skinningDispatches.push_back(SkinningPass::Dispatch{
+                    .bindGroup = skinnedMesh.skinningBindGroup,
+                    .numVertices = skinnedMesh.output.numVertices,
+                    .wideSkinAttribs = skinnedMesh.output.wideSkinAttribs,
+                });
+            }
+        }
+        TracyPlot("Skinning dispatches", static_cast<std::int64_t>(skinningDispatches.size()));
+        gpuTimer.begin(encoder, GPU_TIMER_SKINNING);
+        skinningPass.record(encoder, skinningDispatches);
+        gpuTimer.end(encoder, GPU_TIMER_SKINNING);
+    }
+
     { // draw sky
         const auto mainScreenAttachment = wgpu::RenderPassColorAttachment{
             .view = screenTextureView,
@@ -1762,9 +2481,11 @@ void Game::render()
             const auto renderPass = encoder.BeginRenderPass(&renderPassDesc);
             renderPass.PushDebugGroup("Sky pass");
 
-            renderPass.SetPipeline(skyboxPipeline);
-            renderPass.SetBindGroup(0, skyboxBindGroup);
-            renderPass.Draw(3);
+            if (skyboxBindGroup) {
+                renderPass.SetPipeline(skyboxPipeline);
+                renderPass.SetBindGroup(0, skyboxBindGroup);
+                renderPass.Draw(3);
+            }
 
             renderPass.PopDebugGroup();
             renderPass.End();
@@ -1797,17 +2518,24 @@ void Game::render()
         {
             ZoneScopedN("Mesh draw render pass");
 
+            gpuTimer.begin(encoder, GPU_TIMER_MESH_DRAW);
             const auto renderPass = encoder.BeginRenderPass(&renderPassDesc);
             renderPass.PushDebugGroup("Draw meshes");
 
-            renderPass.SetPipeline(meshPipeline);
             renderPass.SetBindGroup(0, perFrameBindGroup);
 
+            auto prevPipelineId = MeshPipelineId::Count;
             auto prevMaterialIdx = NULL_MATERIAL_ID;
             auto prevMeshId = NULL_MESH_ID;
 
-            for (const auto& dcIdx : sortedDrawCommands) {
-                const auto& dc = drawCommands[dcIdx];
+            for (const auto& idc : instancedDrawCommands) {
+                const auto& dc = drawCommands[idc.drawCommandIdx];
+
+                if (dc.pipelineId != prevPipelineId) {
+                    prevPipelineId = dc.pipelineId;
+                    renderPass.SetPipeline(meshPipelines[(std::size_t)dc.pipelineId]);
+                    // frame and material bind groups stay bound, their layouts are shared
+                }
 
                 if (dc.mesh.materialId != prevMaterialIdx) {
                     prevMaterialIdx = dc.mesh.materialId;
@@ -1823,11 +2551,13 @@ void Game::render()
                         dc.mesh.indexBuffer, wgpu::IndexFormat::Uint16, 0, wgpu::kWholeSize);
                 }
 
-                renderPass.DrawIndexed(dc.mesh.indexBufferSize, 1, 0, 0, 0);
+                renderPass.DrawIndexed(
+                    dc.mesh.indexBufferSize, idc.instanceCount, 0, 0, idc.firstInstance);
             }
 
             renderPass.PopDebugGroup();
             renderPass.End();
+            gpuTimer.end(encoder, GPU_TIMER_MESH_DRAW);
         }
     }
 
@@ -1913,9 +2643,17 @@ void Game::render()
     }
 
     // submit
+    gpuTimer.resolve(encoder);
     const auto cmdBufferDesc = wgpu::CommandBufferDescriptor{};
     const auto command = encoder.Finish(&cmdBufferDesc);
     queue.Submit(1, &command);
+    gpuTimer.readback();
+
+    if (gpuTimer.isEnabled()) {
+        // results arrive a few frames late
+        TracyPlot("GPU skinning (ms)", gpuTimer.getSection(GPU_TIMER_SKINNING).lastMs);
+        TracyPlot("GPU mesh draw (ms)", gpuTimer.getSection(GPU_TIMER_MESH_DRAW).lastMs);
+    }
 
     // flush
     swapChain->Present();
@@ -1929,41 +2667,185 @@ void Game::generateDrawList()
 
     drawCommands.clear();
 
+    { // frustum culling
+        ZoneScopedN("Frustum culling");
+
+        // entity -> index of its first mesh's AABB
+        entityBoundingBoxOffsets.resize(entities.size());
+        std::size_t numBoxes{0};
+        for (const auto& ePtr : entities) {
+            entityBoundingBoxOffsets[ePtr->id] = numBoxes;
+            numBoxes += ePtr->meshes.size();
+        }
+
+        worldBoundingBoxes.resize(numBoxes);
+        jobSystem.parallelFor(entities.size(), 128, [this](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                const auto& e = *entities[i];
+                const auto& worldTransform = transformHierarchy.getWorldTransform(e.id);
+                auto boxIdx = entityBoundingBoxOffsets[i];
+                for (const auto& meshId : e.meshes) {
+                    const auto& mesh = meshCache.getMesh(meshId);
+                    const auto aabb = math::transformAABB(mesh.boundingBox, worldTransform);
+                    worldBoundingBoxes.set(boxIdx++, aabb);
+                }
+            }
+        });
+
+        const auto frustum = math::createFrustumFromViewProj(camera.getViewProj());
+        meshVisibility.resize(numBoxes);
+        jobSystem.parallelFor(numBoxes, 512, [this, &frustum](std::size_t begin, std::size_t end) {
+            math::cullAABBs(frustum, worldBoundingBoxes, meshVisibility, begin, end);
+        });
+    }
+
+    drawSortKeys.clear();
+
+    const auto cameraPos = camera.getPosition();
+    const auto cameraFront = camera.getTransform().getLocalFront();
+    const auto zFar = camera.getZFar();
+
+    std::size_t boxIdx{0};
     for (const auto& ePtr : entities) {
         const auto& e = *ePtr;
 
-        for (std::size_t meshIdx = 0; meshIdx < e.meshes.size(); ++meshIdx) {
+        for (std::size_t meshIdx = 0; meshIdx < e.meshes.size(); ++meshIdx, ++boxIdx) {
             const auto& mesh = meshCache.getMesh(e.meshes[meshIdx]);
-            // TODO: draw frustum culling here
-            const auto& material = materialCache.getMaterial(mesh.materialId);
+            // bounding boxes are calculated in bind pose, so skinned meshes
+            // can go outside of them - don't cull them for now
+            if (frustumCulling && !meshVisibility[boxIdx] && !mesh.hasSkeleton) {
+                continue;
+            }
+
+            const auto center = glm::vec3{
+                worldBoundingBoxes.centerX[boxIdx],
+                worldBoundingBoxes.centerY[boxIdx],
+                worldBoundingBoxes.centerZ[boxIdx],
+            };
+            // meshes skinned by the compute pass are drawn as static ones
+            auto pipelineId = MeshPipelineId::Static;
+            if (mesh.hasSkeleton && !gpuSkinning) {
+                pipelineId = mesh.wideSkinAttribs ? MeshPipelineId::SkinnedWide :
+                                                    MeshPipelineId::Skinned;
+            }
+
+            const auto depth = glm::dot(center - cameraPos, cameraFront) / zFar;
+            drawSortKeys.push_back(util::SortKey{
+                .key = makeDrawSortKey(
+                    static_cast<std::uint32_t>(pipelineId),
+                    mesh.materialId,
+                    e.meshes[meshIdx],
+                    depth),
+                .value = static_cast<std::uint32_t>(drawCommands.size()),
+            });
+
             drawCommands.push_back(DrawCommand{
                 .mesh = mesh,
-                .meshBindGroup = e.meshBindGroups[meshIdx],
+                .pipelineId = pipelineId,
+                .meshBindGroup = (mesh.hasSkeleton && gpuSkinning) ?
+                                     e.skinnedMeshes[meshIdx].drawBindGroup :
+                                     e.meshBindGroups[meshIdx],
                 .meshId = e.meshes[meshIdx],
+                .entityId = e.id,
             });
         }
     }
 
+    numCulledMeshes = worldBoundingBoxes.size() - drawCommands.size();
+    TracyPlot("Visible meshes", static_cast<std::int64_t>(drawCommands.size()));
+    TracyPlot("Culled meshes", static_cast<std::int64_t>(numCulledMeshes));
+
     sortDrawList();
 }
 
 void Game::sortDrawList()
 {
-    sortedDrawCommands.clear();
-    sortedDrawCommands.resize(drawCommands.size());
-    std::iota(sortedDrawCommands.begin(), sortedDrawCommands.end(), 0);
-
-    std::sort(
-        sortedDrawCommands.begin(),
-        sortedDrawCommands.end(),
-        [this](const auto& i1, const auto& i2) {
-            const auto& dc1 = drawCommands[i1];
-            const auto& dc2 = drawCommands[i2];
-            if (dc1.mesh.materialId == dc2.mesh.materialId) {
-                return dc1.meshId < dc2.meshId;
+    {
+        ZoneScopedN("Sort draw list");
+        util::radixSort(drawSortKeys, drawSortKeysTmp);
+    }
+
+    // collapse runs of draw commands with the same mesh, material and bind group
+    // into instanced draws
+    // note that skinned meshes have per-entity bind groups, so draws of different
+    // skinned entities with the same mesh are never merged
+    instancedDrawCommands.clear();
+    instanceData.clear();
+    instanceData.reserve(drawSortKeys.size());
+    for (const auto& sortKey : drawSortKeys) {
+        const auto dcIdx = static_cast<std::size_t>(sortKey.value);
+        const auto& dc = drawCommands[dcIdx];
+        const auto instanceIdx = static_cast<std::uint32_t>(instanceData.size());
+        instanceData.push_back(static_cast<std::uint32_t>(dc.entityId));
+
+        if (!instancedDrawCommands.empty()) {
+            auto& prev = instancedDrawCommands.back();
+            const auto& prevDC = drawCommands[prev.drawCommandIdx];
+            if (prevDC.pipelineId == dc.pipelineId && prevDC.meshId == dc.meshId &&
+                prevDC.mesh.materialId == dc.mesh.materialId &&
+                prevDC.meshBindGroup.Get() == dc.meshBindGroup.Get()) {
+                ++prev.instanceCount;
+                continue;
             }
-            return dc1.mesh.materialId < dc2.mesh.materialId;
+        }
+
+        instancedDrawCommands.push_back(InstancedDrawCommand{
+            .drawCommandIdx = dcIdx,
+            .firstInstance = instanceIdx,
+            .instanceCount = 1,
         });
+    }
+
+    TracyPlot("Draws (before instancing)", static_cast<std::int64_t>(drawCommands.size()));
+    TracyPlot(
+        "Draws (after instancing)", static_cast<std::int64_t>(instancedDrawCommands.size()));
+}
+
+void Game::uploadInstanceData()
+{
+    ZoneScopedN("Upload instance data");
+
+    const auto worldTransforms = transformHierarchy.getWorldTransforms();
+    static_assert(sizeof(MeshData) == sizeof(glm::mat4));
+
+    bool bufferRecreated = false;
+    if (sizeof(MeshData) * worldTransforms.size() > meshDataBuffer.GetSize()) {
+        meshDataBuffer = createStorageBuffer(
+            "mesh data buffer", sizeof(MeshData) * worldTransforms.size() * 2);
+        meshDataDirtyBegin = 0;
+        meshDataDirtyEnd = worldTransforms.size();
+        bufferRecreated = true;
+    }
+    if (sizeof(std::uint32_t) * instanceData.size() > instanceDataBuffer.GetSize()) {
+        instanceDataBuffer = createStorageBuffer(
+            "instance data buffer", sizeof(std::uint32_t) * instanceData.size() * 2);
+        bufferRecreated = true;
+    }
+    if (bufferRecreated) {
+        createPerFrameBindGroup();
+    }
+
+    // all changed model matrices are uploaded with one write
+    if (meshDataDirtyBegin < meshDataDirtyEnd) {
+        uploadManager.uploadBuffer(
+            meshDataBuffer,
+            sizeof(MeshData) * meshDataDirtyBegin,
+            &worldTransforms[meshDataDirtyBegin],
+            sizeof(MeshData) * (meshDataDirtyEnd - meshDataDirtyBegin));
+        TracyPlot(
+            "Mesh data upload (matrices)",
+            static_cast<std::int64_t>(meshDataDirtyEnd - meshDataDirtyBegin));
+        meshDataDirtyBegin = std::numeric_limits<std::size_t>::max();
+        meshDataDirtyEnd = 0;
+    }
+
+    if (!instanceData.empty()) {
+        uploadManager.uploadBuffer(
+            instanceDataBuffer,
+            0,
+            instanceData.data(),
+            sizeof(std::uint32_t) * instanceData.size());
+    }
 }
 
 void Game::quit()
@@ -1975,6 +2857,14 @@ void Game::cleanup()
 {
     shutdownImGui();
 
+    // load tasks could wait for decoding, which waits for uploads which won't happen
+    imageDecodePool.shutdown();
+    asyncLoader.shutdown();
+    loaderJobSystem.shutdown();
+    jobSystem.shutdown();
+    uploadManager.cleanup();
+    gpuTimer.cleanup();
+
     swapChain.reset();
     surface.reset();
 
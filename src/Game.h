@@ -1,24 +1,45 @@
 #pragma once
 
+#include <array>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <string>
+#include <unordered_map>
 
 #include <webgpu/webgpu_cpp.h>
 
 #include <Graphics/Camera.h>
 #include <Graphics/GPUMesh.h>
+#include <Graphics/GPUTimer.h>
 #include <Graphics/Material.h>
 #include <Graphics/MipMapGenerator.h>
 #include <Graphics/Scene.h>
 #include <Graphics/SkeletonAnimator.h>
-
+#include <Graphics/SkinningPass.h>
+#include <Graphics/UploadManager.h>
+#include <Jobs/AsyncLoader.h>
+#include <Jobs/ImageDecodePool.h>
+#include <Jobs/JobSystem.h>
+#include <Math/Frustum.h>
+#include <Math/TransformHierarchy.h>
+#include <util/RadixSort.h>
+
+#include "AnimationCache.h"
 #include "FreeCameraController.h"
 #include "MaterialCache.h"
 #include "MeshCache.h"
+#include "PoseCache.h"
+#include "SkeletonCache.h"
+#include "TextureCache.h"
 
 struct SDL_Window;
 
+namespace util
+{
+struct LoadContext;
+}
+
 class Game {
 public:
     struct Params {
@@ -28,6 +49,16 @@ public:
         int screenHeight = 960;
 
         std::string windowTitle = "Game";
+
+        // use software adapter (SwiftShader), e.g. for running without a GPU
+        bool forceFallbackAdapter = false;
+        // use BC-compressed textures if the adapter supports them, otherwise
+        // they're transcoded to RGBA8 when loaded
+        bool textureCompression = true;
+        // measure GPU time of render passes with timestamp queries (if supported)
+        bool gpuTiming = false;
+        // number of additional Catos spawned for animation/skinning stress tests
+        int crowdSize = 0;
     };
 
     static const std::size_t NULL_ENTITY_ID = std::numeric_limits<std::size_t>::max();
@@ -38,37 +69,54 @@ public:
         EntityId id{NULL_ENTITY_ID};
         std::string tag;
 
-        // transform
-        Transform transform; // local (relative to parent)
-        glm::mat4 worldTransform{1.f};
-
-        // hierarchy
-        EntityId parentId{NULL_ENTITY_ID};
-        std::vector<EntityId> children;
+        // transform and hierarchy are stored in Game::transformHierarchy (node id = entity id)
 
         // mesh (only one mesh per entity supported for now)
         std::vector<MeshId> meshes;
         std::vector<wgpu::BindGroup> meshBindGroups;
-        wgpu::Buffer meshDataBuffer; // where model matrix is stored
 
-        // skeleton
-        Skeleton skeleton;
-        wgpu::Buffer jointMatricesDataBuffer;
+        // skeleton (shared, see Game::skeletonCache)
+        SkeletonId skeletonId{0};
+        // index of the first joint matrix in Game::jointMatricesBuffer
+        std::size_t jointMatricesOffset{0};
         bool hasSkeleton{false};
 
-        // animation
+        // one per mesh, used when meshes are skinned by Game::skinningPass
+        struct SkinnedMesh {
+            SkinningPass::Output output;
+            wgpu::BindGroup skinningBindGroup;
+            wgpu::BindGroup drawBindGroup; // draws output as a static mesh
+        };
+        std::vector<SkinnedMesh> skinnedMeshes;
+        // skeletonAnimator's pose version which skinnedMeshes were last skinned
+        // with, their outputs stay valid until the pose changes
+        std::uint32_t skinnedPoseVersion{std::numeric_limits<std::uint32_t>::max()};
+
+        // animation (clips are shared, see Game::animationCache)
         SkeletonAnimator skeletonAnimator;
-        std::unordered_map<std::string, SkeletalAnimation> animations;
+    };
 
-        void uploadJointMatricesToGPU(
-            const wgpu::Queue& queue,
-            const std::vector<glm::mat4>& jointMatrices) const;
+    // stored in the highest bits of draw sort keys, so draws are grouped by pipeline
+    enum class MeshPipelineId : std::uint32_t {
+        Static,
+        Skinned, // skinned in vertex shader
+        SkinnedWide, // same, but for u16 joint ids and unorm16 weights
+        Count,
     };
 
     struct DrawCommand {
         const GPUMesh& mesh;
+        MeshPipelineId pipelineId;
         wgpu::BindGroup meshBindGroup;
         std::size_t meshId;
+        EntityId entityId;
+    };
+
+    // a run of draw commands which only differ by model matrix
+    struct InstancedDrawCommand {
+        std::size_t drawCommandIdx; // first draw command in the run
+        std::uint32_t firstInstance; // index into instance data buffer
+        std::uint32_t instanceCount;
     };
 
 public:
@@ -79,6 +127,8 @@ private:
     void initSwapChain(bool vSync);
     void initCamera();
     void initSceneData();
+    void createPerFrameBindGroup();
+    wgpu::Buffer createStorageBuffer(const char* label, std::size_t size);
     void createMeshDrawingPipeline();
     void createSkyboxDrawingPipeline();
     void createSpriteDrawingPipeline();
@@ -95,21 +145,37 @@ private:
     void shutdownImGui();
 
     void updateEntityTransforms();
-    void updateEntityTransforms(Entity& e, const glm::mat4& parentWorldTransform);
 
     void generateDrawList();
     void sortDrawList();
+    void uploadInstanceData();
 
     bool isRunning{false};
 
     Params params;
 
+    JobSystem jobSystem;
+    // used by load tasks: if they used jobSystem, the main thread could pick
+    // up long loading jobs while waiting for its own ones
+    JobSystem loaderJobSystem;
+
+    // declared before asyncLoader: pending uploads can own decoded images
+    ImageDecodePool imageDecodePool;
+    std::size_t imageDecodeMaxInFlightBytes{256 * 1024 * 1024};
+
+    AsyncLoader asyncLoader;
+    // uploads are processed at the start of each update
+    std::size_t uploadBudgetBytes{8 * 1024 * 1024};
+    float uploadBudgetMs{4.f};
+    std::size_t numUploadedBytes{0}; // during the last update
+
     SDL_Window* window{nullptr};
 
     wgpu::Instance instance;
     wgpu::Adapter adapter;
     wgpu::Device device;
     wgpu::RequiredLimits requiredLimits;
+    bool textureCompressionBC{false}; // device supports BC texture formats
 
     std::unique_ptr<wgpu::Surface> surface;
     std::unique_ptr<wgpu::SwapChain> swapChain;
@@ -123,11 +189,12 @@ private:
 
     wgpu::BindGroup perFrameBindGroup;
 
-    wgpu::ShaderModule meshShaderModule;
     wgpu::BindGroupLayout perFrameDataGroupLayout;
     wgpu::BindGroupLayout materialGroupLayout;
     wgpu::BindGroupLayout meshGroupLayout;
-    wgpu::RenderPipeline meshPipeline;
+    wgpu::BindGroupLayout skinnedMeshGroupLayout; // has joint bindings
+    // mesh shader variants, index = MeshPipelineId
+    std::array<wgpu::RenderPipeline, (std::size_t)MeshPipelineId::Count> meshPipelines;
 
     struct PerFrameData {
         glm::mat4 viewProj;
@@ -148,6 +215,8 @@ private:
 
     wgpu::Buffer frameDataBuffer;
     wgpu::Buffer directionalLightBuffer;
+    wgpu::Buffer meshDataBuffer; // MeshData of all entities (index = EntityId)
+    wgpu::Buffer instanceDataBuffer; // instance index -> meshDataBuffer index
 
     wgpu::TextureFormat depthTextureFormat{wgpu::TextureFormat::Depth24Plus};
     wgpu::Texture depthTexture;
@@ -171,20 +240,116 @@ private:
     FreeCameraController cameraController;
 
     std::vector<std::unique_ptr<Entity>> entities;
-    Entity& makeNewEntity();
-    Entity& findEntityByName(std::string_view name) const;
 
-    Scene loadScene(const std::filesystem::path& path);
+    // Joint matrices of all skinned entities. They're calculated in parallel,
+    // written straight into staging memory and uploaded with one copy.
+    std::vector<EntityId> animatedEntities;
+    wgpu::Buffer jointMatricesBuffer;
+    std::size_t numJointMatrices{0}; // allocated, including alignment padding
+    std::size_t allocateJointMatrices(std::size_t numJoints);
+    void updateAnimations(float dt);
+
+    // entities playing the same clip at the same time share evaluated poses
+    PoseCache poseCache;
+    bool usePoseCache{true};
+
+    // Animation LOD is picked by how much of the screen entity's bounding
+    // sphere covers. Lower LODs are evaluated less often (at 60/30/15/7.5 Hz)
+    // and can skip joints deeper than maxJointDepth (they keep their bind pose).
+    struct AnimationLOD {
+        float minScreenSize; // fraction of screen height
+        std::size_t updateInterval; // in ticks
+        int maxJointDepth; // -1 = all joints
+    };
+    std::array<AnimationLOD, 4> animationLODs{{
+        {.minScreenSize = 0.25f, .updateInterval = 1, .maxJointDepth = -1},
+        {.minScreenSize = 0.1f, .updateInterval = 2, .maxJointDepth = -1},
+        {.minScreenSize = 0.04f, .updateInterval = 4, .maxJointDepth = 5},
+        {.minScreenSize = 0.f, .updateInterval = 8, .maxJointDepth = 3},
+    }};
+    bool animationLOD{true};
+    std::size_t calculateAnimationLOD(const Entity& e) const;
+
+    struct AnimationUpdate {
+        std::size_t poseOwner; // index into animatedEntities
+        std::uint16_t maxJointDepth;
+        bool evaluate; // otherwise previous pose is uploaded
+    };
+    std::vector<AnimationUpdate> animationUpdates; // index = animatedEntities index
+    std::size_t animationTick{0};
+    std::array<std::size_t, 4> numEntitiesPerAnimationLOD{};
+    std::size_t numJointsEvaluated{0};
+
+    // when enabled, skinned meshes are skinned by a compute pass before
+    // they're drawn, otherwise they're skinned in the vertex shader
+    SkinningPass skinningPass;
+    bool gpuSkinning{true};
+    // false if the device doesn't allow enough storage buffers per stage for
+    // skinned mesh pipelines, gpuSkinning is always on then
+    bool vertexSkinningSupported{true};
+    std::vector<SkinningPass::Dispatch> skinningDispatches;
+
+    enum GPUTimerSection : std::size_t {
+        GPU_TIMER_SKINNING,
+        GPU_TIMER_MESH_DRAW,
+        GPU_TIMER_NUM_SECTIONS,
+    };
+    GPUTimer gpuTimer; // only enabled with Params::gpuTiming
+    Entity& makeNewEntity(const Transform& transform, EntityId parentId = NULL_ENTITY_ID);
+
+    TransformHierarchy transformHierarchy;
+    std::size_t numTransformsUpdated{0};
+
+    // world transforms in [dirtyBegin, dirtyEnd) range will be uploaded to meshDataBuffer
+    std::size_t meshDataDirtyBegin{std::numeric_limits<std::size_t>::max()};
+    std::size_t meshDataDirtyEnd{0};
+    Entity& findEntityByName(std::string_view name) const;
+    Entity* tryFindEntityByName(std::string_view name) const;
+
+    util::LoadContext createLoadContext();
+    // Scene is parsed and decoded on the async loader's thread and its GPU
+    // resources are uploaded over several frames. onLoaded is called once all
+    // meshes are uploaded, textures are streamed in after that (materials use
+    // whiteTexture until then).
+    void loadSceneAsync(
+        const std::filesystem::path& path,
+        std::function<void(const Scene&)> onLoaded);
     void createEntitiesFromScene(const Scene& scene);
     EntityId createEntitiesFromNode(
         const Scene& scene,
         const SceneNode& node,
         EntityId parentId = NULL_ENTITY_ID);
+    void initEntityMeshes(Entity& e, const Scene& scene, const SceneNode& node);
+
+    wgpu::BindGroup createMeshBindGroup(const GPUMesh& mesh);
+    wgpu::BindGroup createSkinnedMeshBindGroup(
+        const GPUMesh& mesh,
+        const wgpu::Buffer& jointMatricesBuffer,
+        std::uint64_t jointMatricesOffset,
+        std::uint64_t jointMatricesSize);
+    void createSkinnedMeshBindGroups(Entity& e);
+    wgpu::BindGroup createSkinnedMeshDrawBindGroup(
+        const GPUMesh& mesh,
+        const SkinningPass::Output& skinnedMesh);
+    // static meshes can share bind groups between entities
+    const wgpu::BindGroup& getStaticMeshBindGroup(MeshId meshId);
+    std::unordered_map<MeshId, wgpu::BindGroup> staticMeshBindGroups;
+
+    // world space AABBs of all entity meshes (in entity/mesh order)
+    math::AABBArray worldBoundingBoxes;
+    std::vector<std::size_t> entityBoundingBoxOffsets;
+    std::vector<std::uint8_t> meshVisibility;
+    bool frustumCulling{true};
+    std::size_t numCulledMeshes{0};
 
     std::vector<DrawCommand> drawCommands;
-    std::vector<std::size_t> sortedDrawCommands;
+    // generated together with draw commands, payload = index into drawCommands
+    std::vector<util::SortKey> drawSortKeys;
+    std::vector<util::SortKey> drawSortKeysTmp;
+    std::vector<InstancedDrawCommand> instancedDrawCommands;
+    std::vector<std::uint32_t> instanceData; // in instancedDrawCommands order
 
-    Texture whiteTexture;
+    std::shared_ptr<const Texture> whiteTexture;
 
     bool vSync{true};
     bool frameLimit{true};
@@ -196,18 +361,22 @@ private:
     float displayFPSDelay{1.f};
 
     MaterialCache materialCache;
+    TextureCache textureCache;
     MeshCache meshCache;
-
-    wgpu::Buffer emptyStorageBuffer;
+    SkeletonCache skeletonCache;
+    AnimationCache animationCache;
 
     MipMapGenerator mipMapGenerator;
+    UploadManager uploadManager;
+    UploadManager::Stats lastFrameUploadStats;
 
     Texture skyboxTexture;
     wgpu::RenderPipeline skyboxPipeline;
     wgpu::ShaderModule skyboxShaderModule;
     wgpu::BindGroupLayout skyboxGroupLayout;
 
-    wgpu::BindGroup skyboxBindGroup;
+    wgpu::BindGroup skyboxBindGroup; // null until the skybox is loaded
+    void loadSkyboxAsync(const std::filesystem::path& imagesDir);
 
     Texture screenTexture;
     wgpu::TextureView screenTextureView;
@@ -0,0 +1,312 @@
+#include "AnimationCompression.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <glm/gtx/compatibility.hpp> // lerp for vec3
+#include <glm/mat4x4.hpp>
+
+#include <Graphics/Skeleton.h>
+
+namespace
+{
+// rate at which raw and compressed clips are compared to get max joint error
+static const float ERROR_SAMPLE_RATE = 60.f;
+
+float getRotationError(const glm::quat& a, const glm::quat& b)
+{
+    const auto d = std::min(std::abs(glm::dot(a, b)), 1.f);
+    return 2.f * std::acos(d);
+}
+
+float getVec3Error(const glm::vec3& a, const glm::vec3& b)
+{
+    return glm::length(a - b);
+}
+
+glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, float t)
+{
+    return glm::lerp(a, b, t);
+}
+
+glm::quat interpolate(const glm::quat& a, const glm::quat& b, float t)
+{
+    return glm::slerp(a, b, t);
+}
+
+// Greedily extends each segment between kept keys while all skipped keys
+// can be interpolated from its ends within maxError. Returns kept keys.
+template<typename T, typename ErrorF>
+std::vector<std::size_t> reduceKeys(
+    const std::vector<float>& times,
+    const std::vector<T>& keys,
+    float maxError,
+    ErrorF getError)
+{
+    const auto numKeys = keys.size();
+    if (numKeys == 0) {
+        return {};
+    }
+
+    const auto isConstant = std::all_of(keys.begin(), keys.end(), [&](const T& key) {
+        return getError(key, keys[0]) <= maxError;
+    });
+    if (isConstant) {
+        return {0};
+    }
+
+    const auto canSkipKeysBetween = [&](std::size_t first, std::size_t last) {
+        for (std::size_t k = first + 1; k < last; ++k) {
+            const auto t = (times[k] - times[first]) / (times[last] - times[first]);
+            if (getError(interpolate(keys[first], keys[last], t), keys[k]) > maxError) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    std::vector<std::size_t> kept{0};
+    std::size_t first = 0;
+    while (first < numKeys - 1) {
+        auto last = first + 1;
+        while (last + 1 < numKeys && canSkipKeysBetween(first, last + 1)) {
+            ++last;
+        }
+        kept.push_back(last);
+        first = last;
+    }
+    return kept;
+}
+
+std::array<std::uint16_t, 3> packQuat(glm::quat q)
+{
+    q = glm::normalize(q);
+    std::array<float, 4> c{q.x, q.y, q.z, q.w};
+
+    std::uint16_t largest = 0;
+    for (std::uint16_t i = 1; i < 4; ++i) {
+        if (std::abs(c[i]) > std::abs(c[largest])) {
+            largest = i;
+        }
+    }
+    // q and -q are the same rotation, so the omitted component is always positive
+    const float sign = c[largest] < 0.f ? -1.f : 1.f;
+
+    std::array<std::uint16_t, 3> packed{};
+    std::size_t dst = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        if (i == largest) {
+            continue;
+        }
+        // the other components are in [-1/sqrt(2), 1/sqrt(2)]
+        const auto v = (c[i] * sign * 0.70710678f + 0.5f) * 32767.f;
+        packed[dst++] = static_cast<std::uint16_t>(std::clamp(std::round(v), 0.f, 32767.f));
+    }
+    packed[0] |= static_cast<std::uint16_t>((largest & 1) << 15);
+    packed[1] |= static_cast<std::uint16_t>((largest >> 1) << 15);
+    return packed;
+}
+
+void compressTrack(
+    const std::vector<float>& times,
+    const std::vector<glm::vec3>& keys,
+    float maxError,
+    SkeletalAnimation::Vec3Track& track)
+{
+    const auto kept = reduceKeys(times, keys, maxError, getVec3Error);
+    if (kept.empty()) {
+        return;
+    }
+
+    glm::vec3 rangeMin{keys[kept[0]]};
+    glm::vec3 rangeMax{keys[kept[0]]};
+    for (const auto k : kept) {
+        rangeMin = glm::min(rangeMin, keys[k]);
+        rangeMax = glm::max(rangeMax, keys[k]);
+    }
+    track.rangeMin = rangeMin;
+    track.rangeScale = (rangeMax - rangeMin) / 65535.f;
+
+    track.times.reserve(kept.size());
+    track.keys.reserve(kept.size());
+    for (const auto k : kept) {
+        track.times.push_back(times[k]);
+        std::array<std::uint16_t, 3> q{};
+        for (int i = 0; i < 3; ++i) {
+            if (track.rangeScale[i] > 0.f) {
+                const auto v = std::round((keys[k][i] - rangeMin[i]) / track.rangeScale[i]);
+                q[i] = static_cast<std::uint16_t>(std::clamp(v, 0.f, 65535.f));
+            }
+        }
+        track.keys.push_back(q);
+    }
+}
+
+void compressTrack(
+    const std::vector<float>& times,
+    const std::vector<glm::quat>& keys,
+    float maxError,
+    SkeletalAnimation::RotationTrack& track)
+{
+    const auto kept = reduceKeys(times, keys, maxError, getRotationError);
+    track.times.reserve(kept.size());
+    track.keys.reserve(kept.size());
+    for (const auto k : kept) {
+        track.times.push_back(times[k]);
+        track.keys.push_back(packQuat(keys[k]));
+    }
+}
+
+template<typename TrackT>
+std::size_t getTrackSize(const TrackT& track)
+{
+    return track.times.size() * sizeof(float) + track.keys.size() * sizeof(track.keys[0]);
+}
+
+std::size_t getTrackSize(const SkeletalAnimation::Vec3Track& track)
+{
+    return getTrackSize<SkeletalAnimation::Vec3Track>(track) + sizeof(glm::vec3) * 2;
+}
+
+// Samples keys with a binary search (this is only used for measuring the error)
+template<typename T, typename GetKeyF>
+T sampleKeys(const std::vector<float>& times, float time, const T& defaultValue, GetKeyF getKey)
+{
+    if (times.empty()) {
+        return defaultValue;
+    }
+    if (times.size() == 1 || time <= times.front()) {
+        return getKey(0);
+    }
+    if (time >= times.back()) {
+        return getKey(times.size() - 1);
+    }
+    const auto it = std::upper_bound(times.begin(), times.end(), time);
+    const auto next = static_cast<std::size_t>(std::distance(times.begin(), it));
+    const auto prev = next - 1;
+    const auto t = (time - times[prev]) / (times[next] - times[prev]);
+    return interpolate(getKey(prev), getKey(next), t);
+}
+
+// TRS -> model space joint positions
+template<typename SampleF>
+void calculateJointPositions(
+    const Skeleton& skeleton,
+    SampleF sampleLocalTransform,
+    std::vector<glm::mat4>& modelMatrices,
+    std::vector<glm::vec3>& positions)
+{
+    const auto numJoints = skeleton.parents.size();
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        glm::vec3 translation, scale;
+        glm::quat rotation;
+        sampleLocalTransform(jointId, translation, rotation, scale);
+
+        auto m = glm::mat4_cast(rotation);
+        m[0] *= scale.x;
+        m[1] *= scale.y;
+        m[2] *= scale.z;
+        m[3] = glm::vec4(translation, 1.f);
+
+        const auto parentId = skeleton.parents[jointId];
+        modelMatrices[jointId] = (parentId != NULL_JOINT_ID) ? modelMatrices[parentId] * m : m;
+        positions[jointId] = glm::vec3(modelMatrices[jointId][3]);
+    }
+}
+
+float calculateMaxJointError(
+    const Skeleton& skeleton,
+    const std::vector<RawAnimationTracks>& rawTracks,
+    const SkeletalAnimation& animation)
+{
+    const auto numJoints = skeleton.parents.size();
+    std::vector<glm::mat4> modelMatrices(numJoints);
+    std::vector<glm::vec3> rawPositions(numJoints);
+    std::vector<glm::vec3> positions(numJoints);
+
+    const auto sampleRaw = [&](float time) {
+        return [&rawTracks, time](
+                   std::size_t jointId, glm::vec3& t, glm::quat& r, glm::vec3& s) {
+            const auto& tracks = rawTracks[jointId];
+            t = sampleKeys(tracks.translationTimes, time, glm::vec3{0.f}, [&](std::size_t k) {
+                return tracks.translations[k];
+            });
+            r = sampleKeys(
+                tracks.rotationTimes, time, glm::identity<glm::quat>(), [&](std::size_t k) {
+                    return tracks.rotations[k];
+                });
+            s = sampleKeys(tracks.scaleTimes, time, glm::vec3{1.f}, [&](std::size_t k) {
+                return tracks.scales[k];
+            });
+        };
+    };
+    const auto sampleCompressed = [&](float time) {
+        return [&animation, time](
+                   std::size_t jointId, glm::vec3& t, glm::quat& r, glm::vec3& s) {
+            const auto& tracks = animation.tracks[jointId];
+            t = sampleKeys(tracks.translations.times, time, glm::vec3{0.f}, [&](std::size_t k) {
+                return decompressKey(tracks.translations, k);
+            });
+            r = sampleKeys(
+                tracks.rotations.times, time, glm::identity<glm::quat>(), [&](std::size_t k) {
+                    return decompressKey(tracks.rotations, k);
+                });
+            s = sampleKeys(tracks.scales.times, time, glm::vec3{1.f}, [&](std::size_t k) {
+                return decompressKey(tracks.scales, k);
+            });
+        };
+    };
+
+    float maxError = 0.f;
+    const auto numSamples = static_cast<std::size_t>(animation.duration * ERROR_SAMPLE_RATE) + 1;
+    for (std::size_t i = 0; i <= numSamples; ++i) {
+        const auto time = std::min((float)i / ERROR_SAMPLE_RATE, animation.duration);
+        calculateJointPositions(skeleton, sampleRaw(time), modelMatrices, rawPositions);
+        calculateJointPositions(skeleton, sampleCompressed(time), modelMatrices, positions);
+        for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+            maxError = std::max(maxError, glm::length(positions[jointId] - rawPositions[jointId]));
+        }
+    }
+    return maxError;
+}
+
+} // end of anonymous namespace
+
+AnimationCompressionStats compressAnimation(
+    const Skeleton& skeleton,
+    const std::vector<RawAnimationTracks>& rawTracks,
+    SkeletalAnimation& animation,
+    const AnimationCompressionSettings& settings)
+{
+    assert(rawTracks.size() == skeleton.parents.size());
+
+    AnimationCompressionStats stats;
+    animation.tracks.resize(rawTracks.size());
+    for (std::size_t jointId = 0; jointId < rawTracks.size(); ++jointId) {
+        const auto& raw = rawTracks[jointId];
+        auto& tracks = animation.tracks[jointId];
+
+        compressTrack(
+            raw.translationTimes,
+            raw.translations,
+            settings.maxTranslationError,
+            tracks.translations);
+        compressTrack(
+            raw.rotationTimes, raw.rotations, settings.maxRotationError, tracks.rotations);
+        compressTrack(raw.scaleTimes, raw.scales, settings.maxScaleError, tracks.scales);
+
+        stats.rawSizeBytes += (raw.translationTimes.size() + raw.rotationTimes.size() +
+                               raw.scaleTimes.size()) *
+                                  sizeof(float) +
+                              raw.translations.size() * sizeof(glm::vec3) +
+                              raw.rotations.size() * sizeof(glm::quat) +
+                              raw.scales.size() * sizeof(glm::vec3);
+        stats.compressedSizeBytes += getTrackSize(tracks.translations) +
+                                     getTrackSize(tracks.rotations) +
+                                     getTrackSize(tracks.scales);
+    }
+
+    stats.maxJointError = calculateMaxJointError(skeleton, rawTracks, animation);
+    return stats;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+#include <Graphics/SkeletalAnimation.h>
+
+struct Skeleton;
+
+// Uncompressed keys of one joint, as they're stored in glTF
+struct RawAnimationTracks {
+    std::vector<float> translationTimes;
+    std::vector<glm::vec3> translations;
+    std::vector<float> rotationTimes;
+    std::vector<glm::quat> rotations;
+    std::vector<float> scaleTimes;
+    std::vector<glm::vec3> scales;
+};
+
+struct AnimationCompressionSettings {
+    // keys which can be interpolated from their neighbours within these errors are dropped
+    float maxTranslationError{0.0001f};
+    float maxRotationError{0.001f}; // in radians
+    float maxScaleError{0.0001f};
+};
+
+struct AnimationCompressionStats {
+    std::size_t rawSizeBytes{0};
+    std::size_t compressedSizeBytes{0};
+    // max distance between model space joint positions of raw and compressed
+    // animation, measured at a fixed rate over the whole clip
+    float maxJointError{0.f};
+
+    float getRatio() const
+    {
+        return compressedSizeBytes ? (float)rawSizeBytes / (float)compressedSizeBytes : 0.f;
+    }
+};
+
+// Reduces keys within the settings' error bounds, quantizes translations and
+// scales against per-track ranges and packs rotations as smallest-three.
+// Fills animation.tracks (index = jointId).
+AnimationCompressionStats compressAnimation(
+    const Skeleton& skeleton,
+    const std::vector<RawAnimationTracks>& rawTracks,
+    SkeletalAnimation& animation,
+    const AnimationCompressionSettings& settings = {});
+
+inline glm::vec3 decompressKey(const SkeletalAnimation::Vec3Track& track, std::size_t key)
+{
+    const auto& k = track.keys[key];
+    return track.rangeMin + glm::vec3{(float)k[0], (float)k[1], (float)k[2]} * track.rangeScale;
+}
+
+inline glm::quat decompressKey(const SkeletalAnimation::RotationTrack& track, std::size_t key)
+{
+    static constexpr float SCALE = 1.41421356f / 32767.f; // [0, 32767] -> [0, sqrt(2)]
+    static constexpr float BIAS = 0.70710678f; // 1 / sqrt(2)
+
+    // components are 15 bits each, the 2 bits of the index of the largest
+    // (omitted) component are in the top bits of the first two words
+    const auto& k = track.keys[key];
+    const auto largest = (k[0] >> 15) | ((k[1] >> 15) << 1);
+    const float a = (float)(k[0] & 0x7fff) * SCALE - BIAS;
+    const float b = (float)(k[1] & 0x7fff) * SCALE - BIAS;
+    const float c = (float)(k[2] & 0x7fff) * SCALE - BIAS;
+    const float d = std::sqrt(std::max(0.f, 1.f - a * a - b * b - c * c));
+
+    // glm::quat is constructed from (w, x, y, z)
+    switch (largest) {
+    case 0:
+        return glm::quat{c, d, a, b};
+    case 1:
+        return glm::quat{c, a, d, b};
+    case 2:
+        return glm::quat{c, a, b, d};
+    default:
+        return glm::quat{d, a, b, c};
+    }
+}
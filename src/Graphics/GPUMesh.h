@@ -5,6 +5,7 @@
 #include <webgpu/webgpu_cpp.h>
 
 #include <Graphics/Material.h>
+#include <Math/Bounds.h>
 
 using MeshId = std::size_t;
 static const auto NULL_MESH_ID = std::numeric_limits<std::size_t>::max();
@@ -23,4 +24,9 @@ struct GPUMesh {
     std::vector<AttribProps> attribs;
 
     bool hasSkeleton{false};
+    bool wideSkinAttribs{false}; // see Mesh::jointIds
+
+    // local space bounds
+    math::AABB boundingBox;
+    math::Sphere boundingSphere;
 };
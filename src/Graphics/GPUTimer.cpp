@@ -0,0 +1,194 @@
+#include "GPUTimer.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+// if the GPU is further behind, timestamps of the current frame are dropped
+constexpr std::size_t MAX_READBACK_BUFFERS = 4;
+}
+
+GPUTimer::~GPUTimer()
+{
+    cleanup();
+}
+
+void GPUTimer::init(const wgpu::Device& device, std::size_t numSections, const char* label)
+{
+    assert(!this->device && "GPU timer was already initialized");
+    assert(numSections > 0);
+    this->device = device;
+    sections.resize(numSections);
+    writtenSections.resize(numSections, false);
+
+    if (!device.HasFeature(wgpu::FeatureName::TimestampQuery)) {
+        return;
+    }
+
+    const auto numQueries = static_cast<std::uint32_t>(numSections * 2);
+    const auto querySetDesc = wgpu::QuerySetDescriptor{
+        .label = label,
+        .type = wgpu::QueryType::Timestamp,
+        .count = numQueries,
+    };
+    querySet = device.CreateQuerySet(&querySetDesc);
+
+    timestampsSize = numQueries * sizeof(std::uint64_t);
+    const auto bufferDesc = wgpu::BufferDescriptor{
+        .label = "timestamp resolve buffer",
+        .usage = wgpu::BufferUsage::QueryResolve | wgpu::BufferUsage::CopySrc,
+        .size = timestampsSize,
+    };
+    resolveBuffer = device.CreateBuffer(&bufferDesc);
+}
+
+void GPUTimer::cleanup()
+{
+    // Destroy buffers explicitly: pending MapAsync callbacks get called
+    // with an error status and won't touch ReadbackBuffers freed below
+    for (auto& rb : readbackBuffers) {
+        rb->buffer.Destroy();
+    }
+    readbackBuffers.clear();
+    resolvedBuffer = nullptr;
+    if (querySet) {
+        querySet.Destroy();
+        querySet = {};
+    }
+    resolveBuffer = {};
+    device = {};
+}
+
+void GPUTimer::begin(const wgpu::CommandEncoder& encoder, std::size_t sectionIdx)
+{
+    assert(sectionIdx < sections.size());
+    if (isEnabled()) {
+        encoder.WriteTimestamp(querySet, static_cast<std::uint32_t>(sectionIdx * 2));
+    }
+}
+
+void GPUTimer::end(const wgpu::CommandEncoder& encoder, std::size_t sectionIdx)
+{
+    assert(sectionIdx < sections.size());
+    if (isEnabled()) {
+        encoder.WriteTimestamp(querySet, static_cast<std::uint32_t>(sectionIdx * 2 + 1));
+        writtenSections[sectionIdx] = true;
+    }
+}
+
+bool GPUTimer::resolve(const wgpu::CommandEncoder& encoder)
+{
+    assert(!resolvedBuffer && "readback wasn't called after the previous resolve");
+    if (!isEnabled()) {
+        return false;
+    }
+
+    bool anyWritten = false;
+    for (const auto written : writtenSections) {
+        anyWritten = anyWritten || written;
+    }
+    if (!anyWritten) {
+        return false;
+    }
+
+    auto* rb = acquireReadbackBuffer();
+    if (!rb) { // all buffers are still waiting for the GPU
+        writtenSections.assign(writtenSections.size(), false);
+        return false;
+    }
+
+    encoder.ResolveQuerySet(
+        querySet, 0, static_cast<std::uint32_t>(sections.size() * 2), resolveBuffer, 0);
+    encoder.CopyBufferToBuffer(resolveBuffer, 0, rb->buffer, 0, timestampsSize);
+    rb->inUse = true;
+    rb->writtenSections = writtenSections;
+    writtenSections.assign(writtenSections.size(), false);
+    resolvedBuffer = rb;
+    return true;
+}
+
+void GPUTimer::readback()
+{
+    if (!resolvedBuffer) {
+        return;
+    }
+    // the callback gets called by device.Tick() once the copy is finished
+    resolvedBuffer->buffer.MapAsync(
+        wgpu::MapMode::Read, 0, timestampsSize, onBufferMapped, resolvedBuffer);
+    resolvedBuffer = nullptr;
+}
+
+float GPUTimer::getAverageMs(std::size_t sectionIdx) const
+{
+    const auto& section = sections[sectionIdx];
+    if (section.numSamples == 0) {
+        return 0.f;
+    }
+    return static_cast<float>(section.totalMs / static_cast<double>(section.numSamples));
+}
+
+void GPUTimer::resetTotals()
+{
+    for (auto& section : sections) {
+        section.totalMs = 0.0;
+        section.numSamples = 0;
+    }
+}
+
+GPUTimer::ReadbackBuffer* GPUTimer::acquireReadbackBuffer()
+{
+    for (auto& rb : readbackBuffers) {
+        if (!rb->inUse) {
+            return rb.get();
+        }
+    }
+    if (readbackBuffers.size() == MAX_READBACK_BUFFERS) {
+        return nullptr;
+    }
+
+    const auto bufferDesc = wgpu::BufferDescriptor{
+        .label = "timestamp readback buffer",
+        .usage = wgpu::BufferUsage::MapRead | wgpu::BufferUsage::CopyDst,
+        .size = timestampsSize,
+    };
+    auto rb = std::make_unique<ReadbackBuffer>();
+    rb->timer = this;
+    rb->buffer = device.CreateBuffer(&bufferDesc);
+    readbackBuffers.push_back(std::move(rb));
+    return readbackBuffers.back().get();
+}
+
+void GPUTimer::onTimestampsRead(ReadbackBuffer& rb)
+{
+    std::vector<std::uint64_t> timestamps(sections.size() * 2);
+    std::memcpy(
+        timestamps.data(), rb.buffer.GetConstMappedRange(0, timestampsSize), timestampsSize);
+    rb.buffer.Unmap();
+    rb.inUse = false;
+
+    for (std::size_t i = 0; i < sections.size(); ++i) {
+        const auto beginTime = timestamps[i * 2];
+        const auto endTime = timestamps[i * 2 + 1];
+        // timestamps can be reordered or reset between passes by some drivers
+        if (!rb.writtenSections[i] || endTime <= beginTime) {
+            continue;
+        }
+        auto& section = sections[i];
+        // Dawn converts timestamps to nanoseconds
+        const auto ms = static_cast<double>(endTime - beginTime) / 1'000'000.0;
+        section.lastMs = static_cast<float>(ms);
+        section.totalMs += ms;
+        ++section.numSamples;
+    }
+}
+
+void GPUTimer::onBufferMapped(WGPUBufferMapAsyncStatus status, void* userdata)
+{
+    if (status != WGPUBufferMapAsyncStatus_Success) {
+        // the buffer was destroyed in cleanup, userdata may be dangling
+        return;
+    }
+    auto& rb = *static_cast<ReadbackBuffer*>(userdata);
+    rb.timer->onTimestampsRead(rb);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <webgpu/webgpu_cpp.h>
+
+// Measures GPU time of sections of a command encoder with timestamp queries.
+// Each section writes two timestamps (begin and end) between passes. resolve
+// copies the timestamps into a MapRead buffer at the end of the encoder and
+// readback maps it after the encoder's commands are submitted - the results
+// arrive a few frames later in device.Tick().
+// Does nothing if the device doesn't have the TimestampQuery feature.
+class GPUTimer {
+public:
+    struct Section {
+        float lastMs{0.f};
+        double totalMs{0.0}; // since the last resetTotals
+        std::size_t numSamples{0};
+    };
+
+    GPUTimer() = default;
+    ~GPUTimer();
+
+    GPUTimer(const GPUTimer&) = delete;
+    GPUTimer& operator=(const GPUTimer&) = delete;
+
+    void init(const wgpu::Device& device, std::size_t numSections, const char* label);
+    void cleanup();
+
+    bool isEnabled() const { return querySet != nullptr; }
+
+    void begin(const wgpu::CommandEncoder& encoder, std::size_t sectionIdx);
+    void end(const wgpu::CommandEncoder& encoder, std::size_t sectionIdx);
+
+    // Must be called before encoder.Finish. Returns false if nothing was
+    // resolved (no sections were written or the GPU is too far behind)
+    bool resolve(const wgpu::CommandEncoder& encoder);
+    // Must be called after the encoder's commands are submitted
+    void readback();
+
+    const Section& getSection(std::size_t sectionIdx) const { return sections[sectionIdx]; }
+    float getAverageMs(std::size_t sectionIdx) const;
+    void resetTotals();
+
+private:
+    struct ReadbackBuffer {
+        GPUTimer* timer{nullptr};
+        wgpu::Buffer buffer;
+        std::vector<bool> writtenSections;
+        bool inUse{false}; // resolved into or waiting for MapAsync
+    };
+
+    // returns nullptr if all buffers are in use
+    ReadbackBuffer* acquireReadbackBuffer();
+    void onTimestampsRead(ReadbackBuffer& rb);
+
+    static void onBufferMapped(WGPUBufferMapAsyncStatus status, void* userdata);
+
+    wgpu::Device device;
+    wgpu::QuerySet querySet;
+    wgpu::Buffer resolveBuffer;
+    std::uint64_t timestampsSize{0};
+
+    std::vector<Section> sections;
+    std::vector<bool> writtenSections; // since the last resolve
+
+    // unique_ptr, because pointers are passed to MapAsync
+    std::vector<std::unique_ptr<ReadbackBuffer>> readbackBuffers;
+    ReadbackBuffer* resolvedBuffer{nullptr}; // waiting for readback
+};
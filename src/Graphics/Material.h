@@ -1,6 +1,7 @@
 #pragma once
 
 #include <limits>
+#include <memory>
 #include <string>
 
 #include <webgpu/webgpu_cpp.h>
@@ -20,7 +21,7 @@ struct Material {
     std::string name;
 
     wgpu::Buffer dataBuffer;
-    Texture diffuseTexture;
+    std::shared_ptr<const Texture> diffuseTexture; // can be shared, see TextureCache
     glm::vec4 baseColor{1.f, 1.f, 1.f, 1.f};
 
     wgpu::BindGroup bindGroup;
@@ -1 +1,44 @@
 #include "Mesh.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+void packSkinAttrib(const std::array<std::uint16_t, 4>& values, bool wide, std::uint32_t* dst)
+{
+    if (wide) {
+        dst[0] = values[0] | (static_cast<std::uint32_t>(values[1]) << 16);
+        dst[1] = values[2] | (static_cast<std::uint32_t>(values[3]) << 16);
+    } else {
+        assert(std::all_of(values.begin(), values.end(), [](auto v) { return v <= 0xff; }));
+        dst[0] = values[0] | (static_cast<std::uint32_t>(values[1]) << 8) |
+                 (static_cast<std::uint32_t>(values[2]) << 16) |
+                 (static_cast<std::uint32_t>(values[3]) << 24);
+    }
+}
+
+std::array<std::uint16_t, 4> quantizeSkinWeights(glm::vec4 weights, bool wide)
+{
+    const auto maxValue = wide ? 0xffff : 0xff;
+
+    const auto sum = weights.x + weights.y + weights.z + weights.w;
+    if (sum > 0.f) {
+        weights /= sum;
+    } else {
+        weights = glm::vec4{1.f, 0.f, 0.f, 0.f};
+    }
+
+    std::array<std::uint16_t, 4> quantized{};
+    int quantizedSum = 0;
+    int largest = 0;
+    for (int i = 0; i < 4; ++i) {
+        quantized[i] = static_cast<std::uint16_t>(std::round(weights[i] * (float)maxValue));
+        quantizedSum += quantized[i];
+        if (weights[i] > weights[largest]) {
+            largest = i;
+        }
+    }
+    // rounding error (at most 2) goes to the largest weight, it's >= 1/4
+    quantized[largest] = static_cast<std::uint16_t>(quantized[largest] + maxValue - quantizedSum);
+    return quantized;
+}
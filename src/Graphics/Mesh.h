@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -9,6 +10,9 @@
 #include <glm/vec4.hpp>
 
 #include <Graphics/Skeleton.h>
+#include <Math/Bounds.h>
+
+static const std::size_t MAX_NARROW_SKIN_JOINTS = 256;
 
 struct Mesh {
     std::vector<std::uint16_t> indices;
@@ -18,11 +22,27 @@ struct Mesh {
     std::vector<glm::vec4> tangents;
     std::vector<glm::vec2> uvs;
 
-    // skinned meshes only
-    std::vector<glm::vec<4, std::uint32_t>> jointIds;
-    std::vector<glm::vec4> weights;
+    // skinned meshes only, four influences per vertex, packed with
+    // packSkinAttrib (unpacked in shaders):
+    // - jointIds are u8x4 (one word per vertex) or u16x4 (two words) if the
+    //   skeleton has more than MAX_NARROW_SKIN_JOINTS joints
+    // - weights are unorm8x4 or unorm16x4 (sum of weights is exactly 1)
+    std::vector<std::uint32_t> jointIds;
+    std::vector<std::uint32_t> weights;
 
     bool hasSkeleton{false};
+    bool wideSkinAttribs{false};
+
+    // local space bounds
+    math::AABB boundingBox;
+    math::Sphere boundingSphere;
 
     std::string name;
 };
+
+// Packs four 8-bit (or 16-bit if wide) values into one (two) words,
+// first value goes into the lowest bits
+void packSkinAttrib(const std::array<std::uint16_t, 4>& values, bool wide, std::uint32_t* dst);
+
+// Quantizes normalized weights so that their sum is exactly 255 (or 65535 if wide)
+std::array<std::uint16_t, 4> quantizeSkinWeights(glm::vec4 weights, bool wide);
@@ -1,5 +1,12 @@
 #include "MipMapGenerator.h"
 
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <string_view>
+
+#include <glm/common.hpp>
+
 #include <util/WebGPUUtil.h>
 
 namespace
@@ -18,6 +25,128 @@ fn fs_main(fsInput: VSOutput) -> @location(0) vec4f {
     return textureSample(texture, texSampler, fsInput.uv);
 }
 )";
+
+// Each thread of 8x8 workgroup downsamples 2x2 input texels into the first
+// output level. Next levels are downsampled from the previous level's values
+// kept in workgroup memory by 4x4, 2x2 and 1x1 threads. Values are averaged in
+// linear space and encoded (e.g. to sRGB) only when stored.
+const char* computeShaderSource = R"(
+@group(0) @binding(0) var input: texture_2d_array<f32>;
+
+var<workgroup> tile: array<vec4f, 64>;
+
+fn linearToSrgb(color: vec4f) -> vec4f {
+    let c = color.rgb;
+    let srgb = select(1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055, c * 12.92, c <= vec3(0.0031308));
+    return vec4(srgb, color.a);
+}
+
+fn loadInput(coord: vec2u, layer: u32) -> vec4f {
+    let maxCoord = textureDimensions(input) - vec2(1u);
+    return textureLoad(input, min(coord, maxCoord), layer, 0);
+}
+
+fn downsampleInput(coord: vec2u, layer: u32) -> vec4f {
+    let c = coord * 2u;
+    return (loadInput(c, layer) + loadInput(c + vec2(1u, 0u), layer) +
+        loadInput(c + vec2(0u, 1u), layer) + loadInput(c + vec2(1u, 1u), layer)) * 0.25;
+}
+
+fn downsampleTile(localCoord: vec2u) -> vec4f {
+    let i = localCoord.y * 16u + localCoord.x * 2u;
+    return (tile[i] + tile[i + 1u] + tile[i + 8u] + tile[i + 9u]) * 0.25;
+}
+
+@compute @workgroup_size(8, 8)
+fn cs_main(
+    @builtin(workgroup_id) group: vec3u,
+    @builtin(local_invocation_id) local: vec3u,
+) {
+    let layer = group.z;
+    var color = downsampleInput(group.xy * 8u + local.xy, layer);
+    textureStore(output1, group.xy * 8u + local.xy, layer, ENCODE(color));
+NEXT_LEVELS
+}
+)";
+
+// Level LEVEL is downsampled by SIZE x SIZE threads from PREV_SIZE x PREV_SIZE values
+const char* computeShaderLevelSource = R"(
+    if (all(local.xy < vec2(PREV_SIZEu))) {
+        tile[local.y * 8u + local.x] = color;
+    }
+    workgroupBarrier();
+    if (all(local.xy < vec2(SIZEu))) {
+        color = downsampleTile(local.xy);
+        textureStore(outputLEVEL, group.xy * SIZEu + local.xy, layer, ENCODE(color));
+    }
+    workgroupBarrier();
+)";
+
+void replaceAll(std::string& str, std::string_view from, std::string_view to)
+{
+    for (auto pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos)) {
+        str.replace(pos, from.size(), to);
+        pos += to.size();
+    }
+}
+
+const char* getWGSLFormatName(wgpu::TextureFormat format)
+{
+    switch (format) {
+    case wgpu::TextureFormat::RGBA8Unorm:
+        return "rgba8unorm";
+    case wgpu::TextureFormat::RGBA16Float:
+        return "rgba16float";
+    case wgpu::TextureFormat::RGBA32Float:
+        return "rgba32float";
+    default:
+        assert(false && "unsupported storage format");
+        return "";
+    }
+}
+
+std::string makeComputeShaderSource(
+    wgpu::TextureFormat format,
+    wgpu::TextureFormat storageFormat,
+    std::uint32_t numLevels)
+{
+    std::string source;
+    for (std::uint32_t level = 1; level <= numLevels; ++level) {
+        source += "@group(0) @binding(" + std::to_string(level) + ") var output" +
+                  std::to_string(level) + ": texture_storage_2d_array<" +
+                  getWGSLFormatName(storageFormat) + ", write>;\n";
+    }
+    source += computeShaderSource;
+
+    std::string nextLevels;
+    for (std::uint32_t level = 2; level <= numLevels; ++level) {
+        std::string levelSource = computeShaderLevelSource;
+        replaceAll(levelSource, "LEVEL", std::to_string(level));
+        replaceAll(levelSource, "PREV_SIZE", std::to_string(8 >> (level - 2)));
+        replaceAll(levelSource, "SIZE", std::to_string(8 >> (level - 1)));
+        nextLevels += levelSource;
+    }
+    replaceAll(source, "NEXT_LEVELS", nextLevels);
+    replaceAll(source, "ENCODE", (format != storageFormat) ? "linearToSrgb" : "");
+    return source;
+}
+
+wgpu::TextureView createArrayView(
+    const Texture& texture,
+    wgpu::TextureFormat format,
+    std::uint32_t mipLevel)
+{
+    const auto textureViewDesc = wgpu::TextureViewDescriptor{
+        .format = format,
+        .dimension = wgpu::TextureViewDimension::e2DArray,
+        .baseMipLevel = mipLevel,
+        .mipLevelCount = 1,
+        .baseArrayLayer = 0,
+        .arrayLayerCount = texture.isCubemap ? 6u : 1u,
+        .aspect = wgpu::TextureAspect::All,
+    };
+    return texture.texture.CreateView(&textureViewDesc);
+}
 }
 
 void MipMapGenerator::init(
@@ -146,23 +275,208 @@ const wgpu::RenderPipeline& MipMapGenerator::getOrCreatePipeline(
     return createPipelineForFormat(device, format);
 }
 
+wgpu::TextureFormat MipMapGenerator::getStorageFormat(wgpu::TextureFormat format)
+{
+    switch (format) {
+    case wgpu::TextureFormat::RGBA8UnormSrgb:
+        return wgpu::TextureFormat::RGBA8Unorm;
+    case wgpu::TextureFormat::RGBA8Unorm:
+    case wgpu::TextureFormat::RGBA16Float:
+    case wgpu::TextureFormat::RGBA32Float:
+        return format;
+    default:
+        return wgpu::TextureFormat::Undefined;
+    }
+}
+
+const MipMapGenerator::ComputePipelines& MipMapGenerator::getOrCreateComputePipelines(
+    const wgpu::Device& device,
+    wgpu::TextureFormat format)
+{
+    auto it = computePipelines.find(format);
+    if (it != computePipelines.end()) {
+        return it->second;
+    }
+
+    const auto storageFormat = getStorageFormat(format);
+    assert(storageFormat != wgpu::TextureFormat::Undefined);
+
+    ComputePipelines newPipelines;
+    for (std::uint32_t i = 0; i < newPipelines.size(); ++i) {
+        const auto numLevels = i + 1;
+
+        // 0 - input level, 1..numLevels - output levels
+        std::array<wgpu::BindGroupLayoutEntry, MAX_LEVELS_PER_DISPATCH + 1> entries{};
+        entries[0] = {
+            .binding = 0,
+            .visibility = wgpu::ShaderStage::Compute,
+            .texture =
+                {
+                    .sampleType = wgpu::TextureSampleType::UnfilterableFloat,
+                    .viewDimension = wgpu::TextureViewDimension::e2DArray,
+                },
+        };
+        for (std::uint32_t level = 1; level <= numLevels; ++level) {
+            entries[level] = {
+                .binding = level,
+                .visibility = wgpu::ShaderStage::Compute,
+                .storageTexture =
+                    {
+                        .access = wgpu::StorageTextureAccess::WriteOnly,
+                        .format = storageFormat,
+                        .viewDimension = wgpu::TextureViewDimension::e2DArray,
+                    },
+            };
+        }
+
+        const auto bindGroupLayoutDesc = wgpu::BindGroupLayoutDescriptor{
+            .label = "mip map generation bind group",
+            .entryCount = numLevels + 1,
+            .entries = entries.data(),
+        };
+        auto& pipeline = newPipelines[i];
+        pipeline.bindGroupLayout = device.CreateBindGroupLayout(&bindGroupLayoutDesc);
+
+        const auto source = makeComputeShaderSource(format, storageFormat, numLevels);
+        auto shaderCodeDesc = wgpu::ShaderModuleWGSLDescriptor{};
+        shaderCodeDesc.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
+        shaderCodeDesc.code = source.c_str();
+
+        const auto shaderDesc = wgpu::ShaderModuleDescriptor{
+            .nextInChain = reinterpret_cast<wgpu::ChainedStruct*>(&shaderCodeDesc),
+            .label = "mipmap generator (compute)",
+        };
+        const auto computeShaderModule = device.CreateShaderModule(&shaderDesc);
+        computeShaderModule.GetCompilationInfo(
+            util::defaultShaderCompilationCallback, (void*)"mipmap generator (compute)");
+
+        const wgpu::PipelineLayoutDescriptor layoutDesc{
+            .bindGroupLayoutCount = 1,
+            .bindGroupLayouts = &pipeline.bindGroupLayout,
+        };
+        const auto pipelineDesc = wgpu::ComputePipelineDescriptor{
+            .label = "mip map generation (compute)",
+            .layout = device.CreatePipelineLayout(&layoutDesc),
+            .compute =
+                {
+                    .module = computeShaderModule,
+                    .entryPoint = "cs_main",
+                },
+        };
+        pipeline.pipeline = device.CreateComputePipeline(&pipelineDesc);
+    }
+
+    auto [newIt, inserted] = computePipelines.emplace(format, std::move(newPipelines));
+    assert(inserted);
+    return newIt->second;
+}
+
 void MipMapGenerator::generateMips(
     const wgpu::Device& device,
     const wgpu::Queue& queue,
     const Texture& texture)
 {
+    assert(texture.mipLevelCount >= 1);
+    batchedTextures.push_back(texture);
+    if (!batching) {
+        submitBatch(device, queue);
+    }
+}
+
+void MipMapGenerator::flushBatch(const wgpu::Device& device, const wgpu::Queue& queue)
+{
+    batching = false;
+    submitBatch(device, queue);
+}
+
+void MipMapGenerator::initGPUTimer(const wgpu::Device& device)
+{
+    gpuTimer.init(device, GPU_TIMER_NUM_SECTIONS, "Mip generation timestamps");
+}
+
+MipMapGenerator::GPUTimings MipMapGenerator::getGPUTimings() const
+{
+    return GPUTimings{
+        .computeMs = gpuTimer.getSection(GPU_TIMER_COMPUTE).totalMs,
+        .renderMs = gpuTimer.getSection(GPU_TIMER_RENDER).totalMs,
+        .numComputeTextures = numTimedComputeTextures,
+        .numRenderTextures = numTimedRenderTextures,
+    };
+}
+
+bool MipMapGenerator::canUseCompute(const Texture& texture) const
+{
+    // textures which can't be written as storage were created without StorageBinding
+    return useCompute && (getStorageFormat(texture.format) != wgpu::TextureFormat::Undefined) &&
+           (texture.texture.GetUsage() & wgpu::TextureUsage::StorageBinding);
+}
+
+void MipMapGenerator::submitBatch(const wgpu::Device& device, const wgpu::Queue& queue)
+{
+    if (batchedTextures.empty()) {
+        return;
+    }
+
     const auto commandEncoderDesc = wgpu::CommandEncoderDescriptor{};
     const auto encoder = device.CreateCommandEncoder(&commandEncoderDesc);
 
-    assert(texture.mipLevelCount >= 1);
+    // compute textures go first, so that they're all recorded into one compute pass
+    const auto computeEnd = std::stable_partition(
+        batchedTextures.begin(), batchedTextures.end(), [this](const Texture& texture) {
+            return canUseCompute(texture);
+        });
+
+    if (computeEnd != batchedTextures.begin()) {
+        gpuTimer.begin(encoder, GPU_TIMER_COMPUTE);
+        const auto computePassDesc = wgpu::ComputePassDescriptor{
+            .label = "mip map generation",
+        };
+        const auto computePass = encoder.BeginComputePass(&computePassDesc);
+        computePass.PushDebugGroup("Generate mips");
+        ++stats.numPasses;
+
+        for (auto it = batchedTextures.begin(); it != computeEnd; ++it) {
+            recordMipsCompute(device, computePass, *it);
+        }
+
+        computePass.PopDebugGroup();
+        computePass.End();
+        gpuTimer.end(encoder, GPU_TIMER_COMPUTE);
+    }
+
+    if (computeEnd != batchedTextures.end()) {
+        gpuTimer.begin(encoder, GPU_TIMER_RENDER);
+        for (auto it = computeEnd; it != batchedTextures.end(); ++it) {
+            recordMipsRender(device, encoder, *it);
+        }
+        gpuTimer.end(encoder, GPU_TIMER_RENDER);
+    }
+
+    if (gpuTimer.resolve(encoder)) {
+        numTimedComputeTextures += computeEnd - batchedTextures.begin();
+        numTimedRenderTextures += batchedTextures.end() - computeEnd;
+    }
+    const auto cmdBufferDesc = wgpu::CommandBufferDescriptor{};
+    const auto command = encoder.Finish(&cmdBufferDesc);
+    queue.Submit(1, &command);
+    gpuTimer.readback();
 
+    stats.numTextures += batchedTextures.size();
+    ++stats.numSubmits;
+    batchedTextures.clear();
+}
+
+void MipMapGenerator::recordMipsRender(
+    const wgpu::Device& device,
+    const wgpu::CommandEncoder& encoder,
+    const Texture& texture)
+{
     const auto& pipeline = getOrCreatePipeline(device, texture.format);
 
     if (!texture.isCubemap) {
         for (int mipLevel = 0; mipLevel < (int)texture.mipLevelCount - 1; ++mipLevel) {
             generateMip(
                 device,
-                queue,
                 encoder,
                 pipeline,
                 texture.createView(mipLevel, 1),
@@ -173,7 +487,6 @@ void MipMapGenerator::generateMips(
             for (int mipLevel = 0; mipLevel < (int)texture.mipLevelCount - 1; ++mipLevel) {
                 generateMip(
                     device,
-                    queue,
                     encoder,
                     pipeline,
                     texture.createViewForCubeLayer(mipLevel, 1, layer),
@@ -181,19 +494,62 @@ void MipMapGenerator::generateMips(
             }
         }
     }
+}
 
-    const auto cmdBufferDesc = wgpu::CommandBufferDescriptor{};
-    const auto command = encoder.Finish(&cmdBufferDesc);
-    queue.Submit(1, &command);
+void MipMapGenerator::recordMipsCompute(
+    const wgpu::Device& device,
+    const wgpu::ComputePassEncoder& computePass,
+    const Texture& texture)
+{
+    const auto& pipelines = getOrCreateComputePipelines(device, texture.format);
+    const auto storageFormat = getStorageFormat(texture.format);
+    const auto numLayers = texture.isCubemap ? 6u : 1u;
+
+    for (std::uint32_t inputLevel = 0; inputLevel + 1 < texture.mipLevelCount;) {
+        const auto numLevels =
+            std::min(MAX_LEVELS_PER_DISPATCH, texture.mipLevelCount - 1 - inputLevel);
+        const auto& pipeline = pipelines[numLevels - 1];
+
+        // input level is read through a view with texture's (possibly sRGB) format
+        std::array<wgpu::BindGroupEntry, MAX_LEVELS_PER_DISPATCH + 1> bindings{};
+        bindings[0] = {
+            .binding = 0,
+            .textureView = createArrayView(texture, texture.format, inputLevel),
+        };
+        for (std::uint32_t level = 1; level <= numLevels; ++level) {
+            bindings[level] = {
+                .binding = level,
+                .textureView = createArrayView(texture, storageFormat, inputLevel + level),
+            };
+        }
+        stats.numTextureViews += numLevels + 1;
+
+        const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+            .layout = pipeline.bindGroupLayout,
+            .entryCount = numLevels + 1,
+            .entries = bindings.data(),
+        };
+        const auto bindGroup = device.CreateBindGroup(&bindGroupDesc);
+        ++stats.numBindGroups;
+
+        // one thread per texel of the first output level
+        const auto outputSize = glm::max(texture.size >> glm::ivec2(inputLevel + 1), 1);
+        const auto numGroupsX = static_cast<std::uint32_t>((outputSize.x + 7) / 8);
+        const auto numGroupsY = static_cast<std::uint32_t>((outputSize.y + 7) / 8);
+        computePass.SetPipeline(pipeline.pipeline);
+        computePass.SetBindGroup(0, bindGroup);
+        computePass.DispatchWorkgroups(numGroupsX, numGroupsY, numLayers);
+
+        inputLevel += numLevels;
+    }
 }
 
 void MipMapGenerator::generateMip(
     const wgpu::Device& device,
-    const wgpu::Queue& queue,
     const wgpu::CommandEncoder& encoder,
     const wgpu::RenderPipeline pipeline,
     const wgpu::TextureView& inputView,
-    const wgpu::TextureView& outputView) const
+    const wgpu::TextureView& outputView)
 {
     const std::array<wgpu::BindGroupEntry, 2> bindings{{
         {
@@ -211,6 +567,8 @@ void MipMapGenerator::generateMip(
         .entries = bindings.data(),
     };
     const auto bindGroup = device.CreateBindGroup(&bindGroupDesc);
+    ++stats.numBindGroups;
+    stats.numTextureViews += 2;
 
     const auto colorAttachment = wgpu::RenderPassColorAttachment{
         .view = outputView,
@@ -225,6 +583,7 @@ void MipMapGenerator::generateMip(
 
     const auto renderPass = encoder.BeginRenderPass(&renderPassDesc);
     renderPass.PushDebugGroup("Generate mips");
+    ++stats.numPasses;
 
     renderPass.SetPipeline(pipeline);
     renderPass.SetBindGroup(0, bindGroup);
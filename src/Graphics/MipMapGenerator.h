@@ -1,20 +1,83 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <unordered_map>
+#include <vector>
 
 #include <webgpu/webgpu_cpp.h>
 
-class Texture;
+#include <Graphics/GPUTimer.h>
+#include <Graphics/Texture.h>
 
+// Generates mips with a compute shader which downsamples up to
+// MAX_LEVELS_PER_DISPATCH levels per dispatch (through workgroup memory)
+// and writes them to storage texture views. All layers of a texture are
+// processed by the same dispatches.
+// Formats which can't be used for storage fall back to rendering each level
+// of each layer in its own render pass.
+// Mips of textures passed to generateMips between beginBatch and flushBatch
+// are recorded into one command encoder (and one compute pass) and submitted
+// once by flushBatch.
 class MipMapGenerator {
+public:
+    // Objects created by generateMips (cumulative)
+    struct Stats {
+        std::size_t numTextures{0};
+        std::size_t numPasses{0};
+        std::size_t numBindGroups{0};
+        std::size_t numTextureViews{0};
+        std::size_t numSubmits{0};
+    };
+
+    // GPU time of mip generation (cumulative), only measured after initGPUTimer
+    struct GPUTimings {
+        double computeMs{0.0};
+        double renderMs{0.0};
+        std::size_t numComputeTextures{0}; // in timed batches
+        std::size_t numRenderTextures{0};
+    };
+
+    static constexpr std::uint32_t MAX_LEVELS_PER_DISPATCH = 4;
+
 public:
     void init(const wgpu::Device& device, const wgpu::ShaderModule& fullscreenTriangleShaderModule);
 
     const wgpu::BindGroupLayout& getTextureGroupLayout() { return textureGroupLayout; }
 
+    // Returns the format which compute path writes mips of format as or
+    // Undefined if they can only be generated by rendering.
+    // sRGB formats can't be used for storage, so sRGB textures should be created
+    // with the returned format, StorageBinding usage and format as a view format.
+    static wgpu::TextureFormat getStorageFormat(wgpu::TextureFormat format);
+
+    // Generates mips from level 0 which must already be uploaded - either
+    // immediately or, if a batch is open, when the batch is flushed
     void generateMips(const wgpu::Device& device, const wgpu::Queue& queue, const Texture& texture);
 
+    // does nothing if a batch is already open
+    void beginBatch() { batching = true; }
+    void flushBatch(const wgpu::Device& device, const wgpu::Queue& queue);
+    bool isBatching() const { return batching; }
+
+    const Stats& getStats() const { return stats; }
+
+    // Times each flushed batch, does nothing if the device doesn't support timestamp queries
+    void initGPUTimer(const wgpu::Device& device);
+    bool isGPUTimerEnabled() const { return gpuTimer.isEnabled(); }
+    GPUTimings getGPUTimings() const;
+
+    bool useCompute{true};
+
 private:
+    struct ComputePipeline {
+        wgpu::BindGroupLayout bindGroupLayout;
+        wgpu::ComputePipeline pipeline;
+    };
+    // index is the number of generated levels - 1
+    using ComputePipelines = std::array<ComputePipeline, MAX_LEVELS_PER_DISPATCH>;
+
     const wgpu::RenderPipeline& createPipelineForFormat(
         const wgpu::Device& device,
         wgpu::TextureFormat format);
@@ -22,13 +85,29 @@ private:
         const wgpu::Device& device,
         wgpu::TextureFormat format);
 
+    const ComputePipelines& getOrCreateComputePipelines(
+        const wgpu::Device& device,
+        wgpu::TextureFormat format);
+
+    bool canUseCompute(const Texture& texture) const;
+
+    void submitBatch(const wgpu::Device& device, const wgpu::Queue& queue);
+
+    void recordMipsCompute(
+        const wgpu::Device& device,
+        const wgpu::ComputePassEncoder& computePass,
+        const Texture& texture);
+    void recordMipsRender(
+        const wgpu::Device& device,
+        const wgpu::CommandEncoder& encoder,
+        const Texture& texture);
+
     void generateMip(
         const wgpu::Device& device,
-        const wgpu::Queue& queue,
         const wgpu::CommandEncoder& encoder,
         const wgpu::RenderPipeline pipeline,
         const wgpu::TextureView& inputView,
-        const wgpu::TextureView& outputView) const;
+        const wgpu::TextureView& outputView);
 
     wgpu::ShaderModule fullscreenTriangleShaderModule;
     wgpu::ShaderModule shaderModule;
@@ -36,4 +115,19 @@ private:
     wgpu::Sampler linearSampler;
 
     std::unordered_map<wgpu::TextureFormat, wgpu::RenderPipeline> pipelines;
+    std::unordered_map<wgpu::TextureFormat, ComputePipelines> computePipelines;
+
+    std::vector<Texture> batchedTextures;
+    bool batching{false};
+
+    Stats stats;
+
+    enum GPUTimerSection : std::size_t {
+        GPU_TIMER_COMPUTE,
+        GPU_TIMER_RENDER,
+        GPU_TIMER_NUM_SECTIONS,
+    };
+    GPUTimer gpuTimer;
+    std::size_t numTimedComputeTextures{0};
+    std::size_t numTimedRenderTextures{0};
 };
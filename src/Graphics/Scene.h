@@ -17,6 +17,9 @@ struct SceneNode {
     std::size_t meshIndex;
     int skinId{-1};
 
+    // EXT_mesh_gpu_instancing (mesh is drawn once per instance transform)
+    std::vector<Transform> instances;
+
     SceneNode* parent{nullptr};
     std::vector<std::unique_ptr<SceneNode>> children;
 };
@@ -28,6 +31,8 @@ struct SceneMesh {
 struct Scene {
     std::vector<SceneMesh> meshes;
     std::vector<std::unique_ptr<SceneNode>> nodes;
+    // moved to SkeletonCache/AnimationCache when the scene is uploaded
     std::vector<Skeleton> skeletons;
-    std::unordered_map<std::string, SkeletalAnimation> animations;
+    std::unordered_map<std::string, SkeletalAnimation> animations; // of skeletons[0]
+    std::vector<SkeletonId> skeletonIds; // index = SceneNode::skinId
 };
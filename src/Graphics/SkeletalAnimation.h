@@ -1,16 +1,42 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/vec3.hpp>
 
+using AnimationId = std::size_t;
+static const AnimationId NULL_ANIMATION_ID = std::numeric_limits<AnimationId>::max();
+
+// Keys are stored compressed (see AnimationCompression.h) and are
+// decompressed by the sampler.
 struct SkeletalAnimation {
+    // Each track has its own key times (in seconds, sorted, starting at 0),
+    // keys can be placed at arbitrary intervals. Empty tracks keep identity
+    // transform, tracks with one key are constant.
+
+    // each component is quantized to 16 bits: value = rangeMin + key * rangeScale
+    struct Vec3Track {
+        std::vector<float> times;
+        std::vector<std::array<std::uint16_t, 3>> keys;
+        glm::vec3 rangeMin{};
+        glm::vec3 rangeScale{};
+    };
+
+    // smallest-three quaternions in 48 bits
+    struct RotationTrack {
+        std::vector<float> times;
+        std::vector<std::array<std::uint16_t, 3>> keys;
+    };
+
     struct Tracks {
-        std::vector<glm::vec3> translations;
-        std::vector<glm::quat> rotations;
-        std::vector<glm::vec3> scales;
+        Vec3Track translations;
+        RotationTrack rotations;
+        Vec3Track scales;
     };
 
     std::vector<Tracks> tracks; // index = jointId
@@ -1 +1,16 @@
 #include <Graphics/Skeleton.h>
+
+void calculateJointDepths(Skeleton& skeleton)
+{
+    const auto numJoints = skeleton.parents.size();
+    skeleton.jointDepths.resize(numJoints);
+    // parents come before their children
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        const auto parentId = skeleton.parents[jointId];
+        std::uint16_t depth = 0;
+        if (parentId != NULL_JOINT_ID) {
+            depth = skeleton.jointDepths[parentId] + 1;
+        }
+        skeleton.jointDepths[jointId] = depth;
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <limits>
 #include <string>
 #include <vector>
@@ -8,6 +9,8 @@
 
 #include <Math/Transform.h>
 
+using SkeletonId = std::size_t;
+
 using JointId = std::uint16_t;
 static const JointId NULL_JOINT_ID = std::numeric_limits<JointId>::max();
 static const JointId ROOT_JOINT_ID = 0;
@@ -17,13 +20,19 @@ struct Joint {
     Transform localTransform;
 };
 
+// Joints are sorted so that parents always come before their children
+// (JointId of a parent is always less than JointId of its child), so the
+// whole pose can be evaluated in one linear pass over the joints.
 struct Skeleton {
-    struct JointNode {
-        std::vector<JointId> children;
-    };
-    std::vector<JointNode> hierarchy;
+    std::vector<JointId> parents; // NULL_JOINT_ID for root
     std::vector<glm::mat4> inverseBindMatrices;
 
     std::vector<Joint> joints;
     std::vector<std::string> jointNames;
+
+    // number of ancestors of each joint (0 for roots), see calculateJointDepths
+    std::vector<std::uint16_t> jointDepths;
 };
+
+// Fills skeleton.jointDepths from skeleton.parents
+void calculateJointDepths(Skeleton& skeleton);
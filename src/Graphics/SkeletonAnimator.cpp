@@ -1,16 +1,21 @@
 #include <Graphics/SkeletonAnimator.h>
 
+#include <Graphics/AnimationCompression.h>
 #include <Graphics/SkeletalAnimation.h>
 #include <Graphics/Skeleton.h>
 
+#include <algorithm>
+#include <cassert>
+#include <span>
 #include <tuple>
 
 #include <glm/gtx/compatibility.hpp> // lerp for vec3
 
-namespace
+void SkeletonPose::resize(std::size_t numJoints)
 {
-static const int ANIMATION_FPS = 30;
-static const glm::mat4 I{1.f};
+    translations.resize(numJoints);
+    rotations.resize(numJoints);
+    scales.resize(numJoints);
 }
 
 void SkeletonAnimator::setAnimation(const Skeleton& skeleton, const SkeletalAnimation& animation)
@@ -19,13 +24,17 @@ void SkeletonAnimator::setAnimation(const Skeleton& skeleton, const SkeletalAnim
         return; // TODO: allow to reset animation
     }
 
-    jointMatrices.resize(skeleton.joints.size());
+    const auto numJoints = skeleton.joints.size();
+    pose.resize(numJoints);
+    keyCursors.assign(numJoints * 3, 0);
+    modelMatrices.resize(numJoints);
+    jointMatrices.resize(numJoints);
 
     time = 0.f;
     animationFinished = false;
     this->animation = &animation;
 
-    calculateJointMatrices(skeleton);
+    calculateJointMatrices(skeleton, time);
 }
 
 void SkeletonAnimator::update(const Skeleton& skeleton, float dt)
@@ -34,6 +43,16 @@ void SkeletonAnimator::update(const Skeleton& skeleton, float dt)
         return;
     }
 
+    advance(dt);
+    calculateJointMatrices(skeleton, time);
+}
+
+void SkeletonAnimator::advance(float dt)
+{
+    if (!animation || animationFinished) {
+        return;
+    }
+
     time += dt;
     if (time > animation->duration) { // loop
         if (animation->looped) {
@@ -43,8 +62,23 @@ void SkeletonAnimator::update(const Skeleton& skeleton, float dt)
             animationFinished = true;
         }
     }
+}
+
+std::size_t SkeletonAnimator::evaluate(
+    const Skeleton& skeleton,
+    float sampleTime,
+    std::uint16_t maxJointDepth)
+{
+    assert(animation);
+    return calculateJointMatrices(
+        skeleton, std::clamp(sampleTime, 0.f, animation->duration), maxJointDepth);
+}
 
-    calculateJointMatrices(skeleton);
+void SkeletonAnimator::copyJointMatrices(const SkeletonAnimator& poseOwner)
+{
+    assert(poseOwner.jointMatrices.size() == jointMatrices.size());
+    jointMatrices = poseOwner.jointMatrices;
+    ++poseVersion;
 }
 
 const std::string& SkeletonAnimator::getCurrentAnimationName() const
@@ -56,82 +90,153 @@ const std::string& SkeletonAnimator::getCurrentAnimationName() const
 namespace
 {
 
-std::tuple<std::size_t, std::size_t, float> findPrevNextKeys(std::size_t numKeys, float time)
+// how many keys forward playback advances the cursor by linearly before
+// falling back to binary search (e.g. after a big dt or a seek)
+static const std::uint32_t MAX_CURSOR_STEPS = 4;
+
+// Returns prev/next key and interpolation factor between them.
+// cursor is the prev key found by the previous call for this channel: during
+// forward playback the next search starts from it, so it's O(1) amortized.
+std::tuple<std::size_t, std::size_t, float> findPrevNextKeys(
+    std::span<const float> times,
+    float time,
+    std::uint32_t& cursor)
 {
-    // keys are sampled by ANIMATION_FPS, so finding prev/next key is easy
-    const std::size_t prevKey =
-        std::min((std::size_t)std::floor(time * ANIMATION_FPS), numKeys - 1);
-    const std::size_t nextKey = std::min(prevKey + 1, numKeys - 1);
-
-    float t{0.f};
-    if (prevKey != nextKey) {
-        t = time * ANIMATION_FPS - (float)prevKey;
+    const auto numKeys = static_cast<std::uint32_t>(times.size());
+    if (numKeys == 1 || time <= times[0]) {
+        cursor = 0;
+        return {0, 0, 0.f};
+    }
+    if (time >= times[numKeys - 1]) {
+        cursor = numKeys - 1;
+        return {numKeys - 1, numKeys - 1, 0.f};
     }
 
+    // times[0] < time < times[numKeys - 1], so prevKey < numKeys - 1
+    auto prevKey = cursor;
+    bool found = false;
+    if (prevKey < numKeys - 1 && times[prevKey] <= time) {
+        for (std::uint32_t step = 0; step < MAX_CURSOR_STEPS; ++step) {
+            if (time < times[prevKey + 1]) {
+                found = true;
+                break;
+            }
+            ++prevKey;
+        }
+    }
+    if (!found) { // went backwards (looped/seeked) or too far forward
+        const auto it = std::upper_bound(times.begin(), times.end(), time);
+        prevKey = static_cast<std::uint32_t>(std::distance(times.begin(), it)) - 1;
+    }
+    cursor = prevKey;
+
+    const auto nextKey = prevKey + 1;
+    const auto t = (time - times[prevKey]) / (times[nextKey] - times[prevKey]);
     return {prevKey, nextKey, t};
 }
 
-glm::mat4 sampleAnimation(const SkeletalAnimation& animation, JointId jointId, float time)
+// Joints for which isCulled returns true are not sampled
+template<typename IsCulledF>
+void sampleAnimation(
+    const SkeletalAnimation& animation,
+    float time,
+    std::span<std::uint32_t> keyCursors,
+    SkeletonPose& pose,
+    IsCulledF isCulled)
 {
-    const auto& ts = animation.tracks[jointId];
-
-    auto tm = I;
+    const auto numJoints = animation.tracks.size();
+    assert(pose.translations.size() == numJoints);
+    assert(keyCursors.size() == numJoints * 3);
 
-    { // translation
-        const auto& tc = ts.translations;
-        if (!tc.empty()) {
-            const auto [p, n, t] = findPrevNextKeys(tc.size(), time);
-            const auto pos = glm::lerp(tc[p], tc[n], t);
-            tm[3] = glm::vec4(pos, 1.f);
+    // joints without keys stay in identity transform
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        if (isCulled(jointId)) {
+            continue;
+        }
+        const auto& track = animation.tracks[jointId].translations;
+        if (track.keys.empty()) {
+            pose.translations[jointId] = glm::vec3{0.f};
+            continue;
         }
+        const auto [p, n, t] = findPrevNextKeys(track.times, time, keyCursors[jointId * 3 + 0]);
+        pose.translations[jointId] = glm::lerp(decompressKey(track, p), decompressKey(track, n), t);
     }
 
-    { // rotation
-        const auto& rc = ts.rotations;
-        if (!rc.empty()) {
-            const auto [p, n, t] = findPrevNextKeys(rc.size(), time);
-            const auto rot = glm::slerp(rc[p], rc[n], t);
-            tm *= glm::mat4_cast(rot);
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        if (isCulled(jointId)) {
+            continue;
         }
+        const auto& track = animation.tracks[jointId].rotations;
+        if (track.keys.empty()) {
+            pose.rotations[jointId] = glm::identity<glm::quat>();
+            continue;
+        }
+        const auto [p, n, t] = findPrevNextKeys(track.times, time, keyCursors[jointId * 3 + 1]);
+        pose.rotations[jointId] = glm::slerp(decompressKey(track, p), decompressKey(track, n), t);
     }
 
-    // TODO: one more potential optimization: if there's no scaling in
-    // animation, we can skip this calculating the scale.
-
-    { // scale
-        const auto& sc = ts.scales;
-        if (!sc.empty()) {
-            const auto [p, n, t] = findPrevNextKeys(sc.size(), time);
-            const auto scale = glm::lerp(sc[p], sc[n], t);
-            tm = glm::scale(tm, scale);
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        if (isCulled(jointId)) {
+            continue;
+        }
+        const auto& track = animation.tracks[jointId].scales;
+        if (track.keys.empty()) {
+            pose.scales[jointId] = glm::vec3{1.f};
+            continue;
         }
+        const auto [p, n, t] = findPrevNextKeys(track.times, time, keyCursors[jointId * 3 + 2]);
+        pose.scales[jointId] = glm::lerp(decompressKey(track, p), decompressKey(track, n), t);
     }
-
-    return tm;
 }
 
 } // end of anonymous namespace
 
-void SkeletonAnimator::calculateJointMatrices(const Skeleton& skeleton)
-{
-    static const glm::mat4 I{1.f};
-    calculateJointMatrix(skeleton, ROOT_JOINT_ID, *animation, time, I);
-}
-
-void SkeletonAnimator::calculateJointMatrix(
+std::size_t SkeletonAnimator::calculateJointMatrices(
     const Skeleton& skeleton,
-    JointId jointId,
-    const SkeletalAnimation& animation,
-    float time,
-    const glm::mat4& parentTransform)
+    float sampleTime,
+    std::uint16_t maxJointDepth)
 {
-    const auto localTransform = sampleAnimation(animation, jointId, time);
-    const auto modelTransform = parentTransform * localTransform;
-    jointMatrices[jointId] = modelTransform * skeleton.inverseBindMatrices[jointId];
+    const auto numJoints = skeleton.parents.size();
+    const auto cullJoints = (maxJointDepth != ALL_JOINTS_DEPTH);
+    assert(!cullJoints || skeleton.jointDepths.size() == numJoints);
+    const auto isCulled = [&skeleton, cullJoints, maxJointDepth](std::size_t jointId) {
+        return cullJoints && skeleton.jointDepths[jointId] > maxJointDepth;
+    };
+
+    sampleAnimation(*animation, sampleTime, keyCursors, pose, isCulled);
+
+    // local transforms (T * R * S), independent for each joint
+    std::size_t numSampledJoints = 0;
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        if (isCulled(jointId)) {
+            continue;
+        }
+        auto& m = modelMatrices[jointId];
+        m = glm::mat4_cast(pose.rotations[jointId]);
+        m[0] *= pose.scales[jointId].x;
+        m[1] *= pose.scales[jointId].y;
+        m[2] *= pose.scales[jointId].z;
+        m[3] = glm::vec4(pose.translations[jointId], 1.f);
+        ++numSampledJoints;
+    }
 
-    for (const auto childIdx : skeleton.hierarchy[jointId].children) {
-        calculateJointMatrix(skeleton, childIdx, animation, time, modelTransform);
+    // parents come before children, so their model matrices are already calculated
+    for (std::size_t jointId = 0; jointId < numJoints; ++jointId) {
+        const auto parentId = skeleton.parents[jointId];
+        if (isCulled(jointId)) {
+            // culled joints follow their parents rigidly in bind pose
+            // (roots are never culled)
+            modelMatrices[jointId] =
+                modelMatrices[parentId] * skeleton.joints[jointId].localTransform.asMatrix();
+        } else if (parentId != NULL_JOINT_ID) {
+            modelMatrices[jointId] = modelMatrices[parentId] * modelMatrices[jointId];
+        }
+        jointMatrices[jointId] = glm::mat3x4(
+            glm::transpose(modelMatrices[jointId] * skeleton.inverseBindMatrices[jointId]));
     }
+
+    ++poseVersion;
+    return numSampledJoints;
 }
 
 void SkeletonAnimator::setNormalizedProgress(float t)
@@ -140,6 +245,16 @@ void SkeletonAnimator::setNormalizedProgress(float t)
     time = t * animation->duration;
 }
 
+std::size_t SkeletonAnimator::getMemoryUsage() const
+{
+    return pose.translations.capacity() * sizeof(glm::vec3) +
+           pose.rotations.capacity() * sizeof(glm::quat) +
+           pose.scales.capacity() * sizeof(glm::vec3) +
+           keyCursors.capacity() * sizeof(std::uint32_t) +
+           modelMatrices.capacity() * sizeof(glm::mat4) +
+           jointMatrices.capacity() * sizeof(glm::mat3x4);
+}
+
 float SkeletonAnimator::getNormalizedProgress() const
 {
     if (!animation) {
@@ -1,20 +1,49 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat3x4.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
 
 #include <Graphics/Skeleton.h>
 
 struct SkeletalAnimation;
 
+// Local joint transforms stored as SoA, index = JointId
+struct SkeletonPose {
+    std::vector<glm::vec3> translations;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+
+    void resize(std::size_t numJoints);
+};
+
 class SkeletonAnimator {
 public:
     void setAnimation(const Skeleton& skeleton, const SkeletalAnimation& animation);
 
+    // advance + recalculates joint matrices (if the animation is still playing)
     void update(const Skeleton& skeleton, float dt);
 
+    // only advances animation time, joint matrices are not recalculated
+    void advance(float dt);
+    // recalculates joint matrices at sampleTime instead of the current time
+    // (used to share poses between animators, see PoseCache)
+    // Only joints up to maxJointDepth are sampled, deeper joints keep their
+    // bind pose transforms relative to their parents (used for animation LOD).
+    // Returns the number of sampled joints.
+    std::size_t evaluate(
+        const Skeleton& skeleton,
+        float sampleTime,
+        std::uint16_t maxJointDepth = ALL_JOINTS_DEPTH);
+
+    static constexpr std::uint16_t ALL_JOINTS_DEPTH = std::numeric_limits<std::uint16_t>::max();
+
     const SkeletalAnimation* getAnimation() const { return animation; }
     const std::string& getCurrentAnimationName() const;
 
@@ -25,20 +54,34 @@ public:
     void setNormalizedProgress(float t);
     float getNormalizedProgress() const;
 
-    const std::vector<glm::mat4>& getJointMatrices() const { return jointMatrices; };
+    // Joint matrices are affine, so only their first three rows are stored
+    // (as columns of mat3x4, which matches mat3x4f in WGSL): vec4 * mat3x4
+    // transforms a point
+    const std::vector<glm::mat3x4>& getJointMatrices() const { return jointMatrices; };
+    // Takes joint matrices evaluated by another animator of the same skeleton
+    // (see PoseCache), so that they're kept until this animator is evaluated again
+    void copyJointMatrices(const SkeletonAnimator& poseOwner);
+    // changes every time joint matrices are recalculated or copied
+    std::uint32_t getPoseVersion() const { return poseVersion; }
+
+    // heap memory used by animator state
+    std::size_t getMemoryUsage() const;
 
 private:
-    void calculateJointMatrices(const Skeleton& skeleton);
-    void calculateJointMatrix(
+    std::size_t calculateJointMatrices(
         const Skeleton& skeleton,
-        JointId jointId,
-        const SkeletalAnimation& animation,
-        float time,
-        const glm::mat4& parentTransform);
+        float sampleTime,
+        std::uint16_t maxJointDepth = ALL_JOINTS_DEPTH);
 
     float time{0}; // current animation time (in seconds)
     const SkeletalAnimation* animation{nullptr};
     bool animationFinished{false};
 
-    std::vector<glm::mat4> jointMatrices;
+    SkeletonPose pose;
+    // prev key found by the last sample, 3 per joint (translation, rotation, scale)
+    std::vector<std::uint32_t> keyCursors;
+    std::vector<glm::mat4> modelMatrices; // joint -> model space
+    // transposed (model matrices * inverse bind matrices), see getJointMatrices
+    std::vector<glm::mat3x4> jointMatrices;
+    std::uint32_t poseVersion{0};
 };
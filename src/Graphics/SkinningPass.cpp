@@ -0,0 +1,285 @@
+#include "SkinningPass.h"
+
+#include <array>
+#include <cassert>
+#include <string>
+#include <string_view>
+
+#include <util/WebGPUUtil.h>
+
+namespace
+{
+// jointIds and weights are packed as described in Mesh.h
+const char* narrowSkinAttribsSource = R"(
+@group(GROUP) @binding(JOINT_IDS_BINDING) var<storage, read> jointIds: array<u32>;
+@group(GROUP) @binding(WEIGHTS_BINDING) var<storage, read> weights: array<u32>;
+
+fn getJointIds(vertexIndex: u32) -> vec4u {
+    let ids = jointIds[vertexIndex];
+    return vec4u(ids & 0xffu, (ids >> 8u) & 0xffu, (ids >> 16u) & 0xffu, ids >> 24u);
+}
+
+fn getWeights(vertexIndex: u32) -> vec4f {
+    return unpack4x8unorm(weights[vertexIndex]);
+}
+)";
+
+const char* wideSkinAttribsSource = R"(
+@group(GROUP) @binding(JOINT_IDS_BINDING) var<storage, read> jointIds: array<vec2u>;
+@group(GROUP) @binding(WEIGHTS_BINDING) var<storage, read> weights: array<vec2u>;
+
+fn getJointIds(vertexIndex: u32) -> vec4u {
+    let ids = jointIds[vertexIndex];
+    return vec4u(ids.x & 0xffffu, ids.x >> 16u, ids.y & 0xffffu, ids.y >> 16u);
+}
+
+fn getWeights(vertexIndex: u32) -> vec4f {
+    let w = weights[vertexIndex];
+    return vec4f(unpack2x16unorm(w.x), unpack2x16unorm(w.y));
+}
+)";
+
+const char* skinMatrixSource = R"(
+// rows of affine joint matrices, transforms points as "pos * skinMatrix"
+@group(GROUP) @binding(JOINT_MATRICES_BINDING) var<storage, read> jointMatrices: array<mat3x4f>;
+
+fn getSkinMatrix(vertexIndex: u32) -> mat3x4f {
+    let jointIds = getJointIds(vertexIndex);
+    let weights = getWeights(vertexIndex);
+    return weights.x * jointMatrices[jointIds.x] +
+        weights.y * jointMatrices[jointIds.y] +
+        weights.z * jointMatrices[jointIds.z] +
+        weights.w * jointMatrices[jointIds.w];
+}
+)";
+
+const char* shaderSource = R"(
+@group(0) @binding(0) var<storage, read> positions: array<vec4f>;
+@group(0) @binding(1) var<storage, read> normals: array<vec4f>;
+@group(0) @binding(5) var<storage, read_write> skinnedPositions: array<vec4f>;
+@group(0) @binding(6) var<storage, read_write> skinnedNormals: array<vec4f>;
+
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id: vec3u) {
+    let vertexIndex = id.x;
+    if (vertexIndex >= arrayLength(&positions)) {
+        return;
+    }
+
+    let skinMatrix = getSkinMatrix(vertexIndex);
+    skinnedPositions[vertexIndex] = vec4(positions[vertexIndex] * skinMatrix, 1.0);
+    let normal = vec4(normals[vertexIndex].xyz, 0.0) * skinMatrix;
+    skinnedNormals[vertexIndex] = vec4(normalize(normal), 1.0);
+}
+)";
+
+void replaceAll(std::string& str, std::string_view from, std::string_view to)
+{
+    for (auto pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos)) {
+        str.replace(pos, from.size(), to);
+        pos += to.size();
+    }
+}
+
+const std::uint32_t WORKGROUP_SIZE = 64;
+}
+
+std::string makeSkinningShaderSource(
+    std::uint32_t group,
+    std::uint32_t firstBinding,
+    bool wideSkinAttribs)
+{
+    std::string source = wideSkinAttribs ? wideSkinAttribsSource : narrowSkinAttribsSource;
+    source += skinMatrixSource;
+    replaceAll(source, "JOINT_IDS_BINDING", std::to_string(firstBinding));
+    replaceAll(source, "WEIGHTS_BINDING", std::to_string(firstBinding + 1));
+    replaceAll(source, "JOINT_MATRICES_BINDING", std::to_string(firstBinding + 2));
+    replaceAll(source, "GROUP", std::to_string(group));
+    return source;
+}
+
+void SkinningPass::init(const wgpu::Device& device, std::uint32_t storageBufferOffsetAlignment)
+{
+    this->storageBufferOffsetAlignment = storageBufferOffsetAlignment;
+
+    { // bind group layout
+        // 0-3 - positions, normals, jointIds, weights
+        // 4 - jointMatrices
+        // 5-6 - skinned positions, skinned normals
+        std::array<wgpu::BindGroupLayoutEntry, 7> bindGroupLayoutEntries{};
+        for (std::uint32_t i = 0; i < bindGroupLayoutEntries.size(); ++i) {
+            bindGroupLayoutEntries[i] = {
+                .binding = i,
+                .visibility = wgpu::ShaderStage::Compute,
+                .buffer =
+                    {
+                        .type = (i < 5) ? wgpu::BufferBindingType::ReadOnlyStorage :
+                                          wgpu::BufferBindingType::Storage,
+                    },
+            };
+        }
+
+        const auto bindGroupLayoutDesc = wgpu::BindGroupLayoutDescriptor{
+            .label = "skinning bind group",
+            .entryCount = bindGroupLayoutEntries.size(),
+            .entries = bindGroupLayoutEntries.data(),
+        };
+        bindGroupLayout = device.CreateBindGroupLayout(&bindGroupLayoutDesc);
+    }
+
+    const wgpu::PipelineLayoutDescriptor layoutDesc{
+        .bindGroupLayoutCount = 1,
+        .bindGroupLayouts = &bindGroupLayout,
+    };
+    const auto pipelineLayout = device.CreatePipelineLayout(&layoutDesc);
+
+    // one pipeline per skin attrib format
+    for (std::size_t i = 0; i < pipelines.size(); ++i) {
+        const auto wideSkinAttribs = (i == 1);
+        const auto label = wideSkinAttribs ? "skinning (wide)" : "skinning";
+
+        const auto source = makeSkinningShaderSource(0, 2, wideSkinAttribs) + shaderSource;
+        auto shaderCodeDesc = wgpu::ShaderModuleWGSLDescriptor{};
+        shaderCodeDesc.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
+        shaderCodeDesc.code = source.c_str();
+
+        const auto shaderDesc = wgpu::ShaderModuleDescriptor{
+            .nextInChain = reinterpret_cast<wgpu::ChainedStruct*>(&shaderCodeDesc),
+            .label = label,
+        };
+        const auto shaderModule = device.CreateShaderModule(&shaderDesc);
+        shaderModule.GetCompilationInfo(util::defaultShaderCompilationCallback, (void*)label);
+
+        const auto pipelineDesc = wgpu::ComputePipelineDescriptor{
+            .label = label,
+            .layout = pipelineLayout,
+            .compute =
+                {
+                    .module = shaderModule,
+                    .entryPoint = "cs_main",
+                },
+        };
+        pipelines[i] = device.CreateComputePipeline(&pipelineDesc);
+    }
+}
+
+SkinningPass::Output SkinningPass::createOutput(const wgpu::Device& device, const GPUMesh& mesh)
+    const
+{
+    assert(mesh.hasSkeleton);
+    const auto& positions = mesh.attribs[0];
+    const auto& normals = mesh.attribs[1];
+    assert(positions.size == normals.size);
+
+    // normals are bound at an offset, so it has to be aligned
+    const auto alignment = static_cast<std::uint64_t>(storageBufferOffsetAlignment);
+    const auto normalsOffset = (positions.size + alignment - 1) / alignment * alignment;
+
+    Output output{
+        .positions = {.offset = 0, .size = positions.size},
+        .normals = {.offset = normalsOffset, .size = normals.size},
+        .numVertices = static_cast<std::uint32_t>(positions.size / sizeof(float[4])),
+        .wideSkinAttribs = mesh.wideSkinAttribs,
+    };
+
+    const auto bufferDesc = wgpu::BufferDescriptor{
+        .label = "skinned vertex buffer",
+        .usage = wgpu::BufferUsage::Storage,
+        .size = normalsOffset + normals.size,
+    };
+    output.buffer = device.CreateBuffer(&bufferDesc);
+    return output;
+}
+
+wgpu::BindGroup SkinningPass::createBindGroup(
+    const wgpu::Device& device,
+    const GPUMesh& mesh,
+    const wgpu::Buffer& jointMatricesBuffer,
+    std::uint64_t jointMatricesOffset,
+    std::uint64_t jointMatricesSize,
+    const Output& output) const
+{
+    assert(mesh.hasSkeleton && mesh.attribs.size() == 6);
+    const auto& positions = mesh.attribs[0];
+    const auto& normals = mesh.attribs[1];
+    const auto& jointIds = mesh.attribs[4];
+    const auto& weights = mesh.attribs[5];
+
+    const std::array<wgpu::BindGroupEntry, 7> bindings{{
+        {
+            .binding = 0,
+            .buffer = mesh.vertexBuffer,
+            .offset = positions.offset,
+            .size = positions.size,
+        },
+        {
+            .binding = 1,
+            .buffer = mesh.vertexBuffer,
+            .offset = normals.offset,
+            .size = normals.size,
+        },
+        {
+            .binding = 2,
+            .buffer = mesh.vertexBuffer,
+            .offset = jointIds.offset,
+            .size = jointIds.size,
+        },
+        {
+            .binding = 3,
+            .buffer = mesh.vertexBuffer,
+            .offset = weights.offset,
+            .size = weights.size,
+        },
+        {
+            .binding = 4,
+            .buffer = jointMatricesBuffer,
+            .offset = jointMatricesOffset,
+            .size = jointMatricesSize,
+        },
+        {
+            .binding = 5,
+            .buffer = output.buffer,
+            .offset = output.positions.offset,
+            .size = output.positions.size,
+        },
+        {
+            .binding = 6,
+            .buffer = output.buffer,
+            .offset = output.normals.offset,
+            .size = output.normals.size,
+        },
+    }};
+
+    const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+        .label = "skinning bind group",
+        .layout = bindGroupLayout,
+        .entryCount = bindings.size(),
+        .entries = bindings.data(),
+    };
+    return device.CreateBindGroup(&bindGroupDesc);
+}
+
+void SkinningPass::record(
+    const wgpu::CommandEncoder& encoder,
+    std::span<const Dispatch> dispatches) const
+{
+    if (dispatches.empty()) {
+        return;
+    }
+
+    const auto computePassDesc = wgpu::ComputePassDescriptor{
+        .label = "skinning",
+    };
+    const auto computePass = encoder.BeginComputePass(&computePassDesc);
+    computePass.PushDebugGroup("Skin meshes");
+
+    for (const auto& dispatch : dispatches) {
+        computePass.SetPipeline(pipelines[dispatch.wideSkinAttribs ? 1 : 0]);
+        computePass.SetBindGroup(0, dispatch.bindGroup);
+        const auto numWorkgroups = (dispatch.numVertices + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+        computePass.DispatchWorkgroups(numWorkgroups);
+    }
+
+    computePass.PopDebugGroup();
+    computePass.End();
+}
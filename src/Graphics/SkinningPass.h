@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <Graphics/GPUMesh.h>
+
+// WGSL code which declares jointIds, weights and jointMatrices bindings
+// (firstBinding, firstBinding + 1 and firstBinding + 2) and
+// getSkinMatrix(vertexIndex) function. Shared by skinning and mesh shaders.
+std::string makeSkinningShaderSource(
+    std::uint32_t group,
+    std::uint32_t firstBinding,
+    bool wideSkinAttribs);
+
+// Skins meshes in a compute pass: positions and normals are transformed by
+// joint matrices once per frame and written into per-entity output buffers.
+// Skinned meshes are then drawn in the same way as static meshes, so every
+// pass which draws them doesn't need to skin them again.
+class SkinningPass {
+public:
+    // Skinned positions and normals of one mesh (laid out like GPUMesh attribs)
+    struct Output {
+        wgpu::Buffer buffer;
+        GPUMesh::AttribProps positions;
+        GPUMesh::AttribProps normals;
+        std::uint32_t numVertices{0};
+        bool wideSkinAttribs{false}; // of the skinned mesh, see Mesh::jointIds
+    };
+
+    struct Dispatch {
+        wgpu::BindGroup bindGroup;
+        std::uint32_t numVertices;
+        bool wideSkinAttribs;
+    };
+
+public:
+    // storageBufferOffsetAlignment is minStorageBufferOffsetAlignment of the device
+    void init(const wgpu::Device& device, std::uint32_t storageBufferOffsetAlignment);
+
+    Output createOutput(const wgpu::Device& device, const GPUMesh& mesh) const;
+
+    wgpu::BindGroup createBindGroup(
+        const wgpu::Device& device,
+        const GPUMesh& mesh,
+        const wgpu::Buffer& jointMatricesBuffer,
+        std::uint64_t jointMatricesOffset,
+        std::uint64_t jointMatricesSize,
+        const Output& output) const;
+
+    void record(const wgpu::CommandEncoder& encoder, std::span<const Dispatch> dispatches) const;
+
+private:
+    wgpu::BindGroupLayout bindGroupLayout;
+    std::array<wgpu::ComputePipeline, 2> pipelines; // narrow and wide skin attribs
+
+    std::uint32_t storageBufferOffsetAlignment{256};
+};
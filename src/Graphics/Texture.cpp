@@ -1,5 +1,8 @@
 #include "Texture.h"
 
+#include <algorithm>
+#include <cassert>
+
 wgpu::TextureView Texture::createView() const
 {
     return createView(0, mipLevelCount);
@@ -33,3 +36,41 @@ wgpu::TextureView Texture::createViewForCubeLayer(int baseMipLevel, int count, i
     };
     return texture.CreateView(&textureViewDesc);
 }
+
+TextureFormatInfo getTextureFormatInfo(wgpu::TextureFormat format)
+{
+    switch (format) {
+    case wgpu::TextureFormat::RGBA16Float:
+        return {.blockSize = 1, .bytesPerBlock = 8};
+    case wgpu::TextureFormat::RGBA32Float:
+        return {.blockSize = 1, .bytesPerBlock = 16};
+    case wgpu::TextureFormat::BC1RGBAUnorm:
+    case wgpu::TextureFormat::BC1RGBAUnormSrgb:
+        return {.blockSize = 4, .bytesPerBlock = 8};
+    case wgpu::TextureFormat::BC5RGUnorm:
+    case wgpu::TextureFormat::BC7RGBAUnorm:
+    case wgpu::TextureFormat::BC7RGBAUnormSrgb:
+        return {.blockSize = 4, .bytesPerBlock = 16};
+    default:
+        return {.blockSize = 1, .bytesPerBlock = 4};
+    }
+}
+
+bool isBlockCompressedFormat(wgpu::TextureFormat format)
+{
+    return getTextureFormatInfo(format).blockSize > 1;
+}
+
+std::size_t getTextureSizeBytes(const Texture& texture)
+{
+    const auto info = getTextureFormatInfo(texture.format);
+    std::size_t numBlocks = 0;
+    for (std::uint32_t level = 0; level < texture.mipLevelCount; ++level) {
+        const auto width = static_cast<std::uint32_t>(std::max(texture.size.x >> level, 1));
+        const auto height = static_cast<std::uint32_t>(std::max(texture.size.y >> level, 1));
+        numBlocks += std::size_t{(width + info.blockSize - 1) / info.blockSize} *
+                     std::size_t{(height + info.blockSize - 1) / info.blockSize};
+    }
+    const auto numLayers = texture.isCubemap ? 6 : 1;
+    return numBlocks * numLayers * info.bytesPerBlock;
+}
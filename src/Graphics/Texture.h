@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 #include <glm/vec2.hpp>
 
 #include <webgpu/webgpu_cpp.h>
@@ -15,3 +18,15 @@ struct Texture {
     wgpu::TextureView createView(int baseMipLevel, int count) const;
     wgpu::TextureView createViewForCubeLayer(int baseMipLevel, int count, int layer) const;
 };
+
+// Texels of block-compressed formats are stored in blocks of
+// blockSize x blockSize texels, uncompressed formats have 1x1 blocks
+struct TextureFormatInfo {
+    std::uint32_t blockSize{1};
+    std::uint32_t bytesPerBlock{4};
+};
+
+TextureFormatInfo getTextureFormatInfo(wgpu::TextureFormat format);
+bool isBlockCompressedFormat(wgpu::TextureFormat format);
+// size of all mip levels (and cubemap faces) of the texture
+std::size_t getTextureSizeBytes(const Texture& texture);
@@ -0,0 +1,313 @@
+#include "UploadManager.h"
+
+#include <cassert>
+#include <cstring>
+
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+// enough for copy offsets of buffers and of all texel block sizes
+constexpr std::uint64_t ALLOCATION_ALIGNMENT = 16;
+// WebGPU requires bytesPerRow of buffer -> texture copies to be a multiple of this
+constexpr std::uint32_t BYTES_PER_ROW_ALIGNMENT = 256;
+// ~2 seconds at 60 FPS
+constexpr std::uint64_t NUM_IDLE_FLUSHES_BEFORE_RELEASE = 120;
+
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+UploadManager::~UploadManager()
+{
+    cleanup();
+}
+
+void UploadManager::init(
+    const wgpu::Device& device,
+    std::uint64_t stagingBufferSize,
+    std::size_t numStagingBuffers)
+{
+    assert(!this->device && "upload manager was already initialized");
+    assert(stagingBufferSize % 4 == 0);
+    this->device = device;
+    this->stagingBufferSize = stagingBufferSize;
+    minNumStagingBuffers = numStagingBuffers;
+
+    ring.reserve(numStagingBuffers);
+    for (std::size_t i = 0; i < numStagingBuffers; ++i) {
+        ring.push_back(createStagingBuffer(stagingBufferSize));
+    }
+    stats.numStagingBuffers = ring.size();
+}
+
+void UploadManager::cleanup()
+{
+    // Destroy buffers explicitly: pending MapAsync callbacks get called
+    // with an error status and won't touch StagingBuffers freed below
+    for (auto& sb : ring) {
+        sb->buffer.Destroy();
+    }
+    for (auto& sb : oversizedBuffers) {
+        sb->buffer.Destroy();
+    }
+    ring.clear();
+    oversizedBuffers.clear();
+    bufferCopies.clear();
+    textureCopies.clear();
+    device = {};
+}
+
+void* UploadManager::allocateBufferUpload(
+    const wgpu::Buffer& dst,
+    std::uint64_t dstOffset,
+    std::uint64_t size)
+{
+    assert(dstOffset % 4 == 0 && size % 4 == 0 && "WebGPU requires 4 byte aligned copies");
+    if (size == 0) {
+        return nullptr;
+    }
+
+    wgpu::Buffer src;
+    std::uint64_t srcOffset{};
+    auto* ptr = allocate(size, src, srcOffset);
+    bufferCopies.push_back(BufferCopy{
+        .src = src,
+        .srcOffset = srcOffset,
+        .dst = dst,
+        .dstOffset = dstOffset,
+        .size = size,
+    });
+    stats.uploadedBytes += size;
+    ++stats.numCopies;
+    return ptr;
+}
+
+void UploadManager::uploadBuffer(
+    const wgpu::Buffer& dst,
+    std::uint64_t dstOffset,
+    const void* data,
+    std::uint64_t size)
+{
+    if (auto* ptr = allocateBufferUpload(dst, dstOffset, size); ptr) {
+        std::memcpy(ptr, data, size);
+    }
+}
+
+void* UploadManager::allocateTextureUpload(
+    const wgpu::ImageCopyTexture& dst,
+    const wgpu::Extent3D& size,
+    std::uint32_t bytesPerRow,
+    std::uint32_t numRows)
+{
+    assert(bytesPerRow % BYTES_PER_ROW_ALIGNMENT == 0);
+    const auto allocSize = std::uint64_t{bytesPerRow} * numRows * size.depthOrArrayLayers;
+
+    wgpu::Buffer src;
+    std::uint64_t srcOffset{};
+    auto* ptr = allocate(allocSize, src, srcOffset);
+    textureCopies.push_back(TextureCopy{
+        .src = src,
+        .layout =
+            {
+                .offset = srcOffset,
+                .bytesPerRow = bytesPerRow,
+                .rowsPerImage = numRows,
+            },
+        .dst = dst,
+        .size = size,
+    });
+    stats.uploadedBytes += allocSize;
+    ++stats.numCopies;
+    return ptr;
+}
+
+void UploadManager::uploadTexture(
+    const wgpu::ImageCopyTexture& dst,
+    const wgpu::Extent3D& size,
+    const void* data,
+    std::uint32_t srcBytesPerRow,
+    std::uint32_t numRows)
+{
+    const auto bytesPerRow = getAlignedBytesPerRow(srcBytesPerRow);
+    auto* dstPtr = static_cast<std::byte*>(allocateTextureUpload(dst, size, bytesPerRow, numRows));
+    const auto* srcPtr = static_cast<const std::byte*>(data);
+    if (bytesPerRow == srcBytesPerRow) {
+        std::memcpy(dstPtr, srcPtr, std::size_t{bytesPerRow} * numRows * size.depthOrArrayLayers);
+        return;
+    }
+
+    const auto totalRows = numRows * size.depthOrArrayLayers;
+    for (std::uint32_t row = 0; row < totalRows; ++row) {
+        std::memcpy(dstPtr, srcPtr, srcBytesPerRow);
+        dstPtr += bytesPerRow;
+        srcPtr += srcBytesPerRow;
+    }
+}
+
+std::uint32_t UploadManager::getAlignedBytesPerRow(std::uint32_t bytesPerRow)
+{
+    return static_cast<std::uint32_t>(alignUp(bytesPerRow, BYTES_PER_ROW_ALIGNMENT));
+}
+
+void UploadManager::flush(const wgpu::Queue& queue)
+{
+    ZoneScopedN("Flush uploads");
+
+    ++flushIdx;
+    releaseIdleBuffers();
+
+    if (bufferCopies.empty() && textureCopies.empty()) {
+        return;
+    }
+
+    // buffers must be unmapped before they're used by the GPU
+    for (auto& sb : ring) {
+        if (sb->mapped && sb->offset != 0) {
+            sb->buffer.Unmap();
+            sb->mapped = nullptr;
+            sb->lastUsedFlushIdx = flushIdx;
+        }
+    }
+    for (auto& sb : oversizedBuffers) {
+        sb->buffer.Unmap();
+        sb->mapped = nullptr;
+    }
+
+    const auto encoderDesc = wgpu::CommandEncoderDescriptor{
+        .label = "upload",
+    };
+    const auto encoder = device.CreateCommandEncoder(&encoderDesc);
+    for (const auto& copy : bufferCopies) {
+        encoder.CopyBufferToBuffer(copy.src, copy.srcOffset, copy.dst, copy.dstOffset, copy.size);
+    }
+    for (const auto& copy : textureCopies) {
+        const auto src = wgpu::ImageCopyBuffer{
+            .layout = copy.layout,
+            .buffer = copy.src,
+        };
+        encoder.CopyBufferToTexture(&src, &copy.dst, &copy.size);
+    }
+    const auto cmdBufferDesc = wgpu::CommandBufferDescriptor{};
+    const auto command = encoder.Finish(&cmdBufferDesc);
+    queue.Submit(1, &command);
+
+    bufferCopies.clear();
+    textureCopies.clear();
+    // the submitted commands keep them alive until the copies are done
+    oversizedBuffers.clear();
+
+    // Map used buffers again. The callbacks get called by device.Tick() once
+    // the copies from them are finished
+    for (auto& sb : ring) {
+        if (!sb->mapped && !sb->mapPending) {
+            sb->mapPending = true;
+            sb->buffer.MapAsync(wgpu::MapMode::Write, 0, sb->size, onBufferMapped, sb.get());
+        }
+    }
+}
+
+void UploadManager::resetStats()
+{
+    stats = Stats{
+        .numStagingBuffers = ring.size(),
+    };
+}
+
+std::byte* UploadManager::allocate(
+    std::uint64_t size,
+    wgpu::Buffer& buffer,
+    std::uint64_t& offset)
+{
+    if (size > stagingBufferSize) {
+        oversizedBuffers.push_back(createStagingBuffer(alignUp(size, 4)));
+        auto& sb = *oversizedBuffers.back();
+        sb.offset = size;
+        buffer = sb.buffer;
+        offset = 0;
+        return sb.mapped;
+    }
+
+    auto& sb = acquireStagingBuffer(size);
+    offset = alignUp(sb.offset, ALLOCATION_ALIGNMENT);
+    sb.offset = offset + size;
+    buffer = sb.buffer;
+    return sb.mapped + offset;
+}
+
+UploadManager::StagingBuffer& UploadManager::acquireStagingBuffer(std::uint64_t size)
+{
+    assert(device && "upload manager was not initialized");
+    // start from the current buffer so that allocations stay in ring order
+    for (std::size_t i = 0; i < ring.size(); ++i) {
+        const auto idx = (currentBufferIdx + i) % ring.size();
+        const auto& sb = *ring[idx];
+        if (sb.mapped && alignUp(sb.offset, ALLOCATION_ALIGNMENT) + size <= sb.size) {
+            currentBufferIdx = idx;
+            return *ring[idx];
+        }
+    }
+
+    // the GPU hasn't finished with any of the buffers yet - don't wait for it
+    ring.push_back(createStagingBuffer(stagingBufferSize));
+    ++stats.numStalls;
+    stats.numStagingBuffers = ring.size();
+    currentBufferIdx = ring.size() - 1;
+    return *ring.back();
+}
+
+void UploadManager::releaseIdleBuffers()
+{
+    for (std::size_t i = 0; i < ring.size() && ring.size() > minNumStagingBuffers;) {
+        const auto& sb = *ring[i];
+        // mapped and empty - not in use by the GPU or by pending uploads
+        const bool idle = sb.mapped && sb.offset == 0 &&
+                          flushIdx - sb.lastUsedFlushIdx > NUM_IDLE_FLUSHES_BEFORE_RELEASE;
+        if (!idle) {
+            ++i;
+            continue;
+        }
+        sb.buffer.Destroy();
+        ring.erase(ring.begin() + static_cast<std::ptrdiff_t>(i));
+        if (currentBufferIdx > i) {
+            --currentBufferIdx;
+        }
+        ++stats.numReleasedBuffers;
+    }
+    if (currentBufferIdx >= ring.size()) {
+        currentBufferIdx = 0;
+    }
+    stats.numStagingBuffers = ring.size();
+}
+
+std::unique_ptr<UploadManager::StagingBuffer> UploadManager::createStagingBuffer(
+    std::uint64_t size) const
+{
+    const auto bufferDesc = wgpu::BufferDescriptor{
+        .label = "staging buffer",
+        .usage = wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc,
+        .size = size,
+        .mappedAtCreation = true,
+    };
+    auto sb = std::make_unique<StagingBuffer>();
+    sb->buffer = device.CreateBuffer(&bufferDesc);
+    sb->size = size;
+    sb->lastUsedFlushIdx = flushIdx;
+    sb->mapped = static_cast<std::byte*>(sb->buffer.GetMappedRange());
+    assert(sb->mapped);
+    return sb;
+}
+
+void UploadManager::onBufferMapped(WGPUBufferMapAsyncStatus status, void* userdata)
+{
+    if (status != WGPUBufferMapAsyncStatus_Success) {
+        // the buffer was destroyed in cleanup, userdata may be dangling
+        return;
+    }
+    auto& sb = *static_cast<StagingBuffer*>(userdata);
+    sb.mapPending = false;
+    sb.mapped = static_cast<std::byte*>(sb.buffer.GetMappedRange());
+    sb.offset = 0;
+}
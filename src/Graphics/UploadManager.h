@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <webgpu/webgpu_cpp.h>
+
+// Uploads data to GPU buffers and textures through a ring of MapWrite|CopySrc
+// staging buffers.
+// Callers write into mapped staging memory (allocate*Upload) or let the
+// manager copy their data into it (upload*). Copies into destinations are
+// recorded into one command encoder which is submitted by flush - once per
+// frame, before the frame's commands are submitted.
+// After submission, used staging buffers are remapped with MapAsync and are
+// reused once the GPU is done with them. If none of them is mapped when
+// space is needed, a new buffer is added to the ring - this is counted as
+// a stall. Buffers which stay unused for a while after a spike are released
+// until the ring is back to its initial size.
+class UploadManager {
+public:
+    struct Stats {
+        std::uint64_t uploadedBytes{0};
+        std::size_t numCopies{0};
+        std::size_t numStalls{0};
+        std::size_t numReleasedBuffers{0};
+        std::size_t numStagingBuffers{0}; // current ring size, not accumulated
+    };
+
+    UploadManager() = default;
+    ~UploadManager();
+
+    UploadManager(const UploadManager&) = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+
+    void init(
+        const wgpu::Device& device,
+        std::uint64_t stagingBufferSize = 4 * 1024 * 1024,
+        std::size_t numStagingBuffers = 3);
+    void cleanup();
+
+    // Returns mapped memory which will be copied into dst at dstOffset.
+    // dstOffset and size must be multiples of 4
+    void* allocateBufferUpload(
+        const wgpu::Buffer& dst,
+        std::uint64_t dstOffset,
+        std::uint64_t size);
+    void uploadBuffer(
+        const wgpu::Buffer& dst,
+        std::uint64_t dstOffset,
+        const void* data,
+        std::uint64_t size);
+
+    // Returns mapped memory for size.depthOrArrayLayers images of numRows
+    // rows each. bytesPerRow must be a multiple of 256 (see getAlignedBytesPerRow)
+    void* allocateTextureUpload(
+        const wgpu::ImageCopyTexture& dst,
+        const wgpu::Extent3D& size,
+        std::uint32_t bytesPerRow,
+        std::uint32_t numRows);
+    // data is tightly packed (rows are srcBytesPerRow apart), numRows is the
+    // number of rows in each image (height for uncompressed formats)
+    void uploadTexture(
+        const wgpu::ImageCopyTexture& dst,
+        const wgpu::Extent3D& size,
+        const void* data,
+        std::uint32_t srcBytesPerRow,
+        std::uint32_t numRows);
+
+    static std::uint32_t getAlignedBytesPerRow(std::uint32_t bytesPerRow);
+
+    // Must be called before anything which reads uploaded data is submitted
+    void flush(const wgpu::Queue& queue);
+
+    // accumulated since the last resetStats
+    const Stats& getStats() const { return stats; }
+    void resetStats();
+
+private:
+    struct StagingBuffer {
+        wgpu::Buffer buffer;
+        std::uint64_t size{0};
+        std::byte* mapped{nullptr}; // null while unmapped or waiting for MapAsync
+        std::uint64_t offset{0};
+        bool mapPending{false};
+        std::uint64_t lastUsedFlushIdx{0};
+    };
+
+    struct BufferCopy {
+        wgpu::Buffer src;
+        std::uint64_t srcOffset;
+        wgpu::Buffer dst;
+        std::uint64_t dstOffset;
+        std::uint64_t size;
+    };
+
+    struct TextureCopy {
+        wgpu::Buffer src;
+        wgpu::TextureDataLayout layout;
+        wgpu::ImageCopyTexture dst;
+        wgpu::Extent3D size;
+    };
+
+    std::byte* allocate(std::uint64_t size, wgpu::Buffer& buffer, std::uint64_t& offset);
+    StagingBuffer& acquireStagingBuffer(std::uint64_t size);
+    std::unique_ptr<StagingBuffer> createStagingBuffer(std::uint64_t size) const;
+    void releaseIdleBuffers();
+
+    static void onBufferMapped(WGPUBufferMapAsyncStatus status, void* userdata);
+
+    wgpu::Device device;
+    std::uint64_t stagingBufferSize{0};
+    std::size_t minNumStagingBuffers{0};
+    std::uint64_t flushIdx{0};
+
+    // unique_ptr, because pointers are passed to MapAsync
+    std::vector<std::unique_ptr<StagingBuffer>> ring;
+    std::size_t currentBufferIdx{0};
+    // for uploads which don't fit into ring buffers, dropped after flush
+    std::vector<std::unique_ptr<StagingBuffer>> oversizedBuffers;
+
+    std::vector<BufferCopy> bufferCopies;
+    std::vector<TextureCopy> textureCopies;
+
+    Stats stats;
+};
@@ -0,0 +1,123 @@
+#include "AsyncLoader.h"
+
+#include <cassert>
+#include <chrono>
+
+#include <tracy/Tracy.hpp>
+
+AsyncLoader::~AsyncLoader()
+{
+    shutdown();
+}
+
+void AsyncLoader::init()
+{
+    assert(!running && "async loader was already initialized");
+    running = true;
+    thread = std::thread([this]() { loaderLoop(); });
+}
+
+void AsyncLoader::shutdown()
+{
+    {
+        std::lock_guard lock(tasksMutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+        tasks.clear();
+    }
+    tasksCV.notify_all();
+    thread.join();
+
+    std::lock_guard lock(uploadsMutex);
+    uploads.clear();
+}
+
+void AsyncLoader::load(LoadTask task)
+{
+    {
+        std::lock_guard lock(tasksMutex);
+        assert(running && "async loader was not initialized");
+        tasks.push_back(std::move(task));
+    }
+    tasksCV.notify_one();
+}
+
+void AsyncLoader::addUpload(Upload upload, std::size_t sizeBytes)
+{
+    std::lock_guard lock(uploadsMutex);
+    uploads.push_back(UploadEntry{.upload = std::move(upload), .sizeBytes = sizeBytes});
+}
+
+std::size_t AsyncLoader::processUploads(const UploadBudget& budget)
+{
+    ZoneScopedN("Process uploads");
+
+    const auto startTime = std::chrono::steady_clock::now();
+    std::size_t uploadedBytes{0};
+    while (true) {
+        UploadEntry entry;
+        {
+            std::lock_guard lock(uploadsMutex);
+            if (uploads.empty()) {
+                break;
+            }
+            // the first upload with data is executed even if it's bigger than the budget
+            const auto sizeBytes = uploads.front().sizeBytes;
+            if (uploadedBytes > 0 && uploadedBytes + sizeBytes > budget.maxBytes) {
+                break;
+            }
+            entry = std::move(uploads.front());
+            uploads.pop_front();
+        }
+
+        entry.upload();
+        uploadedBytes += entry.sizeBytes;
+
+        const auto elapsedMs = std::chrono::duration<float, std::milli>(
+                                   std::chrono::steady_clock::now() - startTime)
+                                   .count();
+        if (elapsedMs >= budget.maxTimeMs) {
+            break;
+        }
+    }
+    return uploadedBytes;
+}
+
+std::size_t AsyncLoader::getNumPendingTasks() const
+{
+    std::lock_guard lock(tasksMutex);
+    return tasks.size() + (taskRunning ? 1 : 0);
+}
+
+std::size_t AsyncLoader::getNumPendingUploads() const
+{
+    std::lock_guard lock(uploadsMutex);
+    return uploads.size();
+}
+
+void AsyncLoader::loaderLoop()
+{
+#ifdef TRACY_ENABLE
+    tracy::SetThreadName("Async loader");
+#endif
+
+    while (true) {
+        LoadTask task;
+        {
+            std::unique_lock lock(tasksMutex);
+            taskRunning = false;
+            tasksCV.wait(lock, [this]() { return !tasks.empty() || !running; });
+            if (!running) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            taskRunning = true;
+        }
+
+        ZoneScopedN("Load task");
+        task();
+    }
+}
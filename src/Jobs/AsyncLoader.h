@@ -0,0 +1,67 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Runs load tasks on a background thread, one at a time in the order they
+// were added.
+// GPU resources can only be created on the main thread, so load tasks only do
+// CPU work (parsing, decoding) and add uploads. The main thread calls
+// processUploads each frame, which executes uploads in order until the
+// frame's budget is spent, so adding new content doesn't cause hitches.
+class AsyncLoader {
+public:
+    using LoadTask = std::function<void()>;
+    using Upload = std::function<void()>;
+
+    struct UploadBudget {
+        std::size_t maxBytes;
+        float maxTimeMs;
+    };
+
+    AsyncLoader() = default;
+    ~AsyncLoader();
+
+    AsyncLoader(const AsyncLoader&) = delete;
+    AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+    void init();
+    // waits for the current load task to finish, pending tasks and uploads are dropped
+    void shutdown();
+
+    void load(LoadTask task);
+    // called from load tasks, sizeBytes is used for budgeting
+    void addUpload(Upload upload, std::size_t sizeBytes);
+
+    // Must be called on the main thread. Executes pending uploads in order
+    // while they fit into the budget. The first one is executed even if it
+    // doesn't fit, otherwise big uploads would never finish.
+    // Returns the number of uploaded bytes.
+    std::size_t processUploads(const UploadBudget& budget);
+
+    std::size_t getNumPendingTasks() const;
+    std::size_t getNumPendingUploads() const;
+
+private:
+    struct UploadEntry {
+        Upload upload;
+        std::size_t sizeBytes;
+    };
+
+    void loaderLoop();
+
+    std::thread thread;
+
+    mutable std::mutex tasksMutex;
+    std::condition_variable tasksCV;
+    std::deque<LoadTask> tasks;
+    bool taskRunning{false};
+    bool running{false};
+
+    mutable std::mutex uploadsMutex;
+    std::deque<UploadEntry> uploads;
+};
@@ -0,0 +1,159 @@
+#include "ImageDecodePool.h"
+
+#include <cassert>
+#include <string>
+
+#include <tracy/Tracy.hpp>
+
+#include <util/ImageLoader.h>
+
+ImageDecodePool::~ImageDecodePool()
+{
+    shutdown();
+}
+
+void ImageDecodePool::init(std::size_t numThreads, std::size_t maxInFlightBytes)
+{
+    assert(!running && "image decode pool was already initialized");
+    assert(numThreads > 0);
+    running = true;
+    this->maxInFlightBytes = maxInFlightBytes;
+
+    threads.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; ++i) {
+        threads.emplace_back([this, i]() {
+#ifdef TRACY_ENABLE
+            const auto threadName = "Image decoder " + std::to_string(i);
+            tracy::SetThreadName(threadName.c_str());
+#else
+            (void)i;
+#endif
+            workerLoop();
+        });
+    }
+}
+
+void ImageDecodePool::shutdown()
+{
+    std::deque<Task> droppedTasks;
+    {
+        std::lock_guard lock(mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+        droppedTasks = std::move(tasks);
+        tasks.clear();
+    }
+    tasksCV.notify_all();
+    bytesCV.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    for (const auto& task : droppedTasks) {
+        finishTask(task);
+    }
+}
+
+void ImageDecodePool::decode(
+    std::span<const std::filesystem::path> paths,
+    const OnDecoded& onDecoded)
+{
+    if (paths.empty()) {
+        return;
+    }
+
+    Batch batch{
+        .paths = paths,
+        .onDecoded = onDecoded,
+        .numRemaining = paths.size(),
+    };
+    {
+        std::lock_guard lock(mutex);
+        if (!running) {
+            return;
+        }
+        for (std::size_t i = 0; i < paths.size(); ++i) {
+            tasks.push_back(Task{.batch = &batch, .index = i});
+        }
+    }
+    tasksCV.notify_all();
+
+    std::unique_lock lock(batch.mutex);
+    batch.cv.wait(lock, [&batch]() { return batch.numRemaining == 0; });
+}
+
+std::size_t ImageDecodePool::getInFlightBytes() const
+{
+    std::lock_guard lock(mutex);
+    return inFlightBytes;
+}
+
+void ImageDecodePool::workerLoop()
+{
+    while (true) {
+        Task task;
+        {
+            std::unique_lock lock(mutex);
+            tasksCV.wait(lock, [this]() { return !tasks.empty() || !running; });
+            if (!running) {
+                return;
+            }
+            task = tasks.front();
+            tasks.pop_front();
+        }
+
+        decodeImage(task);
+        finishTask(task);
+    }
+}
+
+void ImageDecodePool::decodeImage(const Task& task)
+{
+    ZoneScopedN("Decode image");
+
+    const auto& path = task.batch->paths[task.index];
+    const auto sizeBytes = util::getImageDataSize(path);
+    {
+        std::unique_lock lock(mutex);
+        bytesCV.wait(lock, [this, sizeBytes]() {
+            return !running || inFlightBytes == 0 ||
+                   inFlightBytes + sizeBytes <= maxInFlightBytes;
+        });
+        if (!running) {
+            return;
+        }
+        inFlightBytes += sizeBytes;
+    }
+
+    auto image = std::shared_ptr<ImageData>(
+        new ImageData(util::loadImage(path)), [this, sizeBytes](ImageData* image) {
+            delete image;
+            releaseBytes(sizeBytes);
+        });
+    task.batch->onDecoded(task.index, std::move(image));
+}
+
+void ImageDecodePool::finishTask(const Task& task)
+{
+    auto& batch = *task.batch;
+    // notified under the lock: decode can return (and destroy the batch) as soon as
+    // the lock is released
+    std::lock_guard lock(batch.mutex);
+    --batch.numRemaining;
+    if (batch.numRemaining == 0) {
+        batch.cv.notify_all();
+    }
+}
+
+void ImageDecodePool::releaseBytes(std::size_t sizeBytes)
+{
+    {
+        std::lock_guard lock(mutex);
+        assert(inFlightBytes >= sizeBytes);
+        inFlightBytes -= sizeBytes;
+    }
+    bytesCV.notify_all();
+}
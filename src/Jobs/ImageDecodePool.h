@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+struct ImageData;
+
+// Decodes images on its own threads, so that load tasks wait for the slowest
+// image of a batch instead of all of them one after another.
+// Decoded images are owned by shared_ptrs and their bytes count as "in flight"
+// until the last reference is released (usually by an upload after it copied
+// the pixels). New images aren't decoded while in-flight bytes would go over
+// the limit, so memory used by images waiting for upload stays bounded.
+// An image is always decoded if nothing else is in flight, even if it's
+// bigger than the limit, but images which the caller of decode keeps until it
+// returns must fit into the limit together - otherwise decode never returns.
+class ImageDecodePool {
+public:
+    using OnDecoded = std::function<void(std::size_t index, std::shared_ptr<ImageData> image)>;
+
+    ImageDecodePool() = default;
+    ~ImageDecodePool();
+
+    ImageDecodePool(const ImageDecodePool&) = delete;
+    ImageDecodePool& operator=(const ImageDecodePool&) = delete;
+
+    void init(std::size_t numThreads, std::size_t maxInFlightBytes);
+    // images which weren't decoded yet are dropped, pending decode calls return
+    void shutdown();
+
+    // Decodes images at paths concurrently and calls onDecoded(pathIndex, image)
+    // for each of them on decoding threads (in any order, possibly concurrently).
+    // Returns after all images are decoded and passed to onDecoded.
+    void decode(std::span<const std::filesystem::path> paths, const OnDecoded& onDecoded);
+
+    std::size_t getInFlightBytes() const;
+    std::size_t getNumThreads() const { return threads.size(); }
+
+private:
+    struct Batch {
+        std::span<const std::filesystem::path> paths;
+        const OnDecoded& onDecoded;
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::size_t numRemaining;
+    };
+
+    struct Task {
+        Batch* batch;
+        std::size_t index;
+    };
+
+    void workerLoop();
+    void decodeImage(const Task& task);
+    void finishTask(const Task& task);
+    void releaseBytes(std::size_t sizeBytes);
+
+    std::vector<std::thread> threads;
+
+    // protects everything below
+    mutable std::mutex mutex;
+    std::condition_variable tasksCV;
+    std::condition_variable bytesCV; // notified when in-flight bytes are released
+    std::deque<Task> tasks;
+    bool running{false};
+
+    std::size_t inFlightBytes{0};
+    std::size_t maxInFlightBytes{0};
+};
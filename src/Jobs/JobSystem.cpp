@@ -0,0 +1,184 @@
+#include "JobSystem.h"
+
+#include <cassert>
+#include <string>
+
+#include <tracy/Tracy.hpp>
+
+namespace
+{
+// job system whose worker the current thread is and the index of its queue
+// in that system (see JobSystem::getCurrentQueueIdx)
+thread_local const JobSystem* currentSystem = nullptr;
+thread_local std::size_t currentQueueIdx = 0;
+
+// cheap per-thread RNG for picking steal victims
+std::uint32_t nextRandom()
+{
+    thread_local std::uint32_t state =
+        static_cast<std::uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1;
+    // xorshift32
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+}
+
+JobSystem::~JobSystem()
+{
+    shutdown();
+}
+
+std::size_t JobSystem::getDefaultNumWorkers()
+{
+    const auto numCores = std::thread::hardware_concurrency();
+    // main thread also executes jobs while waiting
+    return numCores > 1 ? numCores - 1 : 0;
+}
+
+void JobSystem::init(std::size_t numWorkers)
+{
+    assert(!running && "job system was already initialized");
+
+    queues.reserve(numWorkers + 1);
+    for (std::size_t i = 0; i < numWorkers + 1; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+    }
+
+    running = true;
+    workers.reserve(numWorkers);
+    for (std::size_t i = 0; i < numWorkers; ++i) {
+        workers.emplace_back([this, i]() { workerLoop(i + 1); });
+    }
+}
+
+void JobSystem::shutdown()
+{
+    if (!running) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(sleepMutex);
+        running = false;
+    }
+    sleepCV.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    queues.clear();
+}
+
+void JobSystem::schedule(Job job, JobCounter* counter)
+{
+    assert(!queues.empty() && "job system was not initialized");
+
+    if (counter) {
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    {
+        auto& queue = *queues[getCurrentQueueIdx()];
+        std::lock_guard lock(queue.mutex);
+        queue.jobs.push_back(JobEntry{.job = std::move(job), .counter = counter});
+    }
+    numPendingJobs.fetch_add(1, std::memory_order_release);
+
+    // lock so that the notification can't be missed by a worker which
+    // checked numPendingJobs but didn't start waiting yet
+    { std::lock_guard lock(sleepMutex); }
+    sleepCV.notify_one();
+}
+
+void JobSystem::wait(const JobCounter& counter)
+{
+    while (!counter.isDone()) {
+        if (!tryRunJob()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(std::size_t queueIdx)
+{
+    currentSystem = this;
+    currentQueueIdx = queueIdx;
+#ifdef TRACY_ENABLE
+    const auto threadName = "Worker " + std::to_string(queueIdx);
+    tracy::SetThreadName(threadName.c_str());
+#endif
+
+    while (running) {
+        if (tryRunJob()) {
+            continue;
+        }
+
+        std::unique_lock lock(sleepMutex);
+        sleepCV.wait(lock, [this]() {
+            return numPendingJobs.load(std::memory_order_acquire) > 0 || !running;
+        });
+    }
+}
+
+bool JobSystem::tryRunJob()
+{
+    const auto queueIdx = getCurrentQueueIdx();
+    JobEntry entry;
+    if (!popJob(queueIdx, entry) && !stealJob(queueIdx, entry)) {
+        return false;
+    }
+    numPendingJobs.fetch_sub(1, std::memory_order_relaxed);
+
+    {
+        ZoneScopedN("Job");
+        entry.job();
+    }
+
+    if (entry.counter) {
+        entry.counter->value.fetch_sub(1, std::memory_order_acq_rel);
+    }
+    return true;
+}
+
+std::size_t JobSystem::getCurrentQueueIdx() const
+{
+    // the main thread, threads not managed by any job system and workers of
+    // other job systems (which can have a different number of queues) use queue 0
+    return currentSystem == this ? currentQueueIdx : 0;
+}
+
+bool JobSystem::popJob(std::size_t queueIdx, JobEntry& entry)
+{
+    auto& queue = *queues[queueIdx];
+    std::lock_guard lock(queue.mutex);
+    if (queue.jobs.empty()) {
+        return false;
+    }
+    entry = std::move(queue.jobs.back());
+    queue.jobs.pop_back();
+    return true;
+}
+
+bool JobSystem::stealJob(std::size_t thiefQueueIdx, JobEntry& entry)
+{
+    const auto numQueues = queues.size();
+    const auto startIdx = nextRandom() % numQueues;
+    for (std::size_t i = 0; i < numQueues; ++i) {
+        const auto victimIdx = (startIdx + i) % numQueues;
+        if (victimIdx == thiefQueueIdx) {
+            continue;
+        }
+
+        auto& queue = *queues[victimIdx];
+        std::lock_guard lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            entry = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Incremented for each scheduled job and decremented when the job finishes.
+// Can be used to wait for a group of jobs (e.g. before starting dependent work).
+struct JobCounter {
+    std::atomic<std::uint32_t> value{0};
+
+    bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+};
+
+// Work-stealing job system.
+// Each thread (workers + the thread which called init) has its own queue:
+// new jobs are pushed to the queue of the thread which schedules them,
+// the owner takes jobs from the back (LIFO) and idle threads steal jobs from
+// the front of other queues (FIFO).
+// Jobs can schedule other jobs and wait for them - waiting thread executes
+// other jobs while it waits, so it doesn't block.
+// Queue 0 belongs to all threads which aren't workers, so only one of them
+// should schedule jobs (several job systems can be used for different threads).
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    JobSystem() = default;
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // if numWorkers == 0, all jobs are executed by the main thread in wait()
+    void init(std::size_t numWorkers = getDefaultNumWorkers());
+    void shutdown();
+
+    void schedule(Job job, JobCounter* counter = nullptr);
+    void wait(const JobCounter& counter);
+
+    // Splits [0, count) into batches and calls f(begin, end) for each of them
+    // in parallel. Returns after all batches are processed.
+    template<typename F>
+    void parallelFor(std::size_t count, std::size_t batchSize, F&& f);
+
+    // workers + the main thread
+    std::size_t getNumThreads() const { return queues.size(); }
+
+    static std::size_t getDefaultNumWorkers();
+
+private:
+    struct JobEntry {
+        Job job;
+        JobCounter* counter{nullptr};
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<JobEntry> jobs;
+    };
+
+    void workerLoop(std::size_t queueIdx);
+    bool tryRunJob();
+    std::size_t getCurrentQueueIdx() const;
+    bool popJob(std::size_t queueIdx, JobEntry& entry);
+    bool stealJob(std::size_t thiefQueueIdx, JobEntry& entry);
+
+    std::vector<std::unique_ptr<WorkQueue>> queues; // 0 - main thread
+    std::vector<std::thread> workers;
+
+    std::atomic<bool> running{false};
+    std::atomic<std::size_t> numPendingJobs{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+};
+
+template<typename F>
+void JobSystem::parallelFor(std::size_t count, std::size_t batchSize, F&& f)
+{
+    if (count == 0) {
+        return;
+    }
+    if (batchSize == 0) {
+        batchSize = 1;
+    }
+    if (count <= batchSize || queues.size() <= 1) { // not worth scheduling
+        f(std::size_t{0}, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (std::size_t begin = 0; begin < count; begin += batchSize) {
+        const auto end = std::min(begin + batchSize, count);
+        schedule([&f, begin, end]() { f(begin, end); }, &counter);
+    }
+    wait(counter);
+}
@@ -13,3 +13,8 @@ const Material& MaterialCache::getMaterial(MaterialId id) const
 {
     return materials.at(id);
 }
+
+Material& MaterialCache::getMaterial(MaterialId id)
+{
+    return materials.at(id);
+}
@@ -9,6 +9,7 @@ public:
     MaterialId addMaterial(Material material);
 
     const Material& getMaterial(MaterialId id) const;
+    Material& getMaterial(MaterialId id);
 
 private:
     std::vector<Material> materials;
@@ -0,0 +1,72 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/geometric.hpp>
+
+namespace math
+{
+AABB calculateAABB(std::span<const glm::vec4> positions)
+{
+    if (positions.empty()) {
+        return AABB{};
+    }
+
+    auto aabb = AABB{
+        .min = glm::vec3{std::numeric_limits<float>::max()},
+        .max = glm::vec3{std::numeric_limits<float>::lowest()},
+    };
+    for (const auto& p : positions) {
+        aabb.min = glm::min(aabb.min, glm::vec3{p});
+        aabb.max = glm::max(aabb.max, glm::vec3{p});
+    }
+    return aabb;
+}
+
+Sphere calculateBoundingSphere(std::span<const glm::vec4> positions, const AABB& aabb)
+{
+    const auto center = aabb.getCenter();
+    float maxDist2{0.f};
+    for (const auto& p : positions) {
+        const auto d = glm::vec3{p} - center;
+        maxDist2 = std::max(maxDist2, glm::dot(d, d));
+    }
+    return Sphere{
+        .center = center,
+        .radius = std::sqrt(maxDist2),
+    };
+}
+
+AABB transformAABB(const AABB& aabb, const glm::mat4& tm)
+{
+    const auto center = glm::vec3{tm * glm::vec4{aabb.getCenter(), 1.f}};
+    const auto extents = aabb.getExtents();
+
+    glm::vec3 newExtents{};
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            newExtents[i] += std::abs(tm[j][i]) * extents[j];
+        }
+    }
+
+    return AABB{
+        .min = center - newExtents,
+        .max = center + newExtents,
+    };
+}
+
+Sphere transformSphere(const Sphere& sphere, const glm::mat4& tm)
+{
+    const auto maxScale = std::max(
+        {glm::length(glm::vec3{tm[0]}),
+         glm::length(glm::vec3{tm[1]}),
+         glm::length(glm::vec3{tm[2]})});
+    return Sphere{
+        .center = glm::vec3{tm * glm::vec4{sphere.center, 1.f}},
+        .radius = sphere.radius * maxScale,
+    };
+}
+
+} // end of namespace math
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <span>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace math
+{
+struct AABB {
+    glm::vec3 min{};
+    glm::vec3 max{};
+
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 getExtents() const { return (max - min) * 0.5f; } // half-size
+};
+
+struct Sphere {
+    glm::vec3 center{};
+    float radius{0.f};
+};
+
+AABB calculateAABB(std::span<const glm::vec4> positions);
+// sphere is centered at AABB's center, so it's not minimal, but good enough
+Sphere calculateBoundingSphere(std::span<const glm::vec4> positions, const AABB& aabb);
+
+// returns AABB which encloses transformed AABB (see "Transforming Axis-Aligned
+// Bounding Boxes" by James Arvo, Graphics Gems)
+AABB transformAABB(const AABB& aabb, const glm::mat4& tm);
+Sphere transformSphere(const Sphere& sphere, const glm::mat4& tm);
+
+} // end of namespace math
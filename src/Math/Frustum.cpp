@@ -0,0 +1,245 @@
+#include "Frustum.h"
+
+#include <cassert>
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+#include "Bounds.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_CULLING_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define FRUSTUM_CULLING_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+struct PlaneSoA {
+    float nx, ny, nz, d;
+    float absNx, absNy, absNz;
+};
+
+std::array<PlaneSoA, 6> getPlanes(const math::Frustum& frustum)
+{
+    std::array<PlaneSoA, 6> planes;
+    for (std::size_t i = 0; i < planes.size(); ++i) {
+        const auto& p = frustum.planes[i];
+        planes[i] = PlaneSoA{
+            .nx = p.x,
+            .ny = p.y,
+            .nz = p.z,
+            .d = p.w,
+            .absNx = std::abs(p.x),
+            .absNy = std::abs(p.y),
+            .absNz = std::abs(p.z),
+        };
+    }
+    return planes;
+}
+
+bool isAABBVisible(
+    const std::array<PlaneSoA, 6>& planes,
+    const math::AABBArray& aabbs,
+    std::size_t i)
+{
+    for (const auto& p : planes) {
+        const auto dist =
+            p.nx * aabbs.centerX[i] + p.ny * aabbs.centerY[i] + p.nz * aabbs.centerZ[i] + p.d;
+        const auto radius =
+            p.absNx * aabbs.extentX[i] + p.absNy * aabbs.extentY[i] + p.absNz * aabbs.extentZ[i];
+        if (dist + radius < 0.f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // end of anonymous namespace
+
+namespace math
+{
+Frustum createFrustumFromViewProj(const glm::mat4& m)
+{
+    // see "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix"
+    // by Gil Gribb and Klaus Hartmann
+    const auto row = [&m](int i) { return glm::vec4{m[0][i], m[1][i], m[2][i], m[3][i]}; };
+    const auto r0 = row(0);
+    const auto r1 = row(1);
+    const auto r2 = row(2);
+    const auto r3 = row(3);
+
+    Frustum frustum{
+        .planes =
+            {
+                r3 + r0, // left
+                r3 - r0, // right
+                r3 + r1, // bottom
+                r3 - r1, // top
+                r2, // near (depth is [0; 1])
+                r3 - r2, // far
+            },
+    };
+
+    for (auto& p : frustum.planes) {
+        p /= glm::length(glm::vec3{p});
+    }
+
+    return frustum;
+}
+
+void AABBArray::clear()
+{
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+}
+
+void AABBArray::reserve(std::size_t n)
+{
+    centerX.reserve(n);
+    centerY.reserve(n);
+    centerZ.reserve(n);
+    extentX.reserve(n);
+    extentY.reserve(n);
+    extentZ.reserve(n);
+}
+
+void AABBArray::resize(std::size_t n)
+{
+    centerX.resize(n);
+    centerY.resize(n);
+    centerZ.resize(n);
+    extentX.resize(n);
+    extentY.resize(n);
+    extentZ.resize(n);
+}
+
+void AABBArray::set(std::size_t i, const AABB& aabb)
+{
+    const auto center = aabb.getCenter();
+    const auto extents = aabb.getExtents();
+    centerX[i] = center.x;
+    centerY[i] = center.y;
+    centerZ[i] = center.z;
+    extentX[i] = extents.x;
+    extentY[i] = extents.y;
+    extentZ[i] = extents.z;
+}
+
+void AABBArray::add(const AABB& aabb)
+{
+    const auto center = aabb.getCenter();
+    const auto extents = aabb.getExtents();
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extents.x);
+    extentY.push_back(extents.y);
+    extentZ.push_back(extents.z);
+}
+
+std::size_t cullAABBs(
+    const Frustum& frustum,
+    const AABBArray& aabbs,
+    std::vector<std::uint8_t>& visible)
+{
+    visible.resize(aabbs.size());
+    return cullAABBs(frustum, aabbs, visible, 0, aabbs.size());
+}
+
+std::size_t cullAABBs(
+    const Frustum& frustum,
+    const AABBArray& aabbs,
+    std::span<std::uint8_t> visible,
+    std::size_t begin,
+    std::size_t end)
+{
+    assert(visible.size() == aabbs.size());
+    assert(begin <= end && end <= aabbs.size());
+
+    const auto planes = getPlanes(frustum);
+
+    const auto count = end;
+
+    std::size_t numVisible{0};
+    std::size_t i{begin};
+
+#if defined(FRUSTUM_CULLING_SSE)
+    const auto zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        const auto cx = _mm_loadu_ps(&aabbs.centerX[i]);
+        const auto cy = _mm_loadu_ps(&aabbs.centerY[i]);
+        const auto cz = _mm_loadu_ps(&aabbs.centerZ[i]);
+        const auto ex = _mm_loadu_ps(&aabbs.extentX[i]);
+        const auto ey = _mm_loadu_ps(&aabbs.extentY[i]);
+        const auto ez = _mm_loadu_ps(&aabbs.extentZ[i]);
+
+        auto inside = _mm_cmpeq_ps(zero, zero); // all bits set
+        for (const auto& p : planes) {
+            auto dist = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p.nx), cx), _mm_mul_ps(_mm_set1_ps(p.ny), cy)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.nz), cz), _mm_set1_ps(p.d)));
+            auto radius = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_mul_ps(_mm_set1_ps(p.absNx), ex), _mm_mul_ps(_mm_set1_ps(p.absNy), ey)),
+                _mm_mul_ps(_mm_set1_ps(p.absNz), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), zero));
+        }
+
+        const auto mask = _mm_movemask_ps(inside);
+        for (int j = 0; j < 4; ++j) {
+            const auto v = static_cast<std::uint8_t>((mask >> j) & 1);
+            visible[i + j] = v;
+            numVisible += v;
+        }
+    }
+#elif defined(FRUSTUM_CULLING_NEON)
+    const auto zero = vdupq_n_f32(0.f);
+    for (; i + 4 <= count; i += 4) {
+        const auto cx = vld1q_f32(&aabbs.centerX[i]);
+        const auto cy = vld1q_f32(&aabbs.centerY[i]);
+        const auto cz = vld1q_f32(&aabbs.centerZ[i]);
+        const auto ex = vld1q_f32(&aabbs.extentX[i]);
+        const auto ey = vld1q_f32(&aabbs.extentY[i]);
+        const auto ez = vld1q_f32(&aabbs.extentZ[i]);
+
+        auto inside = vdupq_n_u32(0xFFFFFFFF);
+        for (const auto& p : planes) {
+            auto dist = vdupq_n_f32(p.d);
+            dist = vmlaq_n_f32(dist, cx, p.nx);
+            dist = vmlaq_n_f32(dist, cy, p.ny);
+            dist = vmlaq_n_f32(dist, cz, p.nz);
+            auto radius = vmulq_n_f32(ex, p.absNx);
+            radius = vmlaq_n_f32(radius, ey, p.absNy);
+            radius = vmlaq_n_f32(radius, ez, p.absNz);
+            inside = vandq_u32(inside, vcgeq_f32(vaddq_f32(dist, radius), zero));
+        }
+
+        std::uint32_t lanes[4];
+        vst1q_u32(lanes, inside);
+        for (int j = 0; j < 4; ++j) {
+            const auto v = static_cast<std::uint8_t>(lanes[j] != 0);
+            visible[i + j] = v;
+            numVisible += v;
+        }
+    }
+#endif
+
+    // remainder (or everything if SIMD is not available)
+    for (; i < count; ++i) {
+        const auto v = static_cast<std::uint8_t>(isAABBVisible(planes, aabbs, i));
+        visible[i] = v;
+        numVisible += v;
+    }
+
+    return numVisible;
+}
+
+} // end of namespace math
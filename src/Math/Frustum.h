@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace math
+{
+struct AABB;
+
+struct Frustum {
+    // xyz - normal (pointing inside the frustum), w - distance
+    // order: left, right, bottom, top, near, far
+    std::array<glm::vec4, 6> planes;
+};
+
+// expects depth in [0; 1] range (GLM_FORCE_DEPTH_ZERO_TO_ONE)
+Frustum createFrustumFromViewProj(const glm::mat4& viewProj);
+
+// World-space AABBs stored as SoA (center + half-size), so that they can be
+// culled in batches of 4 with SIMD
+struct AABBArray {
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+
+    void clear();
+    void reserve(std::size_t n);
+    void resize(std::size_t n);
+    void add(const AABB& aabb);
+    void set(std::size_t i, const AABB& aabb);
+    std::size_t size() const { return centerX.size(); }
+};
+
+// Sets visible[i] to 1 if i-th AABB intersects the frustum and to 0 otherwise.
+// Returns the number of visible AABBs.
+std::size_t cullAABBs(
+    const Frustum& frustum,
+    const AABBArray& aabbs,
+    std::vector<std::uint8_t>& visible);
+
+// Same as above, but only for AABBs in [begin, end) range, so that the work can
+// be split between threads. visible must already have aabbs.size() elements.
+std::size_t cullAABBs(
+    const Frustum& frustum,
+    const AABBArray& aabbs,
+    std::span<std::uint8_t> visible,
+    std::size_t begin,
+    std::size_t end);
+
+} // end of namespace math
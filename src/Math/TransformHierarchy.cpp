@@ -0,0 +1,102 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+// same as Transform::asMatrix, but without glm::translate/glm::scale calls
+glm::mat4 composeMatrix(const glm::vec3& position, const glm::quat& heading, const glm::vec3& scale)
+{
+    auto tm = glm::mat4_cast(heading);
+    tm[0] *= scale.x;
+    tm[1] *= scale.y;
+    tm[2] *= scale.z;
+    tm[3] = glm::vec4{position, 1.f};
+    return tm;
+}
+}
+
+TransformHierarchy::NodeId TransformHierarchy::add(const Transform& localTransform, NodeId parentId)
+{
+    const auto id = size();
+    assert((parentId == NULL_NODE_ID || parentId < id) && "parent must be added before children");
+
+    positions.push_back(localTransform.position);
+    headings.push_back(localTransform.heading);
+    scales.push_back(localTransform.scale);
+    parents.push_back(parentId);
+    worldTransforms.emplace_back(1.f);
+    dirty.push_back(0);
+
+    markDirty(id);
+    return id;
+}
+
+void TransformHierarchy::setLocalTransform(NodeId id, const Transform& transform)
+{
+    positions[id] = transform.position;
+    headings[id] = transform.heading;
+    scales[id] = transform.scale;
+    markDirty(id);
+}
+
+void TransformHierarchy::setLocalPosition(NodeId id, const glm::vec3& position)
+{
+    positions[id] = position;
+    markDirty(id);
+}
+
+Transform TransformHierarchy::getLocalTransform(NodeId id) const
+{
+    Transform transform;
+    transform.position = positions[id];
+    transform.heading = headings[id];
+    transform.scale = scales[id];
+    return transform;
+}
+
+void TransformHierarchy::markDirty(NodeId id)
+{
+    dirty[id] = 1;
+    firstDirty = std::min(firstDirty, id);
+}
+
+std::size_t TransformHierarchy::update()
+{
+    changedBegin = 0;
+    changedEnd = 0;
+    if (firstDirty == NULL_NODE_ID) {
+        return 0;
+    }
+
+    // Nodes before firstDirty are not dirty and neither are their parents,
+    // so the pass can start from it. dirty[parent] is set during the pass if
+    // the parent's world transform was recalculated, which propagates the
+    // change to the whole subtree.
+    std::size_t numUpdated{0};
+    changedBegin = firstDirty;
+    for (NodeId id = firstDirty; id < size(); ++id) {
+        const auto parentId = parents[id];
+        const bool parentChanged = (parentId != NULL_NODE_ID && dirty[parentId]);
+        if (!dirty[id] && !parentChanged) {
+            continue;
+        }
+
+        const auto local = composeMatrix(positions[id], headings[id], scales[id]);
+        if (parentId == NULL_NODE_ID) {
+            worldTransforms[id] = local;
+        } else {
+            worldTransforms[id] = worldTransforms[parentId] * local;
+        }
+        dirty[id] = 1;
+
+        changedEnd = id + 1;
+        ++numUpdated;
+    }
+
+    std::fill(dirty.begin() + firstDirty, dirty.end(), 0);
+    firstDirty = NULL_NODE_ID;
+
+    return numUpdated;
+}
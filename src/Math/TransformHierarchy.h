@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+
+#include <Math/Transform.h>
+
+// Flattened transform hierarchy stored as SoA.
+// Nodes are stored in topological order (parents always come before children),
+// so that world transforms can be calculated in one linear pass.
+class TransformHierarchy {
+public:
+    using NodeId = std::size_t;
+    static const NodeId NULL_NODE_ID = std::numeric_limits<std::size_t>::max();
+
+    // parent must already be in the hierarchy
+    NodeId add(const Transform& localTransform, NodeId parentId = NULL_NODE_ID);
+
+    void setLocalTransform(NodeId id, const Transform& transform);
+    void setLocalPosition(NodeId id, const glm::vec3& position);
+    Transform getLocalTransform(NodeId id) const;
+
+    NodeId getParent(NodeId id) const { return parents[id]; }
+    const glm::mat4& getWorldTransform(NodeId id) const { return worldTransforms[id]; }
+    std::span<const glm::mat4> getWorldTransforms() const { return worldTransforms; }
+
+    // Recalculates world transforms of dirty nodes and their subtrees.
+    // Returns the number of recalculated world transforms.
+    std::size_t update();
+
+    // [begin, end) range of world transforms changed by the last update
+    std::size_t getChangedBegin() const { return changedBegin; }
+    std::size_t getChangedEnd() const { return changedEnd; }
+
+    std::size_t size() const { return parents.size(); }
+
+private:
+    void markDirty(NodeId id);
+
+    // local transforms
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> headings;
+    std::vector<glm::vec3> scales;
+
+    std::vector<NodeId> parents;
+    std::vector<glm::mat4> worldTransforms;
+
+    // 1 - local transform changed (or world transform was recalculated during update)
+    std::vector<std::uint8_t> dirty;
+    std::size_t firstDirty{NULL_NODE_ID};
+
+    std::size_t changedBegin{0};
+    std::size_t changedEnd{0};
+};
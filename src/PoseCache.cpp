@@ -0,0 +1,61 @@
+#include "PoseCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+#include <Graphics/SkeletalAnimation.h>
+
+std::size_t PoseCache::KeyHash::operator()(const Key& key) const
+{
+    auto h = std::hash<SkeletonId>{}(key.skeletonId);
+    h ^= std::hash<const SkeletalAnimation*>{}(key.animation) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<std::uint32_t>{}(key.timeStepIdx) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<std::uint16_t>{}(key.maxJointDepth) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+void PoseCache::setTimeStep(float step)
+{
+    assert(step > 0.f);
+    timeStep = step;
+}
+
+void PoseCache::clear()
+{
+    poses.clear();
+    stats = {};
+}
+
+std::size_t PoseCache::findOrAdd(
+    SkeletonId skeletonId,
+    const SkeletalAnimation& animation,
+    float time,
+    std::uint16_t maxJointDepth,
+    std::size_t animatorIdx)
+{
+    const auto key = Key{
+        .skeletonId = skeletonId,
+        .animation = &animation,
+        .timeStepIdx = getTimeStepIdx(time),
+        .maxJointDepth = maxJointDepth,
+    };
+    const auto [it, inserted] = poses.emplace(key, animatorIdx);
+    if (inserted) {
+        ++stats.misses;
+    } else {
+        ++stats.hits;
+    }
+    return it->second;
+}
+
+float PoseCache::quantizeTime(float time) const
+{
+    return static_cast<float>(getTimeStepIdx(time)) * timeStep;
+}
+
+std::uint32_t PoseCache::getTimeStepIdx(float time) const
+{
+    return static_cast<std::uint32_t>(std::round(std::max(time, 0.f) / timeStep));
+}
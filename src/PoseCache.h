@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include <Graphics/Skeleton.h>
+
+struct SkeletalAnimation;
+
+// Lets animators which play the same clip of the same skeleton at the same
+// (quantized) time share one evaluated pose during a frame: the first
+// animator which requests a pose evaluates it, others copy its joint matrices.
+// Clips are owned by AnimationCache, so their addresses identify them.
+class PoseCache {
+public:
+    struct Stats {
+        std::size_t hits{0};
+        std::size_t misses{0};
+    };
+
+    // times which fall into the same step share a pose (in seconds)
+    void setTimeStep(float step);
+    float getTimeStep() const { return timeStep; }
+
+    // should be called once per frame, before poses are requested
+    void clear();
+
+    // Returns index of the animator which evaluates the pose: animatorIdx on a
+    // miss, index of the first animator which requested the same pose on a hit.
+    // Poses evaluated with different max joint depths (see animation LOD in
+    // Game) are different poses.
+    std::size_t findOrAdd(
+        SkeletonId skeletonId,
+        const SkeletalAnimation& animation,
+        float time,
+        std::uint16_t maxJointDepth,
+        std::size_t animatorIdx);
+
+    // time at which shared poses should be sampled
+    float quantizeTime(float time) const;
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Key {
+        SkeletonId skeletonId;
+        const SkeletalAnimation* animation;
+        std::uint32_t timeStepIdx;
+        std::uint16_t maxJointDepth;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    std::uint32_t getTimeStepIdx(float time) const;
+
+    std::unordered_map<Key, std::size_t, KeyHash> poses; // -> animator index
+    float timeStep{1.f / 120.f};
+    Stats stats;
+};
@@ -0,0 +1,14 @@
+#include "SkeletonCache.h"
+
+SkeletonId SkeletonCache::addSkeleton(Skeleton skeleton)
+{
+    const auto id = skeletons.size();
+    calculateJointDepths(skeleton); // not stored in cooked scenes
+    skeletons.push_back(std::move(skeleton));
+    return id;
+}
+
+const Skeleton& SkeletonCache::getSkeleton(SkeletonId id) const
+{
+    return skeletons.at(id);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <deque>
+
+#include <Graphics/Skeleton.h>
+
+class SkeletonCache {
+public:
+    SkeletonId addSkeleton(Skeleton skeleton);
+
+    // references stay valid when new skeletons are added
+    const Skeleton& getSkeleton(SkeletonId id) const;
+
+private:
+    std::deque<Skeleton> skeletons;
+};
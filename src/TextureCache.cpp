@@ -0,0 +1,85 @@
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <functional>
+#include <system_error>
+
+std::size_t TextureCache::KeyHash::operator()(const Key& key) const
+{
+    auto h = std::hash<std::string>{}(key.path);
+    h ^= std::hash<wgpu::TextureFormat>{}(key.format) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<bool>{}(key.generateMips) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    return h;
+}
+
+TextureCache::Key TextureCache::makeKey(
+    const std::filesystem::path& path,
+    wgpu::TextureFormat format,
+    bool generateMips)
+{
+    // the same file can be referenced by different relative paths
+    std::error_code ec;
+    auto canonicalPath = std::filesystem::weakly_canonical(path, ec);
+    if (ec) {
+        canonicalPath = path.lexically_normal();
+    }
+    return Key{
+        .path = canonicalPath.generic_string(),
+        .format = format,
+        .generateMips = generateMips,
+    };
+}
+
+std::shared_ptr<const Texture> TextureCache::find(const Key& key)
+{
+    std::lock_guard lock(mutex);
+    return findLocked(key);
+}
+
+std::shared_ptr<const Texture> TextureCache::add(const Key& key, Texture texture)
+{
+    std::lock_guard lock(mutex);
+    if (auto cached = findLocked(key)) {
+        return cached;
+    }
+
+    ++stats.misses;
+    auto newTexture = std::make_shared<const Texture>(std::move(texture));
+    textures[key] = Entry{
+        .texture = newTexture,
+        .sizeBytes = getTextureSizeBytes(*newTexture),
+    };
+    return newTexture;
+}
+
+std::size_t TextureCache::getNumTextures() const
+{
+    std::lock_guard lock(mutex);
+    return std::count_if(textures.begin(), textures.end(), [](const auto& p) {
+        return !p.second.texture.expired();
+    });
+}
+
+TextureCache::Stats TextureCache::getStats() const
+{
+    std::lock_guard lock(mutex);
+    return stats;
+}
+
+std::shared_ptr<const Texture> TextureCache::findLocked(const Key& key)
+{
+    const auto it = textures.find(key);
+    if (it == textures.end()) {
+        return nullptr;
+    }
+
+    auto texture = it->second.texture.lock();
+    if (!texture) { // all users released it
+        textures.erase(it);
+        return nullptr;
+    }
+
+    ++stats.hits;
+    stats.savedBytes += it->second.sizeBytes;
+    return texture;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <webgpu/webgpu_cpp.h>
+
+#include <Graphics/Texture.h>
+
+// Shares textures loaded from the same image file with the same settings, so
+// that materials (of one or several scenes) which use the same image don't
+// decode, upload and generate mips for it more than once.
+// Textures are reference counted: users own them through shared_ptrs and the
+// cache only keeps weak references, so a texture is destroyed (and has to be
+// loaded again) when its last user releases it.
+// Can be used from any thread, but textures are only created on the main one.
+class TextureCache {
+public:
+    struct Key {
+        std::string path; // canonical, see makeKey
+        wgpu::TextureFormat format;
+        bool generateMips;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct Stats {
+        std::size_t hits{0};
+        std::size_t misses{0};
+        // memory which textures returned on hits would've taken if they were loaded again
+        std::size_t savedBytes{0};
+    };
+
+    static Key makeKey(
+        const std::filesystem::path& path,
+        wgpu::TextureFormat format,
+        bool generateMips);
+
+    // Returns nullptr if there's no texture for the key (doesn't count as a miss,
+    // the caller is expected to load the texture and add it)
+    std::shared_ptr<const Texture> find(const Key& key);
+
+    // Adds texture loaded on a miss. If a texture for the key was added since
+    // find was called, it's returned instead and the new one is dropped.
+    std::shared_ptr<const Texture> add(const Key& key, Texture texture);
+
+    // number of textures which are still used by someone
+    std::size_t getNumTextures() const;
+    Stats getStats() const;
+
+private:
+    struct KeyHash {
+        std::size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        std::weak_ptr<const Texture> texture;
+        std::size_t sizeBytes;
+    };
+
+    std::shared_ptr<const Texture> findLocked(const Key& key);
+
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> textures;
+    Stats stats;
+};
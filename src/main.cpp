@@ -1,11 +1,29 @@
 #include "Game.h"
 
-int main()
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+
+int main(int argc, char** argv)
 {
-    Game game;
-    game.start({
+    Game::Params params{
         .screenWidth = 1280,
         .screenHeight = 960,
         .windowTitle = "WebGPU test",
-    });
+    };
+    for (int i = 1; i < argc; ++i) {
+        const auto arg = std::string_view{argv[i]};
+        if (arg == "--fallback-adapter") {
+            params.forceFallbackAdapter = true;
+        } else if (arg == "--no-texture-compression") {
+            params.textureCompression = false;
+        } else if (arg == "--gpu-timing") {
+            params.gpuTiming = true;
+        } else if (arg == "--crowd" && i + 1 < argc) {
+            params.crowdSize = std::max(std::atoi(argv[++i]), 0);
+        }
+    }
+
+    Game game;
+    game.start(params);
 }
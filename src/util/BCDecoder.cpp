@@ -0,0 +1,342 @@
+#include "BCDecoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace
+{
+std::uint32_t readU16(const std::uint8_t* p)
+{
+    return std::uint32_t{p[0]} | (std::uint32_t{p[1]} << 8);
+}
+
+std::array<std::uint8_t, 4> unpackRGB565(std::uint32_t c)
+{
+    const auto r = (c >> 11) & 0x1f;
+    const auto g = (c >> 5) & 0x3f;
+    const auto b = c & 0x1f;
+    return {
+        static_cast<std::uint8_t>((r << 3) | (r >> 2)),
+        static_cast<std::uint8_t>((g << 2) | (g >> 4)),
+        static_cast<std::uint8_t>((b << 3) | (b >> 2)),
+        255,
+    };
+}
+
+// decodes BC4 block (8 bytes) into every 4th byte of dst
+void decodeBC4Block(const std::uint8_t* block, std::uint8_t* dst)
+{
+    const int a0 = block[0];
+    const int a1 = block[1];
+    std::array<std::uint8_t, 8> palette{};
+    palette[0] = static_cast<std::uint8_t>(a0);
+    palette[1] = static_cast<std::uint8_t>(a1);
+    if (a0 > a1) {
+        for (int i = 1; i < 7; ++i) {
+            palette[i + 1] = static_cast<std::uint8_t>(((7 - i) * a0 + i * a1 + 3) / 7);
+        }
+    } else {
+        for (int i = 1; i < 5; ++i) {
+            palette[i + 1] = static_cast<std::uint8_t>(((5 - i) * a0 + i * a1 + 2) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    std::uint64_t indices = 0;
+    for (int i = 0; i < 6; ++i) {
+        indices |= std::uint64_t{block[2 + i]} << (8 * i);
+    }
+    for (int i = 0; i < 16; ++i) {
+        dst[i * 4] = palette[(indices >> (3 * i)) & 0x7];
+    }
+}
+
+// Reads bits of a 128-bit block starting from the least significant bit of
+// its first byte
+class BitReader {
+public:
+    explicit BitReader(const std::uint8_t* block) : block(block) {}
+
+    std::uint32_t read(int numBits)
+    {
+        std::uint32_t value = 0;
+        for (int i = 0; i < numBits; ++i, ++pos) {
+            value |= ((block[pos >> 3] >> (pos & 7)) & 1u) << i;
+        }
+        return value;
+    }
+
+private:
+    const std::uint8_t* block;
+    int pos{0};
+};
+
+struct BC7Mode {
+    int numSubsets;
+    int partitionBits;
+    int rotationBits;
+    int indexSelectionBits;
+    int colorBits;
+    int alphaBits;
+    int endpointPBits; // one per endpoint
+    int sharedPBits; // one per subset
+    int indexBits;
+    int secondaryIndexBits;
+};
+
+constexpr std::array<BC7Mode, 8> BC7_MODES{{
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0},
+}};
+
+// bit i = subset of texel i
+constexpr std::array<std::uint16_t, 64> BC7_PARTITIONS_2{
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80,
+    0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000, 0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310,
+    0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C, 0xAAAA,
+    0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC,
+    0x6996, 0xC33C, 0x9966, 0x0660, 0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6,
+    0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+
+// bits 2*i and 2*i+1 = subset of texel i
+constexpr std::array<std::uint32_t, 64> BC7_PARTITIONS_3{
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0,
+    0x5A5A5050, 0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4,
+    0xA9A59450, 0x2A0A4250, 0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454,
+    0x6A6A4040, 0xA4A45000, 0x1A1A0500, 0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400,
+    0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200, 0xA9A58000, 0x5090A0A8, 0xA8A09050,
+    0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50, 0x500AA550, 0xAAAA4444,
+    0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600, 0xAA444444,
+    0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+    0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44,
+    0x2A4A5254,
+};
+
+// anchor texel of subset 1 in two-subset partitions
+constexpr std::array<std::uint8_t, 64> BC7_ANCHORS_2{
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, //
+    15, 2,  8,  2,  2,  8,  8,  15, 2,  8,  2,  2,  8,  8,  2,  2,  //
+    15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,  2,  15, 15, 6,  //
+    6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15,
+};
+
+// anchor texels of subsets 1 and 2 in three-subset partitions
+constexpr std::array<std::uint8_t, 64> BC7_ANCHORS_3_1{
+    3,  3,  15, 15, 8,  3,  15, 15, 8,  8,  6,  6,  6,  5,  3,  3, //
+    3,  3,  8,  15, 3,  3,  6,  10, 5,  8,  8,  6,  8,  5,  15, 15, //
+    8,  15, 3,  5,  6,  10, 8,  15, 15, 3,  15, 5,  15, 15, 15, 15, //
+    3,  15, 5,  5,  5,  8,  5,  10, 5,  10, 8,  13, 15, 12, 3,  3,
+};
+constexpr std::array<std::uint8_t, 64> BC7_ANCHORS_3_2{
+    15, 8,  8,  3,  15, 15, 3,  8,  15, 15, 15, 15, 15, 15, 15, 8, //
+    15, 8,  15, 3,  15, 8,  15, 8,  3,  15, 6,  10, 15, 15, 10, 8, //
+    15, 3,  15, 10, 10, 8,  9,  10, 6,  15, 8,  15, 3,  6,  6,  8, //
+    15, 3,  15, 15, 15, 15, 15, 15, 15, 15, 3,  15, 15, 8,  15, 15, //
+};
+
+constexpr std::array<std::uint8_t, 4> BC7_WEIGHTS_2{0, 21, 43, 64};
+constexpr std::array<std::uint8_t, 8> BC7_WEIGHTS_3{0, 9, 18, 27, 37, 46, 55, 64};
+constexpr std::array<std::uint8_t, 16> BC7_WEIGHTS_4{
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+std::uint8_t interpolateBC7(int e0, int e1, std::uint32_t index, int indexBits)
+{
+    const auto w = (indexBits == 2) ? BC7_WEIGHTS_2[index] :
+                   (indexBits == 3) ? BC7_WEIGHTS_3[index] :
+                                      BC7_WEIGHTS_4[index];
+    return static_cast<std::uint8_t>(((64 - w) * e0 + w * e1 + 32) >> 6);
+}
+
+// expands value with numBits bits to 8 bits by replicating its high bits
+int expandBits(std::uint32_t value, int numBits)
+{
+    value <<= (8 - numBits);
+    return static_cast<int>(value | (value >> numBits));
+}
+
+int getBC7Subset(const BC7Mode& mode, std::uint32_t partition, int texel)
+{
+    switch (mode.numSubsets) {
+    case 2:
+        return (BC7_PARTITIONS_2[partition] >> texel) & 1;
+    case 3:
+        return (BC7_PARTITIONS_3[partition] >> (2 * texel)) & 3;
+    default:
+        return 0;
+    }
+}
+
+bool isBC7Anchor(const BC7Mode& mode, std::uint32_t partition, int texel)
+{
+    if (texel == 0) {
+        return true;
+    }
+    switch (mode.numSubsets) {
+    case 2:
+        return texel == BC7_ANCHORS_2[partition];
+    case 3:
+        return texel == BC7_ANCHORS_3_1[partition] || texel == BC7_ANCHORS_3_2[partition];
+    default:
+        return false;
+    }
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+void decodeBC1Block(const std::uint8_t* block, std::uint8_t* rgba)
+{
+    const auto c0 = readU16(block);
+    const auto c1 = readU16(block + 2);
+    std::array<std::array<std::uint8_t, 4>, 4> palette{};
+    palette[0] = unpackRGB565(c0);
+    palette[1] = unpackRGB565(c1);
+    for (int ch = 0; ch < 3; ++ch) {
+        const int e0 = palette[0][ch];
+        const int e1 = palette[1][ch];
+        if (c0 > c1) {
+            palette[2][ch] = static_cast<std::uint8_t>((2 * e0 + e1 + 1) / 3);
+            palette[3][ch] = static_cast<std::uint8_t>((e0 + 2 * e1 + 1) / 3);
+        } else {
+            palette[2][ch] = static_cast<std::uint8_t>((e0 + e1 + 1) / 2);
+            palette[3][ch] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = (c0 > c1) ? 255 : 0; // transparent black
+
+    std::uint32_t indices = 0;
+    std::memcpy(&indices, block + 4, sizeof(indices)); // little endian
+    for (int i = 0; i < 16; ++i) {
+        std::memcpy(rgba + i * 4, palette[(indices >> (2 * i)) & 0x3].data(), 4);
+    }
+}
+
+void decodeBC5Block(const std::uint8_t* block, std::uint8_t* rgba)
+{
+    decodeBC4Block(block, rgba);
+    decodeBC4Block(block + 8, rgba + 1);
+    for (int i = 0; i < 16; ++i) {
+        rgba[i * 4 + 2] = 0;
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+void decodeBC7Block(const std::uint8_t* block, std::uint8_t* rgba)
+{
+    // mode is the number of zero bits before the first set one
+    int modeIdx = 0;
+    while (modeIdx < 8 && (block[0] & (1 << modeIdx)) == 0) {
+        ++modeIdx;
+    }
+    if (modeIdx == 8) {
+        std::memset(rgba, 0, 64);
+        return;
+    }
+
+    const auto& mode = BC7_MODES[modeIdx];
+    BitReader reader(block);
+    reader.read(modeIdx + 1);
+    const auto partition = reader.read(mode.partitionBits);
+    const auto rotation = reader.read(mode.rotationBits);
+    const auto indexSelection = reader.read(mode.indexSelectionBits);
+
+    // endpoints[subset * 2 + i][channel]
+    const auto numEndpoints = mode.numSubsets * 2;
+    std::array<std::array<std::uint32_t, 4>, 6> endpoints{};
+    for (int ch = 0; ch < 3; ++ch) {
+        for (int e = 0; e < numEndpoints; ++e) {
+            endpoints[e][ch] = reader.read(mode.colorBits);
+        }
+    }
+    for (int e = 0; e < numEndpoints; ++e) {
+        endpoints[e][3] = reader.read(mode.alphaBits);
+    }
+
+    auto colorBits = mode.colorBits;
+    auto alphaBits = mode.alphaBits;
+    if (mode.endpointPBits || mode.sharedPBits) {
+        std::array<std::uint32_t, 6> pBits{};
+        if (mode.endpointPBits) {
+            for (int e = 0; e < numEndpoints; ++e) {
+                pBits[e] = reader.read(1);
+            }
+        } else {
+            for (int s = 0; s < mode.numSubsets; ++s) {
+                pBits[s * 2] = pBits[s * 2 + 1] = reader.read(1);
+            }
+        }
+        for (int e = 0; e < numEndpoints; ++e) {
+            for (auto& value : endpoints[e]) {
+                value = (value << 1) | pBits[e];
+            }
+        }
+        ++colorBits;
+        if (alphaBits > 0) {
+            ++alphaBits;
+        }
+    }
+
+    std::array<std::array<int, 4>, 6> expanded{};
+    for (int e = 0; e < numEndpoints; ++e) {
+        for (int ch = 0; ch < 3; ++ch) {
+            expanded[e][ch] = expandBits(endpoints[e][ch], colorBits);
+        }
+        expanded[e][3] = (alphaBits > 0) ? expandBits(endpoints[e][3], alphaBits) : 255;
+    }
+
+    // anchor texels' indices have one bit less (their high bit is always 0)
+    std::array<std::uint32_t, 16> indices{};
+    for (int i = 0; i < 16; ++i) {
+        const auto isAnchor = isBC7Anchor(mode, partition, i);
+        indices[i] = reader.read(isAnchor ? mode.indexBits - 1 : mode.indexBits);
+    }
+    std::array<std::uint32_t, 16> secondaryIndices{};
+    if (mode.secondaryIndexBits > 0) {
+        for (int i = 0; i < 16; ++i) {
+            secondaryIndices[i] =
+                reader.read(i == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits);
+        }
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        const auto subset = getBC7Subset(mode, partition, i);
+        const auto& e0 = expanded[subset * 2];
+        const auto& e1 = expanded[subset * 2 + 1];
+
+        auto colorIndex = indices[i];
+        auto colorIndexBits = mode.indexBits;
+        auto alphaIndex = indices[i];
+        auto alphaIndexBits = mode.indexBits;
+        if (mode.secondaryIndexBits > 0) {
+            alphaIndex = secondaryIndices[i];
+            alphaIndexBits = mode.secondaryIndexBits;
+            if (indexSelection) {
+                std::swap(colorIndex, alphaIndex);
+                std::swap(colorIndexBits, alphaIndexBits);
+            }
+        }
+
+        auto* texel = rgba + i * 4;
+        for (int ch = 0; ch < 3; ++ch) {
+            texel[ch] = interpolateBC7(e0[ch], e1[ch], colorIndex, colorIndexBits);
+        }
+        texel[3] = interpolateBC7(e0[3], e1[3], alphaIndex, alphaIndexBits);
+        if (rotation > 0) {
+            std::swap(texel[3], texel[rotation - 1]);
+        }
+    }
+}
+
+} // end of namespace util
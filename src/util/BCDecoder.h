@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU decoders of BCn texture blocks, used when the device doesn't support
+// BC texture compression.
+// Each function decodes one 4x4 block into 16 RGBA8 texels (64 bytes, in
+// row-major order). sRGB blocks are decoded the same way as unorm ones - the
+// result is sRGB-encoded too.
+namespace util
+{
+// 8 bytes, 1-bit alpha (BC1 RGB blocks are decoded the same way)
+void decodeBC1Block(const std::uint8_t* block, std::uint8_t* rgba);
+// 16 bytes, R and G channels (B = 0, A = 255)
+void decodeBC5Block(const std::uint8_t* block, std::uint8_t* rgba);
+// 16 bytes, all modes. Invalid blocks are decoded as transparent black
+void decodeBC7Block(const std::uint8_t* block, std::uint8_t* rgba);
+}
@@ -0,0 +1,482 @@
+#include "CookedScene.h"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+#include <Graphics/Scene.h>
+#include <util/MappedFile.h>
+
+namespace
+{
+static const std::uint32_t COOKED_SCENE_MAGIC{0x43534445}; // "EDSC"
+// bump when the layout of the file or of the vertex data changes
+static const std::uint32_t COOKED_SCENE_VERSION{5};
+
+// all index/vertex blobs start at this alignment inside the file
+static const std::size_t COOKED_DATA_ALIGNMENT{16};
+
+struct CookedSceneHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t vertexDataAlignment;
+    std::uint64_t sourceHash;
+};
+
+// FNV-1a, but processes 8 bytes at a time (source buffers can be hundreds of MB)
+std::uint64_t hashBytes(std::span<const std::byte> data, std::uint64_t h)
+{
+    static const std::uint64_t FNV_PRIME{0x100000001b3};
+
+    const auto size = data.size();
+    std::size_t i = 0;
+    for (; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+        std::uint64_t w;
+        std::memcpy(&w, data.data() + i, sizeof(std::uint64_t));
+        h = (h ^ w) * FNV_PRIME;
+        h ^= h >> 32;
+    }
+    for (; i < size; ++i) {
+        h = (h ^ static_cast<std::uint64_t>(data[i])) * FNV_PRIME;
+    }
+    return (h ^ size) * FNV_PRIME;
+}
+
+class Writer {
+public:
+    template<typename T>
+    void write(const T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        writeBytes(&v, sizeof(T));
+    }
+
+    template<typename T>
+    void writeArray(std::span<const T> arr)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write<std::uint64_t>(arr.size());
+        writeBytes(arr.data(), arr.size_bytes());
+    }
+
+    template<typename T>
+    void writeArray(const std::vector<T>& arr)
+    {
+        writeArray(std::span<const T>{arr});
+    }
+
+    void writeString(const std::string& str)
+    {
+        write<std::uint32_t>(static_cast<std::uint32_t>(str.size()));
+        writeBytes(str.data(), str.size());
+    }
+
+    void writeBlob(std::span<const std::byte> blob)
+    {
+        write<std::uint64_t>(blob.size());
+        align(COOKED_DATA_ALIGNMENT);
+        writeBytes(blob.data(), blob.size());
+    }
+
+    const std::vector<std::byte>& getData() const { return data; }
+
+private:
+    void writeBytes(const void* ptr, std::size_t size)
+    {
+        const auto* bytes = static_cast<const std::byte*>(ptr);
+        data.insert(data.end(), bytes, bytes + size);
+    }
+
+    void align(std::size_t alignment)
+    {
+        data.resize((data.size() + alignment - 1) / alignment * alignment);
+    }
+
+    std::vector<std::byte> data;
+};
+
+class Reader {
+public:
+    Reader(std::span<const std::byte> data) : data(data) {}
+
+    template<typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T v;
+        std::memcpy(&v, readBytes(sizeof(T)).data(), sizeof(T));
+        return v;
+    }
+
+    template<typename T>
+    void readArray(std::vector<T>& arr)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto count = read<std::uint64_t>();
+        arr.resize(count);
+        const auto bytes = readBytes(count * sizeof(T));
+        if (count > 0) {
+            std::memcpy(arr.data(), bytes.data(), bytes.size());
+        }
+    }
+
+    std::string readString()
+    {
+        const auto size = read<std::uint32_t>();
+        const auto bytes = readBytes(size);
+        return std::string{reinterpret_cast<const char*>(bytes.data()), size};
+    }
+
+    std::span<const std::byte> readBlob()
+    {
+        const auto size = read<std::uint64_t>();
+        align(COOKED_DATA_ALIGNMENT);
+        return readBytes(size);
+    }
+
+    bool atEnd() const { return pos == data.size(); }
+
+private:
+    std::span<const std::byte> readBytes(std::size_t size)
+    {
+        assert(pos + size <= data.size() && "unexpected end of cooked scene file");
+        const auto bytes = data.subspan(pos, size);
+        pos += size;
+        return bytes;
+    }
+
+    void align(std::size_t alignment) { pos = (pos + alignment - 1) / alignment * alignment; }
+
+    std::span<const std::byte> data;
+    std::size_t pos{0};
+};
+
+void writeTransform(Writer& w, const Transform& transform)
+{
+    w.write(transform.position);
+    w.write(transform.heading);
+    w.write(transform.scale);
+}
+
+Transform readTransform(Reader& r)
+{
+    Transform transform;
+    transform.position = r.read<glm::vec3>();
+    transform.heading = r.read<glm::quat>();
+    transform.scale = r.read<glm::vec3>();
+    return transform;
+}
+
+void writeNode(Writer& w, const SceneNode* node)
+{
+    w.write<std::uint8_t>(node != nullptr);
+    if (!node) {
+        return;
+    }
+
+    w.writeString(node->name);
+    writeTransform(w, node->transform);
+    w.write<std::uint64_t>(node->meshIndex);
+    w.write<std::int32_t>(node->skinId);
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(node->instances.size()));
+    for (const auto& instance : node->instances) {
+        writeTransform(w, instance);
+    }
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(node->children.size()));
+    for (const auto& child : node->children) {
+        writeNode(w, child.get());
+    }
+}
+
+std::unique_ptr<SceneNode> readNode(Reader& r, SceneNode* parent)
+{
+    if (r.read<std::uint8_t>() == 0) {
+        return nullptr;
+    }
+
+    auto node = std::make_unique<SceneNode>();
+    node->parent = parent;
+    node->name = r.readString();
+    node->transform = readTransform(r);
+    node->meshIndex = static_cast<std::size_t>(r.read<std::uint64_t>());
+    node->skinId = r.read<std::int32_t>();
+
+    node->instances.resize(r.read<std::uint32_t>());
+    for (auto& instance : node->instances) {
+        instance = readTransform(r);
+    }
+
+    node->children.resize(r.read<std::uint32_t>());
+    for (auto& child : node->children) {
+        child = readNode(r, node.get());
+    }
+    return node;
+}
+
+void writeSkeleton(Writer& w, const Skeleton& skeleton)
+{
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(skeleton.joints.size()));
+    for (std::size_t i = 0; i < skeleton.joints.size(); ++i) {
+        w.write(skeleton.joints[i].id);
+        writeTransform(w, skeleton.joints[i].localTransform);
+        w.writeString(skeleton.jointNames[i]);
+    }
+    w.writeArray(skeleton.parents);
+    w.writeArray(skeleton.inverseBindMatrices);
+}
+
+Skeleton readSkeleton(Reader& r)
+{
+    Skeleton skeleton;
+    const auto numJoints = r.read<std::uint32_t>();
+    skeleton.joints.resize(numJoints);
+    skeleton.jointNames.resize(numJoints);
+    for (std::size_t i = 0; i < numJoints; ++i) {
+        skeleton.joints[i].id = r.read<JointId>();
+        skeleton.joints[i].localTransform = readTransform(r);
+        skeleton.jointNames[i] = r.readString();
+    }
+    r.readArray(skeleton.parents);
+    r.readArray(skeleton.inverseBindMatrices);
+    return skeleton;
+}
+
+void writeVec3Track(Writer& w, const SkeletalAnimation::Vec3Track& track)
+{
+    w.writeArray(track.times);
+    w.writeArray(track.keys);
+    w.write(track.rangeMin);
+    w.write(track.rangeScale);
+}
+
+void readVec3Track(Reader& r, SkeletalAnimation::Vec3Track& track)
+{
+    r.readArray(track.times);
+    r.readArray(track.keys);
+    track.rangeMin = r.read<glm::vec3>();
+    track.rangeScale = r.read<glm::vec3>();
+}
+
+void writeAnimation(Writer& w, const SkeletalAnimation& animation)
+{
+    w.writeString(animation.name);
+    w.write(animation.duration);
+    w.write<std::uint8_t>(animation.looped);
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(animation.tracks.size()));
+    for (const auto& track : animation.tracks) {
+        writeVec3Track(w, track.translations);
+        w.writeArray(track.rotations.times);
+        w.writeArray(track.rotations.keys);
+        writeVec3Track(w, track.scales);
+    }
+}
+
+SkeletalAnimation readAnimation(Reader& r)
+{
+    SkeletalAnimation animation;
+    animation.name = r.readString();
+    animation.duration = r.read<float>();
+    animation.looped = r.read<std::uint8_t>() != 0;
+    animation.tracks.resize(r.read<std::uint32_t>());
+    for (auto& track : animation.tracks) {
+        readVec3Track(r, track.translations);
+        r.readArray(track.rotations.times);
+        r.readArray(track.rotations.keys);
+        readVec3Track(r, track.scales);
+    }
+    return animation;
+}
+
+void writePrimitive(Writer& w, const util::CookedPrimitive& primitive)
+{
+    w.write<std::int32_t>(primitive.materialIdx);
+    w.write<std::uint8_t>(primitive.hasSkeleton);
+    w.write<std::uint8_t>(primitive.wideSkinAttribs);
+    w.write(primitive.boundingBox);
+    w.write(primitive.boundingSphere);
+    w.write(primitive.numIndices);
+    w.writeArray(primitive.attribs);
+    w.writeBlob(primitive.indexData);
+    w.writeBlob(primitive.vertexData);
+}
+
+util::CookedPrimitive readPrimitive(Reader& r)
+{
+    util::CookedPrimitive primitive;
+    primitive.materialIdx = r.read<std::int32_t>();
+    primitive.hasSkeleton = r.read<std::uint8_t>() != 0;
+    primitive.wideSkinAttribs = r.read<std::uint8_t>() != 0;
+    primitive.boundingBox = r.read<math::AABB>();
+    primitive.boundingSphere = r.read<math::Sphere>();
+    primitive.numIndices = r.read<std::uint32_t>();
+    r.readArray(primitive.attribs);
+    primitive.indexData = r.readBlob();
+    primitive.vertexData = r.readBlob();
+    return primitive;
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+std::filesystem::path getCookedScenePath(const std::filesystem::path& scenePath)
+{
+    auto path = scenePath;
+    path.replace_extension(".cooked");
+    return path;
+}
+
+std::uint64_t hashSourceFiles(
+    const std::filesystem::path& sceneDir,
+    const std::vector<std::string>& sourceFiles)
+{
+    std::uint64_t hash{0xcbf29ce484222325}; // FNV offset basis
+    for (const auto& sourceFile : sourceFiles) {
+        MappedFile file;
+        if (!file.open(sceneDir / sourceFile)) {
+            return 0; // missing source can't match any cooked hash
+        }
+        hash = hashBytes(file.getData(), hash);
+    }
+    return hash;
+}
+
+bool writeCookedScene(
+    const std::filesystem::path& path,
+    const std::vector<std::string>& sourceFiles,
+    std::uint64_t sourceHash,
+    std::uint64_t vertexDataAlignment,
+    const CookedSceneAssets& assets,
+    const Scene& scene)
+{
+    Writer w;
+    w.write(CookedSceneHeader{
+        .magic = COOKED_SCENE_MAGIC,
+        .version = COOKED_SCENE_VERSION,
+        .vertexDataAlignment = vertexDataAlignment,
+        .sourceHash = sourceHash,
+    });
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(sourceFiles.size()));
+    for (const auto& sourceFile : sourceFiles) {
+        w.writeString(sourceFile);
+    }
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(assets.materials.size()));
+    for (const auto& material : assets.materials) {
+        w.writeString(material.name);
+        w.write(material.baseColor);
+        w.writeString(material.diffuseTexturePath);
+    }
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(assets.meshes.size()));
+    for (const auto& primitives : assets.meshes) {
+        w.write<std::uint32_t>(static_cast<std::uint32_t>(primitives.size()));
+        for (const auto& primitive : primitives) {
+            writePrimitive(w, primitive);
+        }
+    }
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(scene.skeletons.size()));
+    for (const auto& skeleton : scene.skeletons) {
+        writeSkeleton(w, skeleton);
+    }
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(scene.animations.size()));
+    for (const auto& [name, animation] : scene.animations) {
+        writeAnimation(w, animation);
+    }
+
+    w.write<std::uint32_t>(static_cast<std::uint32_t>(scene.nodes.size()));
+    for (const auto& node : scene.nodes) {
+        writeNode(w, node.get());
+    }
+
+    // write to a temporary file first so that a partially written file is never loaded
+    auto tmpPath = path;
+    tmpPath += ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        const auto& data = w.getData();
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file) {
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    return !ec;
+}
+
+bool readCookedScene(
+    const MappedFile& file,
+    const std::filesystem::path& sceneDir,
+    std::uint64_t vertexDataAlignment,
+    CookedSceneAssets& assets,
+    Scene& scene)
+{
+    const auto data = file.getData();
+    if (data.size() < sizeof(CookedSceneHeader)) {
+        return false;
+    }
+
+    Reader r(data);
+    const auto header = r.read<CookedSceneHeader>();
+    if (header.magic != COOKED_SCENE_MAGIC || header.version != COOKED_SCENE_VERSION ||
+        header.vertexDataAlignment != vertexDataAlignment) {
+        return false;
+    }
+
+    std::vector<std::string> sourceFiles(r.read<std::uint32_t>());
+    for (auto& sourceFile : sourceFiles) {
+        sourceFile = r.readString();
+    }
+    if (hashSourceFiles(sceneDir, sourceFiles) != header.sourceHash) {
+        return false;
+    }
+
+    assets.materials.resize(r.read<std::uint32_t>());
+    for (auto& material : assets.materials) {
+        material.name = r.readString();
+        material.baseColor = r.read<glm::vec4>();
+        material.diffuseTexturePath = r.readString();
+    }
+
+    assets.meshes.resize(r.read<std::uint32_t>());
+    for (auto& primitives : assets.meshes) {
+        primitives.resize(r.read<std::uint32_t>());
+        for (auto& primitive : primitives) {
+            primitive = readPrimitive(r);
+        }
+    }
+
+    scene.skeletons.resize(r.read<std::uint32_t>());
+    for (auto& skeleton : scene.skeletons) {
+        skeleton = readSkeleton(r);
+    }
+
+    const auto numAnimations = r.read<std::uint32_t>();
+    scene.animations.reserve(numAnimations);
+    for (std::uint32_t i = 0; i < numAnimations; ++i) {
+        auto animation = readAnimation(r);
+        auto name = animation.name;
+        scene.animations.emplace(std::move(name), std::move(animation));
+    }
+
+    scene.nodes.resize(r.read<std::uint32_t>());
+    for (auto& node : scene.nodes) {
+        node = readNode(r, nullptr);
+    }
+
+    assert(r.atEnd());
+    return true;
+}
+
+} // end of namespace util
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+#include <Graphics/GPUMesh.h>
+#include <Math/Bounds.h>
+
+struct Scene;
+
+// Cooked scene is a binary snapshot of everything SceneLoader gets from a glTF
+// file. Index and vertex data are stored exactly as they're uploaded into
+// GPUMesh buffers, so they can be copied into staging memory straight from the
+// memory mapped file. The format is not portable between platforms.
+namespace util
+{
+class MappedFile;
+
+struct CookedMaterial {
+    std::string name;
+    glm::vec4 baseColor;
+    std::string diffuseTexturePath; // relative to scene dir, empty if none
+};
+
+struct CookedPrimitive {
+    int materialIdx{-1}; // index into CookedSceneAssets::materials
+    bool hasSkeleton{false};
+    bool wideSkinAttribs{false}; // see Mesh::jointIds
+    math::AABB boundingBox;
+    math::Sphere boundingSphere;
+
+    std::uint32_t numIndices{0};
+    std::span<const std::byte> indexData; // size is padded to 4 bytes
+    std::span<const std::byte> vertexData;
+    std::vector<GPUMesh::AttribProps> attribs; // offsets into vertexData
+};
+
+struct CookedSceneAssets {
+    std::vector<CookedMaterial> materials;
+    std::vector<std::vector<CookedPrimitive>> meshes; // index = SceneNode::meshIndex
+};
+
+// "city.gltf" -> "city.cooked"
+std::filesystem::path getCookedScenePath(const std::filesystem::path& scenePath);
+
+// hash of the contents of sourceFiles (paths are relative to sceneDir)
+std::uint64_t hashSourceFiles(
+    const std::filesystem::path& sceneDir,
+    const std::vector<std::string>& sourceFiles);
+
+// Writes scene's nodes, skeletons and animations + assets.
+// vertexDataAlignment is the alignment of attribs in CookedPrimitive::vertexData
+bool writeCookedScene(
+    const std::filesystem::path& path,
+    const std::vector<std::string>& sourceFiles,
+    std::uint64_t sourceHash,
+    std::uint64_t vertexDataAlignment,
+    const CookedSceneAssets& assets,
+    const Scene& scene);
+
+// Returns false without touching assets or scene if the file was written by
+// another version, with different vertex data alignment or if any of the
+// source files changed since cooking. Spans in assets point into the file.
+bool readCookedScene(
+    const MappedFile& file,
+    const std::filesystem::path& sceneDir,
+    std::uint64_t vertexDataAlignment,
+    CookedSceneAssets& assets,
+    Scene& scene);
+
+} // end of namespace util
@@ -1,18 +1,31 @@
 #include "GltfLoader.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <span>
 
+#include <Graphics/AnimationCompression.h>
 #include <Graphics/GPUMesh.h>
 #include <Graphics/MipMapGenerator.h>
 #include <Graphics/Scene.h>
 #include <Graphics/Skeleton.h>
+#include <Graphics/UploadManager.h>
+#include <Jobs/JobSystem.h>
 
+#include <util/CookedScene.h>
+#include <util/ImageLoader.h>
+#include <util/KTX2.h>
+#include <util/MappedFile.h>
 #include <util/WebGPUUtil.h>
 
+#include <AnimationCache.h>
 #include <MaterialCache.h>
 #include <MeshCache.h>
+#include <SkeletonCache.h>
 
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NO_STB_IMAGE
@@ -58,6 +71,11 @@ static const std::string GLTF_UVS_ACCESSOR{"TEXCOORD_0"};
 static const std::string GLTF_JOINTS_ACCESSOR{"JOINTS_0"};
 static const std::string GLTF_WEIGHTS_ACCESSOR{"WEIGHTS_0"};
 
+static const std::string GLTF_EXT_MESH_GPU_INSTANCING{"EXT_mesh_gpu_instancing"};
+static const std::string GLTF_INSTANCING_TRANSLATION_ACCESSOR{"TRANSLATION"};
+static const std::string GLTF_INSTANCING_ROTATION_ACCESSOR{"ROTATION"};
+static const std::string GLTF_INSTANCING_SCALE_ACCESSOR{"SCALE"};
+
 static const std::string GLTF_SAMPLER_PATH_TRANSLATION{"translation"};
 static const std::string GLTF_SAMPLER_PATH_ROTATION{"rotation"};
 static const std::string GLTF_SAMPLER_PATH_SCALE{"scale"};
@@ -77,6 +95,17 @@ glm::quat tg2glmQuat(const std::vector<double>& vec)
     };
 }
 
+// runs f on the calling thread if ctx has no job system
+template<typename F>
+void parallelFor(const util::LoadContext& ctx, std::size_t count, std::size_t batchSize, F&& f)
+{
+    if (ctx.jobSystem) {
+        ctx.jobSystem->parallelFor(count, batchSize, std::forward<F>(f));
+    } else {
+        f(std::size_t{0}, count);
+    }
+}
+
 template<typename T>
 std::span<const T> getPackedBufferSpan(
     const tinygltf::Model& model,
@@ -132,21 +161,79 @@ bool hasAccessor(const tinygltf::Primitive& primitive, const std::string& attrib
     return accessorIndex != -1;
 }
 
-std::filesystem::path getDiffuseTexturePath(
+// relative to glTF file's dir
+const std::string& getDiffuseTextureURI(
     const tinygltf::Model& model,
-    const tinygltf::Material& material,
-    const std::filesystem::path& fileDir)
+    const tinygltf::Material& material)
 {
     const auto textureIndex = material.pbrMetallicRoughness.baseColorTexture.index;
     const auto& textureId = model.textures[textureIndex];
     const auto& image = model.images[textureId.source];
-    return fileDir / image.uri;
+    return image.uri;
+}
+
+// JOINTS_0 can be stored as u8 or u16
+std::vector<std::array<std::uint16_t, 4>> loadSkinJoints(
+    const tinygltf::Model& model,
+    const tinygltf::Primitive& primitive)
+{
+    const auto& accessor = model.accessors[findAttributeAccessor(primitive, GLTF_JOINTS_ACCESSOR)];
+    std::vector<std::array<std::uint16_t, 4>> joints(accessor.count);
+    const auto convert = [&joints](const auto& src) {
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            for (std::size_t c = 0; c < 4; ++c) {
+                joints[i][c] = src[i][c];
+            }
+        }
+    };
+
+    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+        convert(getPackedBufferSpan<std::uint8_t[4]>(model, accessor));
+    } else {
+        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+        convert(getPackedBufferSpan<std::uint16_t[4]>(model, accessor));
+    }
+    return joints;
+}
+
+// WEIGHTS_0 can be stored as floats or normalized u8/u16
+std::vector<glm::vec4> loadSkinWeights(
+    const tinygltf::Model& model,
+    const tinygltf::Primitive& primitive)
+{
+    const auto& accessor =
+        model.accessors[findAttributeAccessor(primitive, GLTF_WEIGHTS_ACCESSOR)];
+    std::vector<glm::vec4> weights(accessor.count);
+    const auto convert = [&weights](const auto& src, float scale) {
+        for (std::size_t i = 0; i < src.size(); ++i) {
+            for (int c = 0; c < 4; ++c) {
+                weights[i][c] = static_cast<float>(src[i][c]) * scale;
+            }
+        }
+    };
+
+    switch (accessor.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        convert(getPackedBufferSpan<float[4]>(model, accessor), 1.f);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        assert(accessor.normalized);
+        convert(getPackedBufferSpan<std::uint8_t[4]>(model, accessor), 1.f / 255.f);
+        break;
+    default:
+        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT);
+        assert(accessor.normalized);
+        convert(getPackedBufferSpan<std::uint16_t[4]>(model, accessor), 1.f / 65535.f);
+        break;
+    }
+    return weights;
 }
 
 void loadPrimitive(
     const tinygltf::Model& model,
     const std::string& meshName,
     const tinygltf::Primitive& primitive,
+    std::span<const JointId> skinJointIds,
     Mesh& mesh)
 {
     mesh.name = meshName;
@@ -166,6 +253,9 @@ void loadPrimitive(
         mesh.positions[i] = glm::vec4(positions[i], 1.f);
     }
 
+    mesh.boundingBox = math::calculateAABB(mesh.positions);
+    mesh.boundingSphere = math::calculateBoundingSphere(mesh.positions, mesh.boundingBox);
+
     auto numVertices = positions.size();
     mesh.uvs.resize(numVertices);
     mesh.normals.resize(numVertices);
@@ -203,31 +293,28 @@ void loadPrimitive(
     // load jointIds and weights
     if (hasAccessor(primitive, GLTF_JOINTS_ACCESSOR)) {
         mesh.hasSkeleton = true;
-        mesh.jointIds.resize(numVertices);
-        mesh.weights.resize(numVertices);
-
-        // assume that less that 256 bones for now (TODO: fix)
-        const auto joints =
-            getPackedBufferSpan<std::uint8_t[4]>(model, primitive, GLTF_JOINTS_ACCESSOR);
-        const auto weights = getPackedBufferSpan<float[4]>(model, primitive, GLTF_WEIGHTS_ACCESSOR);
+        // JOINTS_0 are indices into skin.joints, which are reordered in loadSkeleton
+        assert(!skinJointIds.empty());
+        mesh.wideSkinAttribs = skinJointIds.size() > MAX_NARROW_SKIN_JOINTS;
 
+        const auto joints = loadSkinJoints(model, primitive);
+        const auto weights = loadSkinWeights(model, primitive);
         assert(joints.size() == numVertices);
         assert(weights.size() == numVertices);
 
-        for (std::size_t i = 0; i < joints.size(); ++i) {
-            auto& ids = mesh.jointIds[i];
-            ids.x = (std::uint32_t)joints[i][0];
-            ids.y = (std::uint32_t)joints[i][1];
-            ids.z = (std::uint32_t)joints[i][2];
-            ids.w = (std::uint32_t)joints[i][3];
-        }
-
-        for (std::size_t i = 0; i < weights.size(); ++i) {
-            auto& ws = mesh.weights[i];
-            ws.x = weights[i][0];
-            ws.y = weights[i][1];
-            ws.z = weights[i][2];
-            ws.w = weights[i][3];
+        const auto wordsPerVertex = mesh.wideSkinAttribs ? 2 : 1;
+        mesh.jointIds.resize(numVertices * wordsPerVertex);
+        mesh.weights.resize(numVertices * wordsPerVertex);
+        for (std::size_t i = 0; i < numVertices; ++i) {
+            std::array<std::uint16_t, 4> ids;
+            for (std::size_t c = 0; c < 4; ++c) {
+                ids[c] = skinJointIds[joints[i][c]];
+            }
+            packSkinAttrib(ids, mesh.wideSkinAttribs, &mesh.jointIds[i * wordsPerVertex]);
+            packSkinAttrib(
+                quantizeSkinWeights(weights[i], mesh.wideSkinAttribs),
+                mesh.wideSkinAttribs,
+                &mesh.weights[i * wordsPerVertex]);
         }
     }
 }
@@ -254,158 +341,108 @@ void loadFile(tinygltf::Model& gltfModel, const std::filesystem::path& path)
     }
 }
 
-void loadMaterial(
-    const util::LoadContext& ctx,
-    Material& material,
-    const std::filesystem::path& diffusePath)
-{
-    auto texFormat = wgpu::TextureFormat::RGBA8Unorm;
-    if (!diffusePath.empty()) {
-        const auto loadCtx = util::TextureLoadContext{
-            .device = ctx.device,
-            .queue = ctx.queue,
-            .mipMapGenerator = ctx.mipMapGenerator,
-        };
-        texFormat = wgpu::TextureFormat::RGBA8UnormSrgb;
-        material.diffuseTexture = util::loadTexture(loadCtx, diffusePath, texFormat);
-    } else {
-        material.diffuseTexture = ctx.whiteTexture;
-    }
-
-    { // material data
-
-        { // data buffer
-            const auto bufferDesc = wgpu::BufferDescriptor{
-                .label = "material data buffer",
-                .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
-                .size = sizeof(MaterialData),
-            };
-
-            material.dataBuffer = ctx.device.CreateBuffer(&bufferDesc);
-
-            const auto md = MaterialData{
-                .baseColor = material.baseColor,
-            };
-            ctx.queue.WriteBuffer(material.dataBuffer, 0, &md, sizeof(MaterialData));
-        }
-
-        const auto textureView = material.diffuseTexture.createView();
-
-        const std::array<wgpu::BindGroupEntry, 3> bindings{{
-            {
-                .binding = 0,
-                .buffer = material.dataBuffer,
-            },
-            {
-                .binding = 1,
-                .textureView = textureView,
-            },
-            {
-                .binding = 2,
-                .sampler = ctx.linearSampler,
-            },
-        }};
-        const auto bindGroupDesc = wgpu::BindGroupDescriptor{
-            .label = "material bind group",
-            .layout = ctx.materialLayout.Get(),
-            .entryCount = bindings.size(),
-            .entries = bindings.data(),
-        };
+void createMaterialBindGroup(const util::LoadContext& ctx, Material& material)
+{
+    const auto textureView = material.diffuseTexture->createView();
+
+    const std::array<wgpu::BindGroupEntry, 3> bindings{{
+        {
+            .binding = 0,
+            .buffer = material.dataBuffer,
+        },
+        {
+            .binding = 1,
+            .textureView = textureView,
+        },
+        {
+            .binding = 2,
+            .sampler = ctx.linearSampler,
+        },
+    }};
+    const auto bindGroupDesc = wgpu::BindGroupDescriptor{
+        .label = "material bind group",
+        .layout = ctx.materialLayout.Get(),
+        .entryCount = bindings.size(),
+        .entries = bindings.data(),
+    };
 
-        material.bindGroup = ctx.device.CreateBindGroup(&bindGroupDesc);
-    }
+    material.bindGroup = ctx.device.CreateBindGroup(&bindGroupDesc);
 }
 
-void loadGPUMesh(const util::LoadContext ctx, const Mesh& cpuMesh, GPUMesh& gpuMesh)
+// Lays out index and vertex data as they're uploaded into GPUMesh buffers
+void packMesh(
+    const Mesh& cpuMesh,
+    std::uint64_t minOffsetAlignment,
+    std::vector<std::byte>& indexData,
+    std::vector<std::byte>& vertexData,
+    std::vector<GPUMesh::AttribProps>& attribProps)
 {
-    { // index buffer
-        const auto bufferDesc = wgpu::BufferDescriptor{
-            .label = "mesh index buffer",
-            .usage = wgpu::BufferUsage::Index | wgpu::BufferUsage::CopyDst,
-            .size = cpuMesh.indices.size() * sizeof(std::uint16_t),
-        };
-
-        gpuMesh.indexBuffer = ctx.device.CreateBuffer(&bufferDesc);
-        ctx.queue.WriteBuffer(gpuMesh.indexBuffer, 0, cpuMesh.indices.data(), bufferDesc.size);
-        gpuMesh.indexBufferSize = static_cast<std::uint32_t>(cpuMesh.indices.size());
+    { // indices (already padded to four bytes by loadPrimitive)
+        const auto* indexBytes = reinterpret_cast<const std::byte*>(cpuMesh.indices.data());
+        indexData.assign(indexBytes, indexBytes + cpuMesh.indices.size() * sizeof(std::uint16_t));
     }
 
-    { // vertex buffer
-        const auto numVertices = cpuMesh.positions.size();
-
-        struct AttribData {
-            const char* name;
-            std::uint64_t componentSize;
-            void* data;
-            std::uint64_t offset;
-        };
-
-        std::vector<AttribData> attribs{{
-            {
-                .name = "positions",
-                .componentSize = sizeof(glm::vec4),
-                .data = (void*)cpuMesh.positions.data(),
-            },
-            {
-                .name = "normals",
-                .componentSize = sizeof(glm::vec4),
-                .data = (void*)cpuMesh.normals.data(),
-            },
-            {
-                .name = "tangents",
-                .componentSize = sizeof(glm::vec4),
-                .data = (void*)cpuMesh.tangents.data(),
-            },
-            {
-                .name = "uvs",
-                .componentSize = sizeof(glm::vec2),
-                .data = (void*)cpuMesh.uvs.data(),
-            },
-        }};
-
-        gpuMesh.hasSkeleton = cpuMesh.hasSkeleton;
-        if (cpuMesh.hasSkeleton) {
-            attribs.push_back({
-                .name = "jointIds",
-                .componentSize = sizeof(glm::vec<4, std::uint32_t>),
-                .data = (void*)cpuMesh.jointIds.data(),
-            });
-            attribs.push_back({
-                .name = "weights",
-                .componentSize = sizeof(glm::vec4),
-                .data = (void*)cpuMesh.weights.data(),
-            });
-        }
+    const auto numVertices = cpuMesh.positions.size();
 
-        std::uint64_t wholeSize{0};
-        std::uint64_t currentOffset{0};
-        for (auto& attrib : attribs) {
-            attrib.offset = currentOffset;
+    struct AttribData {
+        const char* name;
+        std::uint64_t componentSize;
+        const void* data;
+    };
 
-            currentOffset += attrib.componentSize * numVertices;
+    std::vector<AttribData> attribs{{
+        {
+            .name = "positions",
+            .componentSize = sizeof(glm::vec4),
+            .data = cpuMesh.positions.data(),
+        },
+        {
+            .name = "normals",
+            .componentSize = sizeof(glm::vec4),
+            .data = cpuMesh.normals.data(),
+        },
+        {
+            .name = "tangents",
+            .componentSize = sizeof(glm::vec4),
+            .data = cpuMesh.tangents.data(),
+        },
+        {
+            .name = "uvs",
+            .componentSize = sizeof(glm::vec2),
+            .data = cpuMesh.uvs.data(),
+        },
+    }};
+
+    if (cpuMesh.hasSkeleton) {
+        const auto packedSize = sizeof(std::uint32_t) * (cpuMesh.wideSkinAttribs ? 2 : 1);
+        attribs.push_back({
+            .name = "jointIds",
+            .componentSize = packedSize,
+            .data = cpuMesh.jointIds.data(),
+        });
+        attribs.push_back({
+            .name = "weights",
+            .componentSize = packedSize,
+            .data = cpuMesh.weights.data(),
+        });
+    }
 
-            const auto minOffsetAlignment =
-                ctx.requiredLimits.limits.minStorageBufferOffsetAlignment;
-            if (currentOffset % minOffsetAlignment != 0) {
-                currentOffset = ((currentOffset / minOffsetAlignment) + 1) * minOffsetAlignment;
-            }
+    attribProps.reserve(attribs.size());
+    std::uint64_t currentOffset{0};
+    for (const auto& attrib : attribs) {
+        const auto arrSize = attrib.componentSize * numVertices;
+        attribProps.push_back({.offset = currentOffset, .size = arrSize});
 
-            wholeSize += (currentOffset - attrib.offset);
+        currentOffset += arrSize;
+        if (currentOffset % minOffsetAlignment != 0) {
+            currentOffset = ((currentOffset / minOffsetAlignment) + 1) * minOffsetAlignment;
         }
+    }
 
-        const auto bufferDesc = wgpu::BufferDescriptor{
-            .label = "mesh data buffer",
-            .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
-            .size = wholeSize,
-        };
-        gpuMesh.vertexBuffer = ctx.device.CreateBuffer(&bufferDesc);
-
-        gpuMesh.attribs.reserve(attribs.size());
-        for (const auto& attrib : attribs) {
-            const auto arrSize = attrib.componentSize * numVertices;
-            ctx.queue.WriteBuffer(gpuMesh.vertexBuffer, attrib.offset, attrib.data, arrSize);
-            gpuMesh.attribs.push_back({.offset = attrib.offset, .size = arrSize});
-        }
+    vertexData.resize(currentOffset); // padding between attribs is zeroed
+    for (std::size_t i = 0; i < attribs.size(); ++i) {
+        const auto& props = attribProps[i];
+        std::memcpy(vertexData.data() + props.offset, attribs[i].data, props.size);
     }
 }
 
@@ -446,6 +483,64 @@ Transform loadTransform(const tinygltf::Node& gltfNode)
     return transform;
 }
 
+std::vector<Transform> loadInstanceTransforms(
+    const tinygltf::Model& model,
+    const tinygltf::Node& gltfNode)
+{
+    const auto it = gltfNode.extensions.find(GLTF_EXT_MESH_GPU_INSTANCING);
+    if (it == gltfNode.extensions.end()) {
+        return {};
+    }
+
+    const auto& attributes = it->second.Get("attributes");
+    if (!attributes.IsObject()) {
+        return {};
+    }
+
+    const auto getAccessor = [&](const std::string& name) -> const tinygltf::Accessor* {
+        if (!attributes.Has(name)) {
+            return nullptr;
+        }
+        const auto& accessor = model.accessors[attributes.Get(name).GetNumberAsInt()];
+        assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+        return &accessor;
+    };
+
+    const auto* translationAccessor = getAccessor(GLTF_INSTANCING_TRANSLATION_ACCESSOR);
+    const auto* rotationAccessor = getAccessor(GLTF_INSTANCING_ROTATION_ACCESSOR);
+    const auto* scaleAccessor = getAccessor(GLTF_INSTANCING_SCALE_ACCESSOR);
+
+    std::size_t numInstances{0};
+    for (const auto* accessor : {translationAccessor, rotationAccessor, scaleAccessor}) {
+        if (accessor) {
+            assert(numInstances == 0 || numInstances == accessor->count);
+            numInstances = accessor->count;
+        }
+    }
+
+    std::vector<Transform> instances(numInstances);
+    if (translationAccessor) {
+        const auto translations = getPackedBufferSpan<glm::vec3>(model, *translationAccessor);
+        for (std::size_t i = 0; i < numInstances; ++i) {
+            instances[i].position = translations[i];
+        }
+    }
+    if (rotationAccessor) {
+        const auto rotations = getPackedBufferSpan<glm::vec4>(model, *rotationAccessor);
+        for (std::size_t i = 0; i < numInstances; ++i) {
+            const auto& qv = rotations[i];
+            instances[i].heading = glm::quat{qv.w, qv.x, qv.y, qv.z};
+        }
+    }
+    if (scaleAccessor) {
+        const auto scales = getPackedBufferSpan<glm::vec3>(model, *scaleAccessor);
+        for (std::size_t i = 0; i < numInstances; ++i) {
+            instances[i].scale = scales[i];
+        }
+    }
+    return instances;
+}
+
 void loadNode(SceneNode& node, const tinygltf::Node& gltfNode, const tinygltf::Model& model)
 {
     node.name = gltfNode.name;
@@ -455,6 +550,7 @@ void loadNode(SceneNode& node, const tinygltf::Node& gltfNode, const tinygltf::M
     node.meshIndex = static_cast<std::size_t>(gltfNode.mesh);
 
     node.skinId = gltfNode.skin;
+    node.instances = loadInstanceTransforms(model, gltfNode);
 
     // load children
     node.children.resize(gltfNode.children.size());
@@ -476,43 +572,84 @@ Skeleton loadSkeleton(
     const tinygltf::Model& model,
     const tinygltf::Skin& skin)
 {
-    // load inverse bind matrices
+    const auto numJoints = skin.joints.size();
+    assert(numJoints < NULL_JOINT_ID);
+
+    // glTF doesn't require skin joints to be sorted, so sort them in
+    // depth-first order: parents come before children and subtrees are contiguous
+    std::vector<std::size_t> order; // JointId -> index in skin.joints
+    order.reserve(numJoints);
+    {
+        std::unordered_map<int, std::size_t> nodeIdxToSkinIdx;
+        nodeIdxToSkinIdx.reserve(numJoints);
+        for (std::size_t i = 0; i < numJoints; ++i) {
+            nodeIdxToSkinIdx.emplace(skin.joints[i], i);
+        }
+
+        std::vector<bool> hasParent(numJoints, false);
+        for (const auto& nodeIdx : skin.joints) {
+            for (const auto& childIdx : model.nodes[nodeIdx].children) {
+                if (const auto it = nodeIdxToSkinIdx.find(childIdx);
+                    it != nodeIdxToSkinIdx.end()) {
+                    hasParent[it->second] = true;
+                }
+            }
+        }
+
+        std::vector<std::size_t> stack;
+        for (std::size_t root = 0; root < numJoints; ++root) {
+            if (hasParent[root]) {
+                continue;
+            }
+            stack.push_back(root);
+            while (!stack.empty()) {
+                const auto skinIdx = stack.back();
+                stack.pop_back();
+                order.push_back(skinIdx);
+
+                // push in reverse, so that children are visited in glTF order
+                const auto& children = model.nodes[skin.joints[skinIdx]].children;
+                for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                    if (const auto childIt = nodeIdxToSkinIdx.find(*it);
+                        childIt != nodeIdxToSkinIdx.end()) {
+                        stack.push_back(childIt->second);
+                    }
+                }
+            }
+        }
+        assert(order.size() == numJoints);
+    }
+
     const auto& ibAccessor = model.accessors[skin.inverseBindMatrices];
     const auto ibs = getPackedBufferSpan<glm::mat4>(model, ibAccessor);
-    std::vector<glm::mat4> ibMatrices(ibAccessor.count);
-    ibMatrices.assign(ibs.begin(), ibs.end());
+    assert(ibs.size() == numJoints);
 
-    const auto numJoints = skin.joints.size();
     Skeleton skeleton;
     skeleton.joints.reserve(numJoints);
-    skeleton.inverseBindMatrices = ibMatrices;
+    skeleton.parents.resize(numJoints, NULL_JOINT_ID);
+    skeleton.inverseBindMatrices.resize(numJoints);
     skeleton.jointNames.resize(numJoints);
 
     gltfNodeIdxToJointId.reserve(numJoints);
-    { // load joints
-        JointId jointId{0};
-        for (const auto& nodeIdx : skin.joints) {
-            gltfNodeIdxToJointId.emplace(nodeIdx, jointId);
-
-            const auto& jointNode = model.nodes[nodeIdx];
-            skeleton.jointNames[jointId] = jointNode.name;
-
-            skeleton.joints.push_back(Joint{
-                .id = jointId,
-                .localTransform = loadTransform(jointNode),
-            });
-
-            ++jointId;
-        }
+    for (JointId jointId = 0; jointId < numJoints; ++jointId) {
+        gltfNodeIdxToJointId.emplace(skin.joints[order[jointId]], jointId);
     }
 
-    { // build hierarchy
-        skeleton.hierarchy.resize(numJoints);
-        for (JointId jointId = 0; jointId < skeleton.joints.size(); ++jointId) {
-            const auto& jointNode = model.nodes[skin.joints[jointId]];
-            for (const auto& childIdx : jointNode.children) {
-                const auto childJointId = gltfNodeIdxToJointId.at(childIdx);
-                skeleton.hierarchy[jointId].children.push_back(childJointId);
+    for (JointId jointId = 0; jointId < numJoints; ++jointId) {
+        const auto skinIdx = order[jointId];
+        const auto& jointNode = model.nodes[skin.joints[skinIdx]];
+        skeleton.jointNames[jointId] = jointNode.name;
+        skeleton.inverseBindMatrices[jointId] = ibs[skinIdx];
+        skeleton.joints.push_back(Joint{
+            .id = jointId,
+            .localTransform = loadTransform(jointNode),
+        });
+
+        for (const auto& childIdx : jointNode.children) {
+            if (const auto it = gltfNodeIdxToJointId.find(childIdx);
+                it != gltfNodeIdxToJointId.end()) {
+                assert(it->second > jointId);
+                skeleton.parents[it->second] = jointId;
             }
         }
     }
@@ -520,6 +657,25 @@ Skeleton loadSkeleton(
     return skeleton;
 }
 
+// Key times are made relative to the first key. Redundant keys are removed
+// later by compressAnimation
+template<typename KeyT, typename T, typename ConvertF>
+void loadChannelKeys(
+    std::span<const float> times,
+    std::span<const KeyT> keys,
+    std::vector<float>& dstTimes,
+    std::vector<T>& dstKeys,
+    ConvertF convert)
+{
+    assert(times.size() == keys.size() && "only LINEAR samplers are supported");
+    dstTimes.reserve(times.size());
+    dstKeys.reserve(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        dstTimes.push_back(times[i] - times[0]);
+        dstKeys.push_back(convert(keys[i]));
+    }
+}
+
 std::unordered_map<std::string, SkeletalAnimation> loadAnimations(
     const Skeleton& skeleton,
     const std::unordered_map<int, JointId>& gltfNodeIdxToJointId,
@@ -531,8 +687,7 @@ std::unordered_map<std::string, SkeletalAnimation> loadAnimations(
         animation.name = gltfAnimation.name;
 
         const auto numJoints = skeleton.joints.size();
-
-        animation.tracks.resize(numJoints);
+        std::vector<RawAnimationTracks> rawTracks(numJoints);
 
         for (const auto& channel : gltfAnimation.channels) {
             const auto& sampler = gltfAnimation.samplers[channel.sampler];
@@ -540,11 +695,12 @@ std::unordered_map<std::string, SkeletalAnimation> loadAnimations(
             const auto& timesAccessor = gltfModel.accessors[sampler.input];
             const auto times = getPackedBufferSpan<float>(gltfModel, timesAccessor);
 
-            animation.duration =
+            const auto channelDuration =
                 static_cast<float>(timesAccessor.maxValues[0] - timesAccessor.minValues[0]);
-            if (animation.duration == 0) {
+            if (channelDuration == 0) {
                 continue; // skip empty animations (e.g. keying sets)
             }
+            animation.duration = std::max(animation.duration, channelDuration);
 
             if (channel.target_path == "weights") {
                 // FIXME: find out why this channel exists
@@ -557,55 +713,33 @@ std::unordered_map<std::string, SkeletalAnimation> loadAnimations(
 
             const auto& outputAccessor = gltfModel.accessors[sampler.output];
             assert(outputAccessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
+            auto& tracks = rawTracks[jointId];
             if (channel.target_path == GLTF_SAMPLER_PATH_TRANSLATION) {
-                const auto translationKeys =
-                    getPackedBufferSpan<glm::vec3>(gltfModel, outputAccessor);
-
-                auto& tc = animation.tracks[jointId].translations;
-                if (translationKeys.size() == 2 && translationKeys[0] == translationKeys[1]) {
-                    tc.push_back(translationKeys[0]);
-                } else {
-                    if (jointId == 0) {
-                        assert(translationKeys.size() != 2);
-                    }
-                    tc.reserve(translationKeys.size());
-                    for (const auto& key : translationKeys) {
-                        tc.push_back(key);
-                    }
-                }
-
+                const auto keys = getPackedBufferSpan<glm::vec3>(gltfModel, outputAccessor);
+                loadChannelKeys(
+                    times, keys, tracks.translationTimes, tracks.translations, [](const auto& v) {
+                        return v;
+                    });
             } else if (channel.target_path == GLTF_SAMPLER_PATH_ROTATION) {
-                const auto rotationKeys = getPackedBufferSpan<glm::vec4>(gltfModel, outputAccessor);
-                auto& rc = animation.tracks[jointId].rotations;
-                if (rotationKeys.size() == 2 && rotationKeys[0] == rotationKeys[1]) {
-                    const auto& qv = rotationKeys[0];
-                    const glm::quat q{qv.w, qv.x, qv.y, qv.z};
-                    rc.push_back(q);
-                } else {
-                    rc.reserve(rotationKeys.size());
-                    for (const auto& qv : rotationKeys) {
-                        const glm::quat q{qv.w, qv.x, qv.y, qv.z};
-                        rc.push_back(q);
-                    }
-                }
+                const auto keys = getPackedBufferSpan<glm::vec4>(gltfModel, outputAccessor);
+                loadChannelKeys(
+                    times, keys, tracks.rotationTimes, tracks.rotations, [](const auto& qv) {
+                        return glm::quat{qv.w, qv.x, qv.y, qv.z};
+                    });
             } else if (channel.target_path == GLTF_SAMPLER_PATH_SCALE) {
-                const auto scaleKeys =
-                    getPackedBufferSpan<const glm::vec3>(gltfModel, outputAccessor);
-
-                auto& sc = animation.tracks[jointId].scales;
-                if (scaleKeys.size() == 2 && scaleKeys[0] == scaleKeys[1]) {
-                    sc.push_back(scaleKeys[0]);
-                } else {
-                    sc.reserve(scaleKeys.size());
-                    for (const auto& key : scaleKeys) {
-                        sc.push_back(key);
-                    }
-                }
-
+                const auto keys = getPackedBufferSpan<glm::vec3>(gltfModel, outputAccessor);
+                loadChannelKeys(times, keys, tracks.scaleTimes, tracks.scales, [](const auto& v) {
+                    return v;
+                });
             } else {
                 assert(false && "unexpected target_path");
             }
         }
+
+        const auto stats = compressAnimation(skeleton, rawTracks, animation);
+        std::cout << "Animation \"" << animation.name << "\": " << stats.rawSizeBytes << " -> "
+                  << stats.compressedSizeBytes << " bytes (" << stats.getRatio()
+                  << "x), max joint error " << stats.maxJointError << std::endl;
     }
 
     return animations;
@@ -615,66 +749,125 @@ std::unordered_map<std::string, SkeletalAnimation> loadAnimations(
 
 namespace util
 {
-void SceneLoader::loadScene(const LoadContext& ctx, Scene& scene, const std::filesystem::path& path)
+void SceneLoader::loadSceneData(
+    const LoadContext& ctx,
+    SceneLoadData& data,
+    const std::filesystem::path& path)
 {
-    const auto& device = ctx.device;
-    const auto& queue = ctx.queue;
-    const auto& materialLayout = ctx.materialLayout;
+    const auto startTime = std::chrono::steady_clock::now();
+    const auto printLoadTime = [&](const char* source) {
+        const auto loadTime = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - startTime);
+        std::cout << "Loaded " << path << " from " << source << " in " << loadTime.count()
+                  << " ms" << std::endl;
+    };
+
+    data.sceneDir = path.parent_path();
+    const auto cookedPath = getCookedScenePath(path);
+    const auto vertexDataAlignment = ctx.requiredLimits.limits.minStorageBufferOffsetAlignment;
+
+    // try cooked scene first
+    if (data.cookedFile.open(cookedPath)) {
+        if (readCookedScene(
+                data.cookedFile, data.sceneDir, vertexDataAlignment, data.assets, data.scene)) {
+            printLoadTime("cooked file");
+            return;
+        }
+        data.cookedFile.close();
+    }
+
+    // cooked file is missing or stale - load glTF and cook it for the next launch
+    const auto sourceFiles = loadGltfScene(ctx, data, path);
+    printLoadTime("glTF");
 
-    const auto fileDir = path.parent_path();
+    const auto sourceHash = hashSourceFiles(data.sceneDir, sourceFiles);
+    if (!writeCookedScene(
+            cookedPath, sourceFiles, sourceHash, vertexDataAlignment, data.assets, data.scene)) {
+        std::cout << "WARNING: failed to write cooked scene " << cookedPath << std::endl;
+    }
+}
 
+std::vector<std::string> SceneLoader::loadGltfScene(
+    const LoadContext& ctx,
+    SceneLoadData& data,
+    const std::filesystem::path& path)
+{
     tinygltf::Model gltfModel;
     loadFile(gltfModel, path);
 
     const auto& gltfScene = gltfModel.scenes[gltfModel.defaultScene];
+    auto& scene = data.scene;
+    auto& cookedAssets = data.assets;
 
-    // load materials
+    // materials
+    cookedAssets.materials.resize(gltfModel.materials.size());
     for (std::size_t materialIdx = 0; materialIdx < gltfModel.materials.size(); ++materialIdx) {
         const auto& gltfMaterial = gltfModel.materials[materialIdx];
-        Material material{
-            .name = gltfMaterial.name,
-            .baseColor = getDiffuseColor(gltfMaterial),
-        };
-
-        std::filesystem::path diffusePath;
+        auto& material = cookedAssets.materials[materialIdx];
+        material.name = gltfMaterial.name;
+        material.baseColor = getDiffuseColor(gltfMaterial);
         if (hasDiffuseTexture(gltfMaterial)) {
-            diffusePath = getDiffuseTexturePath(gltfModel, gltfMaterial, fileDir);
+            material.diffuseTexturePath = getDiffuseTextureURI(gltfModel, gltfMaterial);
         }
+    }
 
-        loadMaterial(ctx, material, diffusePath);
-        auto materialId = ctx.materialCache.addMaterial(std::move(material));
-        materialMapping.emplace(materialIdx, materialId);
+    scene.skeletons.reserve(gltfModel.skins.size());
+    for (const auto& skin : gltfModel.skins) {
+        scene.skeletons.push_back(loadSkeleton(gltfNodeIdxToJointId, gltfModel, skin));
+    }
+    // index in skin.joints -> JointId (for now only one skeleton per scene is supported)
+    std::vector<JointId> skinJointIds;
+    if (!gltfModel.skins.empty()) {
+        for (const auto& nodeIdx : gltfModel.skins[0].joints) {
+            skinJointIds.push_back(gltfNodeIdxToJointId.at(nodeIdx));
+        }
     }
 
-    // load meshes
-    scene.meshes.reserve(gltfModel.meshes.size());
+    // load and pack primitives on CPU in parallel
+    struct PrimitiveRef {
+        const tinygltf::Mesh* mesh;
+        const tinygltf::Primitive* primitive;
+    };
+    std::vector<PrimitiveRef> primitives;
     for (const auto& gltfMesh : gltfModel.meshes) {
-        SceneMesh mesh;
-        mesh.primitives.resize(gltfMesh.primitives.size());
-        for (std::size_t primitiveIdx = 0; primitiveIdx < gltfMesh.primitives.size();
-             ++primitiveIdx) {
-            const auto& gltfPrimitive = gltfMesh.primitives[primitiveIdx];
-
-            // load on CPU
-            Mesh cpuMesh;
-            loadPrimitive(gltfModel, gltfMesh.name, gltfPrimitive, cpuMesh);
-
-            // load to GPU
-            GPUMesh gpuMesh;
-            if (gltfPrimitive.material != -1) {
-                gpuMesh.materialId = materialMapping.at(gltfPrimitive.material);
-            }
-            loadGPUMesh(ctx, cpuMesh, gpuMesh);
-
-            const auto meshId = ctx.meshCache.addMesh(std::move(gpuMesh));
-            mesh.primitives[primitiveIdx] = meshId;
+        for (const auto& gltfPrimitive : gltfMesh.primitives) {
+            primitives.push_back({.mesh = &gltfMesh, .primitive = &gltfPrimitive});
         }
-        scene.meshes.push_back(std::move(mesh));
     }
 
-    scene.skeletons.reserve(gltfModel.skins.size());
-    for (const auto& skin : gltfModel.skins) {
-        scene.skeletons.push_back(loadSkeleton(gltfNodeIdxToJointId, gltfModel, skin));
+    const auto vertexDataAlignment = ctx.requiredLimits.limits.minStorageBufferOffsetAlignment;
+    std::vector<CookedPrimitive> cookedPrimitives(primitives.size());
+    auto& cookedMeshData = data.meshData;
+    cookedMeshData.resize(primitives.size() * 2);
+    parallelFor(ctx, primitives.size(), 4, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto& p = primitives[i];
+            Mesh cpuMesh;
+            loadPrimitive(gltfModel, p.mesh->name, *p.primitive, skinJointIds, cpuMesh);
+
+            auto& indexData = cookedMeshData[i * 2];
+            auto& vertexData = cookedMeshData[i * 2 + 1];
+            auto& cooked = cookedPrimitives[i];
+            packMesh(cpuMesh, vertexDataAlignment, indexData, vertexData, cooked.attribs);
+            cooked.materialIdx = p.primitive->material;
+            cooked.hasSkeleton = cpuMesh.hasSkeleton;
+            cooked.wideSkinAttribs = cpuMesh.wideSkinAttribs;
+            cooked.boundingBox = cpuMesh.boundingBox;
+            cooked.boundingSphere = cpuMesh.boundingSphere;
+            cooked.numIndices = static_cast<std::uint32_t>(cpuMesh.indices.size());
+            cooked.indexData = indexData;
+            cooked.vertexData = vertexData;
+        }
+    });
+
+    cookedAssets.meshes.resize(gltfModel.meshes.size());
+    std::size_t cookedPrimitiveIdx{0};
+    for (std::size_t meshIdx = 0; meshIdx < gltfModel.meshes.size(); ++meshIdx) {
+        auto& meshPrimitives = cookedAssets.meshes[meshIdx];
+        meshPrimitives.resize(gltfModel.meshes[meshIdx].primitives.size());
+        for (auto& primitive : meshPrimitives) {
+            primitive = std::move(cookedPrimitives[cookedPrimitiveIdx++]);
+        }
     }
 
     // load animations
@@ -713,6 +906,159 @@ void SceneLoader::loadScene(const LoadContext& ctx, Scene& scene, const std::fil
         auto& node = *nodePtr;
         loadNode(node, gltfNode, gltfModel);
     }
+
+    // files which the cooked scene depends on
+    std::vector<std::string> sourceFiles{path.filename().string()};
+    for (const auto& buffer : gltfModel.buffers) {
+        if (!buffer.uri.empty() && !buffer.uri.starts_with("data:")) {
+            sourceFiles.push_back(buffer.uri);
+        }
+    }
+    return sourceFiles;
+}
+
+Material createMaterial(const LoadContext& ctx, const CookedMaterial& cookedMaterial)
+{
+    Material material{
+        .name = cookedMaterial.name,
+        .diffuseTexture = ctx.whiteTexture,
+        .baseColor = cookedMaterial.baseColor,
+    };
+
+    { // data buffer
+        const auto bufferDesc = wgpu::BufferDescriptor{
+            .label = "material data buffer",
+            .usage = wgpu::BufferUsage::Uniform | wgpu::BufferUsage::CopyDst,
+            .size = sizeof(MaterialData),
+        };
+
+        material.dataBuffer = ctx.device.CreateBuffer(&bufferDesc);
+
+        const auto md = MaterialData{
+            .baseColor = material.baseColor,
+        };
+        ctx.uploadManager.uploadBuffer(material.dataBuffer, 0, &md, sizeof(MaterialData));
+    }
+
+    createMaterialBindGroup(ctx, material);
+    return material;
+}
+
+void setMaterialDiffuseTexture(
+    const LoadContext& ctx,
+    Material& material,
+    std::shared_ptr<const Texture> diffuseTexture)
+{
+    assert(diffuseTexture);
+    material.diffuseTexture = std::move(diffuseTexture);
+    createMaterialBindGroup(ctx, material);
+}
+
+TextureCache::Key getDiffuseTextureKey(const std::filesystem::path& path)
+{
+    auto ktx2Path = path;
+    ktx2Path.replace_extension(".ktx2");
+    if (isKTX2File(path) || std::filesystem::exists(ktx2Path)) {
+        // format and mips come from the file
+        return TextureCache::makeKey(ktx2Path, wgpu::TextureFormat::Undefined, false);
+    }
+    return TextureCache::makeKey(path, wgpu::TextureFormat::RGBA8UnormSrgb, true);
+}
+
+std::shared_ptr<const Texture> findOrLoadDiffuseTexture(
+    const LoadContext& ctx,
+    const TextureCache::Key& key,
+    const ImageData& diffuseImage,
+    const char* label)
+{
+    if (auto texture = ctx.textureCache.find(key)) {
+        return texture;
+    }
+
+    assert(diffuseImage.channels == 4);
+    assert(diffuseImage.pixels != nullptr);
+
+    const auto loadCtx = util::TextureLoadContext{
+        .device = ctx.device,
+        .queue = ctx.queue,
+        .mipMapGenerator = ctx.mipMapGenerator,
+        .uploadManager = ctx.uploadManager,
+    };
+    return ctx.textureCache.add(
+        key,
+        util::loadTexture(loadCtx, key.format, diffuseImage, key.generateMips, label));
+}
+
+std::shared_ptr<const Texture> findOrLoadDiffuseTexture(
+    const LoadContext& ctx,
+    const TextureCache::Key& key,
+    KTX2Image diffuseImage,
+    const char* label)
+{
+    if (auto texture = ctx.textureCache.find(key)) {
+        return texture;
+    }
+
+    const auto loadCtx = util::TextureLoadContext{
+        .device = ctx.device,
+        .queue = ctx.queue,
+        .mipMapGenerator = ctx.mipMapGenerator,
+        .uploadManager = ctx.uploadManager,
+    };
+    return ctx.textureCache.add(key, util::loadTexture(loadCtx, std::move(diffuseImage), label));
+}
+
+GPUMesh createGPUMesh(const LoadContext& ctx, const CookedPrimitive& primitive)
+{
+    GPUMesh gpuMesh;
+    gpuMesh.boundingBox = primitive.boundingBox;
+    gpuMesh.boundingSphere = primitive.boundingSphere;
+    gpuMesh.hasSkeleton = primitive.hasSkeleton;
+    gpuMesh.wideSkinAttribs = primitive.wideSkinAttribs;
+
+    { // index buffer
+        const auto bufferDesc = wgpu::BufferDescriptor{
+            .label = "mesh index buffer",
+            .usage = wgpu::BufferUsage::Index | wgpu::BufferUsage::CopyDst,
+            .size = primitive.indexData.size(),
+        };
+
+        gpuMesh.indexBuffer = ctx.device.CreateBuffer(&bufferDesc);
+        ctx.uploadManager.uploadBuffer(
+            gpuMesh.indexBuffer, 0, primitive.indexData.data(), primitive.indexData.size());
+        gpuMesh.indexBufferSize = primitive.numIndices;
+    }
+
+    { // vertex buffer
+        const auto bufferDesc = wgpu::BufferDescriptor{
+            .label = "mesh data buffer",
+            .usage = wgpu::BufferUsage::Storage | wgpu::BufferUsage::CopyDst,
+            .size = primitive.vertexData.size(),
+        };
+        gpuMesh.vertexBuffer = ctx.device.CreateBuffer(&bufferDesc);
+        ctx.uploadManager.uploadBuffer(
+            gpuMesh.vertexBuffer, 0, primitive.vertexData.data(), primitive.vertexData.size());
+        gpuMesh.attribs = primitive.attribs;
+    }
+
+    return gpuMesh;
+}
+
+void addSkeletonsAndAnimations(const LoadContext& ctx, Scene& scene)
+{
+    scene.skeletonIds.reserve(scene.skeletons.size());
+    for (auto& skeleton : scene.skeletons) {
+        scene.skeletonIds.push_back(ctx.skeletonCache.addSkeleton(std::move(skeleton)));
+    }
+    scene.skeletons.clear();
+
+    if (!scene.animations.empty()) {
+        assert(scene.skeletonIds.size() == 1); // for now only one skeleton supported
+        for (auto& [name, animation] : scene.animations) {
+            ctx.animationCache.addAnimation(scene.skeletonIds[0], std::move(animation));
+        }
+        scene.animations.clear();
+    }
 }
 
 }
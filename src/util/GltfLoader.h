@@ -1,18 +1,32 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <Graphics/GPUMesh.h>
 #include <Graphics/Material.h>
 #include <Graphics/Mesh.h>
+#include <Graphics/Scene.h>
 #include <Math/Transform.h>
+#include <util/CookedScene.h>
+#include <util/KTX2.h>
+#include <util/MappedFile.h>
 
+#include <TextureCache.h>
+
+struct ImageData;
 struct Model;
-struct Scene;
 
+class AnimationCache;
+class JobSystem;
 class MaterialCache;
 class MeshCache;
 class MipMapGenerator;
+class SkeletonCache;
+class UploadManager;
 
 namespace util
 {
@@ -24,26 +38,85 @@ struct LoadContext {
     const wgpu::Sampler& nearestSampler;
     const wgpu::Sampler& linearSampler;
 
-    const Texture& whiteTexture;
+    const std::shared_ptr<const Texture>& whiteTexture;
 
     MipMapGenerator& mipMapGenerator;
+    UploadManager& uploadManager;
     MaterialCache& materialCache;
+    TextureCache& textureCache;
     MeshCache& meshCache;
+    SkeletonCache& skeletonCache;
+    AnimationCache& animationCache;
+
+    // used for decoding meshes and images in parallel, can be null
+    JobSystem* jobSystem{nullptr};
 
     wgpu::RequiredLimits requiredLimits;
 };
 
+// Result of the CPU part of scene loading: GPU resources are created from it
+// on the main thread
+struct SceneLoadData {
+    Scene scene; // scene.meshes is filled when meshes are created
+    CookedSceneAssets assets;
+    std::filesystem::path sceneDir;
+
+    // storage for index/vertex data spans in assets.meshes
+    MappedFile cookedFile;
+    std::vector<std::vector<std::byte>> meshData;
+};
+
 class SceneLoader {
 public:
-    void loadScene(const LoadContext& context, Scene& scene, const std::filesystem::path& path);
+    // Reads cooked scene (see CookedScene.h) if it's up to date, otherwise
+    // loads glTF scene and writes cooked scene next to it.
+    // Doesn't touch the GPU, so it can be called from any thread. GPU resources
+    // are created from data by the caller (see Game::loadSceneAsync)
+    void loadSceneData(
+        const LoadContext& ctx,
+        SceneLoadData& data,
+        const std::filesystem::path& path);
 
 private:
-    // gltf material id -> material cache id
-    std::unordered_map<std::size_t, MaterialId> materialMapping;
+    // returns files which the scene was loaded from (relative to glTF file's dir)
+    std::vector<std::string> loadGltfScene(
+        const LoadContext& ctx,
+        SceneLoadData& data,
+        const std::filesystem::path& path);
 
     // gltf node id -> JointId
     // for now only one skeleton per scene is supported
     std::unordered_map<int, JointId> gltfNodeIdxToJointId;
 };
 
+// Creates material with ctx.whiteTexture as a diffuse texture placeholder
+Material createMaterial(const LoadContext& ctx, const CookedMaterial& cookedMaterial);
+void setMaterialDiffuseTexture(
+    const LoadContext& ctx,
+    Material& material,
+    std::shared_ptr<const Texture> diffuseTexture);
+
+// Key of diffuse textures in ctx.textureCache. If there's a KTX2 file next to
+// the image (with the same name and .ktx2 extension), the texture is loaded
+// from it instead (the key's path is then a KTX2 file, see isKTX2File)
+TextureCache::Key getDiffuseTextureKey(const std::filesystem::path& path);
+// Returns diffuse texture for key from ctx.textureCache, creates it from
+// diffuseImage and adds it to the cache if it's not there
+std::shared_ptr<const Texture> findOrLoadDiffuseTexture(
+    const LoadContext& ctx,
+    const TextureCache::Key& key,
+    const ImageData& diffuseImage,
+    const char* label);
+std::shared_ptr<const Texture> findOrLoadDiffuseTexture(
+    const LoadContext& ctx,
+    const TextureCache::Key& key,
+    KTX2Image diffuseImage,
+    const char* label);
+
+// materialId is not set
+GPUMesh createGPUMesh(const LoadContext& ctx, const CookedPrimitive& primitive);
+
+// Moves scene's skeletons and animations into caches and sets scene.skeletonIds
+void addSkeletonsAndAnimations(const LoadContext& ctx, Scene& scene);
+
 }
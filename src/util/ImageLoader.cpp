@@ -3,6 +3,8 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <utility>
+
 ImageData::~ImageData()
 {
     if (shouldSTBFree) {
@@ -11,6 +13,36 @@ ImageData::~ImageData()
     }
 }
 
+ImageData::ImageData(ImageData&& o) noexcept :
+    pixels(std::exchange(o.pixels, nullptr)),
+    width(o.width),
+    height(o.height),
+    channels(o.channels),
+    hdrPixels(std::exchange(o.hdrPixels, nullptr)),
+    hdr(o.hdr),
+    comp(o.comp),
+    shouldSTBFree(std::exchange(o.shouldSTBFree, false))
+{}
+
+ImageData& ImageData::operator=(ImageData&& o) noexcept
+{
+    if (this != &o) {
+        if (shouldSTBFree) {
+            stbi_image_free(pixels);
+            stbi_image_free(hdrPixels);
+        }
+        pixels = std::exchange(o.pixels, nullptr);
+        width = o.width;
+        height = o.height;
+        channels = o.channels;
+        hdrPixels = std::exchange(o.hdrPixels, nullptr);
+        hdr = o.hdr;
+        comp = o.comp;
+        shouldSTBFree = std::exchange(o.shouldSTBFree, false);
+    }
+    return *this;
+}
+
 namespace util
 {
 ImageData loadImage(const std::filesystem::path& p)
@@ -27,4 +59,15 @@ ImageData loadImage(const std::filesystem::path& p)
     return data;
 }
 
+std::size_t getImageDataSize(const std::filesystem::path& p)
+{
+    int width, height, comp;
+    if (!stbi_info(p.string().c_str(), &width, &height, &comp)) {
+        return 0;
+    }
+    // loadImage always decodes 4 channels
+    const auto texelSize = stbi_is_hdr(p.string().c_str()) ? sizeof(float[4]) : 4;
+    return static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * texelSize;
+}
+
 } // namespace util
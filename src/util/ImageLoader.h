@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <filesystem>
 
 struct ImageData {
@@ -7,8 +8,8 @@ struct ImageData {
     ~ImageData();
 
     // move only
-    ImageData(ImageData&& o) = default;
-    ImageData& operator=(ImageData&& o) = default;
+    ImageData(ImageData&& o) noexcept;
+    ImageData& operator=(ImageData&& o) noexcept;
 
     // no copies
     ImageData(const ImageData& o) = delete;
@@ -31,4 +32,7 @@ struct ImageData {
 namespace util
 {
 ImageData loadImage(const std::filesystem::path& p);
+// Returns the size of pixels which loadImage(p) would decode (only the header
+// is read) or 0 if p can't be loaded
+std::size_t getImageDataSize(const std::filesystem::path& p);
 }
@@ -0,0 +1,262 @@
+#include "KTX2.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include <Graphics/Texture.h>
+
+#include "BCDecoder.h"
+
+namespace
+{
+// see https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+constexpr std::array<std::uint8_t, 12> KTX2_IDENTIFIER{
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+constexpr std::size_t KTX2_HEADER_SIZE = 80; // identifier, header and index
+constexpr std::size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+// header fields (after the identifier)
+struct KTX2Header {
+    std::uint32_t vkFormat;
+    std::uint32_t typeSize;
+    std::uint32_t pixelWidth;
+    std::uint32_t pixelHeight;
+    std::uint32_t pixelDepth;
+    std::uint32_t layerCount;
+    std::uint32_t faceCount;
+    std::uint32_t levelCount;
+    std::uint32_t supercompressionScheme;
+};
+static_assert(sizeof(KTX2Header) == 36);
+
+template<typename T>
+T readLE(const std::byte* p)
+{
+    // all supported platforms are little endian
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+wgpu::TextureFormat getTextureFormat(std::uint32_t vkFormat)
+{
+    switch (vkFormat) {
+    case 37: // VK_FORMAT_R8G8B8A8_UNORM
+        return wgpu::TextureFormat::RGBA8Unorm;
+    case 43: // VK_FORMAT_R8G8B8A8_SRGB
+        return wgpu::TextureFormat::RGBA8UnormSrgb;
+    // WebGPU doesn't have BC1 RGB formats, but BC1 RGB blocks don't use
+    // 1-bit alpha mode, so they're decoded the same way with alpha = 1
+    case 131: // VK_FORMAT_BC1_RGB_UNORM_BLOCK
+    case 133: // VK_FORMAT_BC1_RGBA_UNORM_BLOCK
+        return wgpu::TextureFormat::BC1RGBAUnorm;
+    case 132: // VK_FORMAT_BC1_RGB_SRGB_BLOCK
+    case 134: // VK_FORMAT_BC1_RGBA_SRGB_BLOCK
+        return wgpu::TextureFormat::BC1RGBAUnormSrgb;
+    case 141: // VK_FORMAT_BC5_UNORM_BLOCK
+        return wgpu::TextureFormat::BC5RGUnorm;
+    case 145: // VK_FORMAT_BC7_UNORM_BLOCK
+        return wgpu::TextureFormat::BC7RGBAUnorm;
+    case 146: // VK_FORMAT_BC7_SRGB_BLOCK
+        return wgpu::TextureFormat::BC7RGBAUnormSrgb;
+    default:
+        return wgpu::TextureFormat::Undefined;
+    }
+}
+
+std::size_t getLevelSize(
+    wgpu::TextureFormat format,
+    std::uint32_t width,
+    std::uint32_t height,
+    std::uint32_t numFaces)
+{
+    const auto info = getTextureFormatInfo(format);
+    const auto blocksX = (width + info.blockSize - 1) / info.blockSize;
+    const auto blocksY = (height + info.blockSize - 1) / info.blockSize;
+    return std::size_t{blocksX} * blocksY * info.bytesPerBlock * numFaces;
+}
+
+util::KTX2Image loadFailed(const std::filesystem::path& path, const char* reason)
+{
+    std::cout << "Failed to load KTX2 file " << path << ": " << reason << std::endl;
+    return {};
+}
+
+} // end of anonymous namespace
+
+namespace util
+{
+bool isKTX2File(const std::filesystem::path& path)
+{
+    return path.extension() == ".ktx2";
+}
+
+KTX2Image loadKTX2Image(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return loadFailed(path, "can't open file");
+    }
+
+    KTX2Image image;
+    image.data.resize(static_cast<std::size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(image.data.data()), image.data.size());
+    if (!file || image.data.size() < KTX2_HEADER_SIZE ||
+        std::memcmp(image.data.data(), KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0) {
+        return loadFailed(path, "not a KTX2 file");
+    }
+
+    KTX2Header header;
+    std::memcpy(&header, image.data.data() + KTX2_IDENTIFIER.size(), sizeof(KTX2Header));
+    if (header.supercompressionScheme != 0) {
+        return loadFailed(path, "supercompression is not supported");
+    }
+    if (header.pixelDepth > 1 || header.layerCount > 1 ||
+        (header.faceCount != 1 && header.faceCount != 6)) {
+        return loadFailed(path, "only 2D textures and cubemaps are supported");
+    }
+    const auto format = getTextureFormat(header.vkFormat);
+    if (format == wgpu::TextureFormat::Undefined) {
+        return loadFailed(path, "texture format is not supported");
+    }
+    if (header.pixelWidth == 0 || header.pixelHeight == 0) {
+        return loadFailed(path, "texture is empty");
+    }
+
+    // levelCount = 0 means that the loader should generate mips, but only
+    // prebuilt ones are used for now
+    const auto numLevels = std::max(header.levelCount, 1u);
+    const auto maxNumLevels =
+        static_cast<std::uint32_t>(std::bit_width(std::max(header.pixelWidth, header.pixelHeight)));
+    if (numLevels > maxNumLevels) {
+        return loadFailed(path, "too many mip levels");
+    }
+    const auto levelIndexEnd = KTX2_HEADER_SIZE + numLevels * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+    if (image.data.size() < levelIndexEnd) {
+        return loadFailed(path, "level index is truncated");
+    }
+
+    image.levels.resize(numLevels);
+    for (std::uint32_t level = 0; level < numLevels; ++level) {
+        const auto* entry =
+            image.data.data() + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        const auto offset = readLE<std::uint64_t>(entry);
+        const auto size = readLE<std::uint64_t>(entry + 8);
+        const auto expectedSize = getLevelSize(
+            format,
+            std::max(header.pixelWidth >> level, 1u),
+            std::max(header.pixelHeight >> level, 1u),
+            header.faceCount);
+        if (size != expectedSize || offset > image.data.size() ||
+            size > image.data.size() - offset) {
+            return loadFailed(path, "invalid level data");
+        }
+        image.levels[level] = KTX2Image::Level{
+            .offset = static_cast<std::size_t>(offset),
+            .size = static_cast<std::size_t>(size),
+        };
+    }
+
+    image.format = format;
+    image.width = header.pixelWidth;
+    image.height = header.pixelHeight;
+    image.numFaces = header.faceCount;
+    return image;
+}
+
+bool needsTranscoding(const KTX2Image& image, bool textureCompressionBC)
+{
+    const auto info = getTextureFormatInfo(image.format);
+    if (info.blockSize == 1) {
+        return false;
+    }
+    return !textureCompressionBC || image.width % info.blockSize != 0 ||
+           image.height % info.blockSize != 0;
+}
+
+void transcodeToRGBA8(KTX2Image& image)
+{
+    using DecodeBlockFunc = void (*)(const std::uint8_t*, std::uint8_t*);
+    DecodeBlockFunc decodeBlock = nullptr;
+    auto dstFormat = wgpu::TextureFormat::RGBA8Unorm;
+    switch (image.format) {
+    case wgpu::TextureFormat::BC1RGBAUnormSrgb:
+        dstFormat = wgpu::TextureFormat::RGBA8UnormSrgb;
+        [[fallthrough]];
+    case wgpu::TextureFormat::BC1RGBAUnorm:
+        decodeBlock = decodeBC1Block;
+        break;
+    case wgpu::TextureFormat::BC5RGUnorm:
+        decodeBlock = decodeBC5Block;
+        break;
+    case wgpu::TextureFormat::BC7RGBAUnormSrgb:
+        dstFormat = wgpu::TextureFormat::RGBA8UnormSrgb;
+        [[fallthrough]];
+    case wgpu::TextureFormat::BC7RGBAUnorm:
+        decodeBlock = decodeBC7Block;
+        break;
+    default:
+        assert(false && "format can't be transcoded");
+        return;
+    }
+
+    const auto bytesPerBlock = getTextureFormatInfo(image.format).bytesPerBlock;
+
+    std::size_t dataSize = 0;
+    for (std::size_t level = 0; level < image.levels.size(); ++level) {
+        dataSize += std::size_t{std::max(image.width >> level, 1u)} *
+                    std::max(image.height >> level, 1u) * 4 * image.numFaces;
+    }
+    std::vector<std::byte> data;
+    data.reserve(dataSize);
+    std::vector<KTX2Image::Level> levels(image.levels.size());
+    for (std::size_t level = 0; level < image.levels.size(); ++level) {
+        const auto width = std::max(image.width >> level, 1u);
+        const auto height = std::max(image.height >> level, 1u);
+        levels[level] = KTX2Image::Level{
+            .offset = data.size(),
+            .size = std::size_t{width} * height * 4 * image.numFaces,
+        };
+        data.resize(data.size() + levels[level].size);
+
+        const auto blocksX = (width + 3) / 4;
+        const auto blocksY = (height + 3) / 4;
+        const auto* src =
+            reinterpret_cast<const std::uint8_t*>(image.data.data() + image.levels[level].offset);
+        auto* dst = reinterpret_cast<std::uint8_t*>(data.data() + levels[level].offset);
+        for (std::uint32_t face = 0; face < image.numFaces; ++face) {
+            for (std::uint32_t by = 0; by < blocksY; ++by) {
+                for (std::uint32_t bx = 0; bx < blocksX; ++bx) {
+                    std::array<std::uint8_t, 4 * 4 * 4> texels;
+                    decodeBlock(src, texels.data());
+                    src += bytesPerBlock;
+
+                    // blocks on the right/bottom edges can be partially outside of the level
+                    const auto x = bx * 4;
+                    const auto y = by * 4;
+                    const auto rowSize = std::min(4u, width - x) * 4;
+                    for (std::uint32_t row = 0; row < std::min(4u, height - y); ++row) {
+                        std::memcpy(
+                            dst + (std::size_t{y + row} * width + x) * 4,
+                            texels.data() + row * 16,
+                            rowSize);
+                    }
+                }
+            }
+            dst += std::size_t{width} * height * 4;
+        }
+    }
+
+    image.format = dstFormat;
+    image.levels = std::move(levels);
+    image.data = std::move(data);
+}
+
+} // end of namespace util
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <webgpu/webgpu_cpp.h>
+
+namespace util
+{
+// Texture stored in a KTX2 file together with all of its mip levels.
+// Supported: RGBA8 and BC1/BC5/BC7 formats, 2D textures and cubemaps without
+// supercompression.
+struct KTX2Image {
+    struct Level {
+        std::size_t offset; // in data
+        std::size_t size; // of all faces
+    };
+
+    // Undefined if the file couldn't be loaded
+    wgpu::TextureFormat format{wgpu::TextureFormat::Undefined};
+    std::uint32_t width{0};
+    std::uint32_t height{0};
+    std::uint32_t numFaces{1}; // 6 for cubemaps, faces are stored one after another
+    std::vector<Level> levels; // level 0 is the biggest one
+    std::vector<std::byte> data;
+};
+
+bool isKTX2File(const std::filesystem::path& path);
+
+// Returns image with Undefined format (and prints the reason) if the file
+// can't be read or its contents are not supported
+KTX2Image loadKTX2Image(const std::filesystem::path& path);
+
+// Block-compressed images have to be transcoded if the device doesn't support
+// them, or if their size is not a multiple of the block size (which WebGPU
+// requires from compressed textures)
+bool needsTranscoding(const KTX2Image& image, bool textureCompressionBC);
+// Decodes block-compressed image into RGBA8Unorm(Srgb), keeping all of its levels
+void transcodeToRGBA8(KTX2Image& image);
+
+} // end of namespace util
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace util
+{
+// Read-only memory mapped file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // returns false if the file doesn't exist, is empty or can't be mapped
+    bool open(const std::filesystem::path& path);
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    std::span<const std::byte> getData() const { return {data, size}; }
+
+private:
+    const std::byte* data{nullptr};
+    std::size_t size{0};
+
+#ifdef _WIN32
+    void* fileHandle{nullptr};
+    void* mappingHandle{nullptr};
+#endif
+};
+
+} // end of namespace util
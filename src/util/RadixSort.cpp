@@ -0,0 +1,57 @@
+#include "RadixSort.h"
+
+#include <array>
+#include <utility>
+
+namespace util
+{
+void radixSort(std::vector<SortKey>& keys, std::vector<SortKey>& tmp)
+{
+    static constexpr int NUM_PASSES = sizeof(std::uint64_t);
+    static constexpr std::size_t NUM_BUCKETS = 256;
+
+    const auto count = keys.size();
+    if (count < 2) {
+        return;
+    }
+    tmp.resize(count);
+
+    // build histograms for all passes at once
+    std::array<std::array<std::uint32_t, NUM_BUCKETS>, NUM_PASSES> histograms{};
+    for (const auto& k : keys) {
+        for (int pass = 0; pass < NUM_PASSES; ++pass) {
+            ++histograms[pass][(k.key >> (pass * 8)) & 0xFF];
+        }
+    }
+
+    auto* src = &keys;
+    auto* dst = &tmp;
+    for (int pass = 0; pass < NUM_PASSES; ++pass) {
+        auto& histogram = histograms[pass];
+
+        // all keys have the same byte - nothing to do
+        const auto firstByte = ((*src)[0].key >> (pass * 8)) & 0xFF;
+        if (histogram[firstByte] == count) {
+            continue;
+        }
+
+        // prefix sum -> bucket offsets
+        std::uint32_t offset{0};
+        for (auto& h : histogram) {
+            const auto c = h;
+            h = offset;
+            offset += c;
+        }
+
+        for (const auto& k : *src) {
+            (*dst)[histogram[(k.key >> (pass * 8)) & 0xFF]++] = k;
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != &keys) {
+        keys.swap(tmp);
+    }
+}
+
+} // end of namespace util
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace util
+{
+struct SortKey {
+    std::uint64_t key;
+    std::uint32_t value; // payload (usually an index into some other array)
+};
+
+// Stable LSD radix sort (8 bits per pass) of keys in ascending order.
+// Passes in which all keys have the same byte are skipped, so sorting keys
+// which only use lower bits is cheaper.
+// tmp is used as a scratch buffer, so that it can be reused between calls.
+void radixSort(std::vector<SortKey>& keys, std::vector<SortKey>& tmp);
+
+} // end of namespace util
@@ -9,8 +9,10 @@
 #include <cassert>
 
 #include "ImageLoader.h"
+#include "KTX2.h"
 
 #include <Graphics/MipMapGenerator.h>
+#include <Graphics/UploadManager.h>
 
 namespace
 {
@@ -25,27 +27,44 @@ void copyTextureToGPU(
         .mipLevel = 0,
         .origin = origin,
     };
-    const wgpu::TextureDataLayout source{
-        .bytesPerRow = static_cast<std::uint32_t>(data.width * data.channels),
-        .rowsPerImage = static_cast<std::uint32_t>(data.height),
-    };
-
-    wgpu::Extent3D writeSize{
+    const wgpu::Extent3D writeSize{
         .width = static_cast<std::uint32_t>(data.width),
         .height = static_cast<std::uint32_t>(data.height),
         .depthOrArrayLayers = 1,
     };
-    const auto pixelsSize = data.width * data.height * data.channels;
-    ctx.queue.WriteTexture(&destination, (void*)data.pixels, pixelsSize, &source, &writeSize);
+    ctx.uploadManager.uploadTexture(
+        destination,
+        writeSize,
+        data.pixels,
+        static_cast<std::uint32_t>(data.width * data.channels),
+        static_cast<std::uint32_t>(data.height));
 }
 
-wgpu::TextureUsage getTextureUsage(bool generateMips)
+// Textures with generated mips are render attachments (for the render pass
+// fallback) and, if MipMapGenerator can write their format, storage textures.
+// sRGB textures are then created with unorm format and sRGB view format.
+wgpu::Texture createTexture(
+    const util::TextureLoadContext& ctx,
+    wgpu::TextureDescriptor textureDesc,
+    bool generateMips)
 {
-    if (generateMips) {
-        return wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst |
-               wgpu::TextureUsage::RenderAttachment;
+    textureDesc.usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst;
+    if (!generateMips) {
+        return ctx.device.CreateTexture(&textureDesc);
     }
-    return wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst;
+
+    textureDesc.usage |= wgpu::TextureUsage::RenderAttachment;
+    const auto viewFormat = textureDesc.format;
+    const auto storageFormat = MipMapGenerator::getStorageFormat(viewFormat);
+    if (storageFormat != wgpu::TextureFormat::Undefined) {
+        textureDesc.usage |= wgpu::TextureUsage::StorageBinding;
+        textureDesc.format = storageFormat;
+        if (storageFormat != viewFormat) {
+            textureDesc.viewFormatCount = 1;
+            textureDesc.viewFormats = &viewFormat;
+        }
+    }
+    return ctx.device.CreateTexture(&textureDesc);
 }
 
 }
@@ -143,6 +162,10 @@ Texture loadTexture(
     wgpu::TextureFormat format,
     bool generateMips)
 {
+    if (isKTX2File(path)) {
+        return loadTexture(ctx, loadKTX2Image(path), path.string().c_str());
+    }
+
     ImageData data = util::loadImage(path);
     assert(data.channels == 4);
     assert(data.pixels != nullptr);
@@ -158,10 +181,8 @@ Texture loadTexture(
     const char* label)
 {
     const auto mipLevelCount = generateMips ? calculateMipCount(data.width, data.height) : 1;
-    auto usage = getTextureUsage(generateMips);
     const auto textureDesc = wgpu::TextureDescriptor{
         .label = label,
-        .usage = getTextureUsage(generateMips),
         .dimension = wgpu::TextureDimension::e2D,
         .size =
             {
@@ -173,7 +194,7 @@ Texture loadTexture(
         .mipLevelCount = mipLevelCount,
     };
 
-    auto texture = ctx.device.CreateTexture(&textureDesc);
+    auto texture = createTexture(ctx, textureDesc, generateMips);
     copyTextureToGPU(ctx, data, texture);
 
     auto tex = Texture{
@@ -183,11 +204,74 @@ Texture loadTexture(
         .format = format,
     };
     if (generateMips) {
+        // mip generation is submitted separately and reads the copied level 0
+        // (batched mips are generated after the batch owner flushes uploads)
+        if (!ctx.mipMapGenerator.isBatching()) {
+            ctx.uploadManager.flush(ctx.queue);
+        }
         ctx.mipMapGenerator.generateMips(ctx.device, ctx.queue, tex);
     }
     return tex;
 }
 
+Texture loadTexture(const TextureLoadContext& ctx, KTX2Image image, const char* label)
+{
+    assert(image.format != wgpu::TextureFormat::Undefined);
+    if (needsTranscoding(image, ctx.device.HasFeature(wgpu::FeatureName::TextureCompressionBC))) {
+        transcodeToRGBA8(image);
+    }
+
+    const auto mipLevelCount = static_cast<std::uint32_t>(image.levels.size());
+    const auto textureDesc = wgpu::TextureDescriptor{
+        .label = label,
+        .usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::CopyDst,
+        .dimension = wgpu::TextureDimension::e2D,
+        .size =
+            {
+                .width = image.width,
+                .height = image.height,
+                .depthOrArrayLayers = image.numFaces,
+            },
+        .format = image.format,
+        .mipLevelCount = mipLevelCount,
+    };
+    auto texture = ctx.device.CreateTexture(&textureDesc);
+
+    // mips are prebuilt, so levels are copied as they are, all faces at once
+    const auto info = getTextureFormatInfo(image.format);
+    for (std::uint32_t level = 0; level < mipLevelCount; ++level) {
+        const auto width = std::max(image.width >> level, 1u);
+        const auto height = std::max(image.height >> level, 1u);
+        const auto blocksX = (width + info.blockSize - 1) / info.blockSize;
+        const auto blocksY = (height + info.blockSize - 1) / info.blockSize;
+
+        const wgpu::ImageCopyTexture destination{
+            .texture = texture,
+            .mipLevel = level,
+        };
+        // copies of compressed textures cover whole blocks
+        const wgpu::Extent3D writeSize{
+            .width = blocksX * info.blockSize,
+            .height = blocksY * info.blockSize,
+            .depthOrArrayLayers = image.numFaces,
+        };
+        ctx.uploadManager.uploadTexture(
+            destination,
+            writeSize,
+            image.data.data() + image.levels[level].offset,
+            blocksX * info.bytesPerBlock,
+            blocksY);
+    }
+
+    return Texture{
+        .texture = texture,
+        .mipLevelCount = mipLevelCount,
+        .size = {static_cast<int>(image.width), static_cast<int>(image.height)},
+        .format = image.format,
+        .isCubemap = image.numFaces == 6,
+    };
+}
+
 Texture createPixelTexture(
     const TextureLoadContext& ctx,
     wgpu::TextureFormat format,
@@ -207,15 +291,43 @@ Texture createPixelTexture(
     return util::loadTexture(ctx, format, data, false, label);
 }
 
+std::array<std::filesystem::path, 6> getCubemapImagePaths(const std::filesystem::path& imagesDir)
+{
+    static const std::array<std::filesystem::path, 6>
+        fileNames{"right.jpg", "left.jpg", "top.jpg", "bottom.jpg", "front.jpg", "back.jpg"};
+
+    std::array<std::filesystem::path, 6> paths;
+    for (std::size_t face = 0; face < fileNames.size(); ++face) {
+        paths[face] = imagesDir / fileNames[face];
+    }
+    return paths;
+}
+
+std::array<ImageData, 6> loadCubemapImages(const std::filesystem::path& imagesDir)
+{
+    const auto paths = getCubemapImagePaths(imagesDir);
+    std::array<ImageData, 6> images;
+    for (std::size_t face = 0; face < paths.size(); ++face) {
+        images[face] = util::loadImage(paths[face]);
+    }
+    return images;
+}
+
 Texture loadCubemap(
     const TextureLoadContext& ctx,
     const std::filesystem::path& imagesDir,
     bool generateMips,
     const char* label)
 {
-    static const std::array<std::filesystem::path, 6>
-        paths{"right.jpg", "left.jpg", "top.jpg", "bottom.jpg", "front.jpg", "back.jpg"};
+    return loadCubemap(ctx, loadCubemapImages(imagesDir), generateMips, label);
+}
 
+Texture loadCubemap(
+    const TextureLoadContext& ctx,
+    const std::array<ImageData, 6>& images,
+    bool generateMips,
+    const char* label)
+{
     wgpu::Texture texture;
     std::uint32_t faceWidth;
     std::uint32_t faceHeight;
@@ -225,8 +337,7 @@ Texture loadCubemap(
     bool textureCreated = false;
     std::uint32_t face = 0;
 
-    for (auto& p : paths) {
-        ImageData data = util::loadImage(imagesDir / p);
+    for (const auto& data : images) {
         assert(data.channels == 4);
         assert(data.pixels != nullptr);
 
@@ -237,7 +348,6 @@ Texture loadCubemap(
             mipLevelCount = generateMips ? calculateMipCount(data.width, data.height) : 1;
             const auto textureDesc = wgpu::TextureDescriptor{
                 .label = label,
-                .usage = getTextureUsage(generateMips),
                 .dimension = wgpu::TextureDimension::e2D,
                 .size =
                     {
@@ -248,7 +358,7 @@ Texture loadCubemap(
                 .format = format,
                 .mipLevelCount = mipLevelCount,
             };
-            texture = ctx.device.CreateTexture(&textureDesc);
+            texture = createTexture(ctx, textureDesc, generateMips);
             textureCreated = true;
         } else {
             // all images must be of the same size
@@ -271,6 +381,11 @@ Texture loadCubemap(
     };
 
     if (generateMips) {
+        // mip generation is submitted separately and reads the copied level 0
+        // (batched mips are generated after the batch owner flushes uploads)
+        if (!ctx.mipMapGenerator.isBatching()) {
+            ctx.uploadManager.flush(ctx.queue);
+        }
         ctx.mipMapGenerator.generateMips(ctx.device, ctx.queue, tex);
     }
 
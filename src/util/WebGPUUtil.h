@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <filesystem>
 
 #include <webgpu/webgpu_cpp.h>
@@ -10,7 +11,13 @@
 
 struct ImageData;
 
+namespace util
+{
+struct KTX2Image;
+}
+
 class MipMapGenerator;
+class UploadManager;
 
 namespace util
 {
@@ -37,14 +44,22 @@ struct TextureLoadContext {
     const wgpu::Device& device;
     const wgpu::Queue& queue;
     MipMapGenerator& mipMapGenerator;
+    UploadManager& uploadManager;
 };
 
+// KTX2 files (see isKTX2File) are loaded with their own format and mips,
+// format and generateMips are ignored for them
 Texture loadTexture(
     const TextureLoadContext& ctx,
     const std::filesystem::path& path,
     wgpu::TextureFormat format,
     bool generateMips = true);
 
+// Creates texture with all levels (and faces) of the image. Block-compressed
+// images are transcoded to RGBA8 first if the device can't use them (it's
+// faster to do on the thread which loaded the image, see needsTranscoding)
+Texture loadTexture(const TextureLoadContext& ctx, KTX2Image image, const char* label = nullptr);
+
 Texture loadTexture(
     const TextureLoadContext& ctx,
     wgpu::TextureFormat format,
@@ -65,4 +80,13 @@ Texture loadCubemap(
     bool generateMips = true,
     const char* label = nullptr);
 
+// images are in order: right, left, top, bottom, front, back
+std::array<std::filesystem::path, 6> getCubemapImagePaths(const std::filesystem::path& imagesDir);
+std::array<ImageData, 6> loadCubemapImages(const std::filesystem::path& imagesDir);
+Texture loadCubemap(
+    const TextureLoadContext& ctx,
+    const std::array<ImageData, 6>& images,
+    bool generateMips = true,
+    const char* label = nullptr);
+
 } // namespace util
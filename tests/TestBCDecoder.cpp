@@ -0,0 +1,172 @@
+#include <util/BCDecoder.h>
+
+#include <array>
+#include <cstdint>
+
+#include "TestUtil.h"
+
+namespace
+{
+using Block = std::array<std::uint8_t, 16>;
+using Texels = std::array<std::uint8_t, 4 * 4 * 4>;
+using RGBA = std::array<std::uint8_t, 4>;
+
+// Writes fields of BC7 blocks starting from the least significant bit
+struct BlockWriter {
+    void write(std::uint32_t value, int numBits)
+    {
+        for (int i = 0; i < numBits; ++i, ++pos) {
+            if ((value >> i) & 1) {
+                block[pos / 8] |= static_cast<std::uint8_t>(1 << (pos % 8));
+            }
+        }
+    }
+
+    Block block{};
+    int pos{0};
+};
+
+RGBA getTexel(const Texels& texels, int i)
+{
+    return {texels[i * 4], texels[i * 4 + 1], texels[i * 4 + 2], texels[i * 4 + 3]};
+}
+
+void testBC1()
+{
+    Texels texels{};
+
+    { // c0 > c1: 4 colors, 2 of them interpolated
+        const std::array<std::uint8_t, 8> block{
+            0x00, 0xF8, // c0 = red (565)
+            0x1F, 0x00, // c1 = blue
+            0b11'10'01'00, 0, 0, 0, // first row: indices 0, 1, 2, 3
+        };
+        util::decodeBC1Block(block.data(), texels.data());
+        CHECK((getTexel(texels, 0) == RGBA{255, 0, 0, 255}));
+        CHECK((getTexel(texels, 1) == RGBA{0, 0, 255, 255}));
+        CHECK((getTexel(texels, 2) == RGBA{170, 0, 85, 255}));
+        CHECK((getTexel(texels, 3) == RGBA{85, 0, 170, 255}));
+        // other rows use index 0
+        CHECK((getTexel(texels, 15) == RGBA{255, 0, 0, 255}));
+    }
+
+    { // c0 <= c1: 3 colors and transparent black
+        const std::array<std::uint8_t, 8> block{
+            0x1F, 0x00, // c0 = blue
+            0x00, 0xF8, // c1 = red
+            0b11'10'01'00, 0, 0, 0,
+        };
+        util::decodeBC1Block(block.data(), texels.data());
+        CHECK((getTexel(texels, 0) == RGBA{0, 0, 255, 255}));
+        CHECK((getTexel(texels, 1) == RGBA{255, 0, 0, 255}));
+        const auto mid = getTexel(texels, 2);
+        CHECK(mid[0] >= 127 && mid[0] <= 128 && mid[1] == 0 && mid[2] >= 127 && mid[2] <= 128);
+        CHECK(mid[3] == 255);
+        CHECK((getTexel(texels, 3) == RGBA{0, 0, 0, 0}));
+    }
+}
+
+void testBC5()
+{
+    const Block block{
+        // R: r0 > r1 - 8 values, first 8 texels use indices 0..7
+        255, 0, 0b1000'1000, 0xC6, 0xFA, 0, 0, 0,
+        // G: g0 <= g1 - 6 values + 0 and 255, all texels use index 0
+        0, 255, 0, 0, 0, 0, 0, 0};
+    Texels texels{};
+    util::decodeBC5Block(block.data(), texels.data());
+
+    const std::array<std::uint8_t, 8> expectedR{255, 0, 219, 182, 146, 109, 73, 36};
+    for (int i = 0; i < 8; ++i) {
+        CHECK((getTexel(texels, i) == RGBA{expectedR[i], 0, 0, 255}));
+    }
+    CHECK((getTexel(texels, 15) == RGBA{255, 0, 0, 255}));
+}
+
+void testBC7Mode6()
+{
+    // 7-bit endpoints + p-bits, 4-bit indices: texel i uses index i
+    BlockWriter w;
+    w.write(1 << 6, 7); // mode 6
+    w.write(127, 7); // R0, R1
+    w.write(0, 7);
+    w.write(64, 7); // G0, G1
+    w.write(64, 7);
+    w.write(0, 7); // B0, B1
+    w.write(127, 7);
+    w.write(127, 7); // A0, A1
+    w.write(127, 7);
+    w.write(1, 1); // p0
+    w.write(0, 1); // p1
+    for (int i = 0; i < 16; ++i) {
+        w.write(i, i == 0 ? 3 : 4); // the anchor index has one bit less
+    }
+    CHECK(w.pos == 128);
+
+    Texels texels{};
+    util::decodeBC7Block(w.block.data(), texels.data());
+    // endpoints: (255, 129, 1, 255) and (0, 128, 254, 254)
+    CHECK((getTexel(texels, 0) == RGBA{255, 129, 1, 255}));
+    CHECK((getTexel(texels, 1) == RGBA{239, 129, 17, 255})); // weight 4
+    CHECK((getTexel(texels, 7) == RGBA{135, 129, 120, 255})); // weight 30
+    CHECK((getTexel(texels, 8) == RGBA{120, 128, 135, 254})); // weight 34
+    CHECK((getTexel(texels, 15) == RGBA{0, 128, 254, 254}));
+}
+
+void testBC7Mode5Rotation()
+{
+    // separate color and alpha indices, rotation 1 swaps R and A
+    BlockWriter w;
+    w.write(1 << 5, 6); // mode 5
+    w.write(1, 2); // rotation
+    w.write(127, 7); // R0, R1
+    w.write(0, 7);
+    w.write(0, 7); // G0, G1
+    w.write(0, 7);
+    w.write(0, 7); // B0, B1
+    w.write(0, 7);
+    w.write(255, 8); // A0, A1
+    w.write(0, 8);
+    for (int i = 0; i < 16; ++i) {
+        w.write(i & 3, i == 0 ? 1 : 2); // color indices
+    }
+    for (int i = 0; i < 16; ++i) {
+        w.write(3, i == 0 ? 1 : 2); // alpha indices (1 for the anchor)
+    }
+    CHECK(w.pos == 128);
+
+    Texels texels{};
+    util::decodeBC7Block(w.block.data(), texels.data());
+    // before rotation: R = 255, 171, 84, 0 and A = 171 (anchor), 0 (others)
+    CHECK((getTexel(texels, 0) == RGBA{171, 0, 0, 255}));
+    CHECK((getTexel(texels, 1) == RGBA{0, 0, 0, 171}));
+    CHECK((getTexel(texels, 2) == RGBA{0, 0, 0, 84}));
+    CHECK((getTexel(texels, 3) == RGBA{0, 0, 0, 0}));
+}
+
+void testBC7Invalid()
+{
+    // no mode bit is set
+    const Block block{};
+    Texels texels;
+    texels.fill(42);
+    util::decodeBC7Block(block.data(), texels.data());
+    bool allZero = true;
+    for (const auto v : texels) {
+        allZero = allZero && (v == 0);
+    }
+    CHECK(allZero);
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    testBC1();
+    testBC5();
+    testBC7Mode6();
+    testBC7Mode5Rotation();
+    testBC7Invalid();
+
+    return test::testsFailed();
+}
@@ -0,0 +1,170 @@
+#include <Jobs/JobSystem.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "TestUtil.h"
+
+namespace
+{
+// jobs which schedule other jobs and wait for them
+void testNestedJobs(JobSystem& jobSystem)
+{
+    static constexpr std::size_t NUM_OUTER_JOBS = 200;
+    static constexpr std::size_t NUM_INNER_JOBS = 50;
+
+    std::atomic<std::size_t> numInnerJobsDone{0};
+    JobCounter outerCounter;
+    for (std::size_t i = 0; i < NUM_OUTER_JOBS; ++i) {
+        jobSystem.schedule(
+            [&jobSystem, &numInnerJobsDone]() {
+                JobCounter innerCounter;
+                for (std::size_t j = 0; j < NUM_INNER_JOBS; ++j) {
+                    jobSystem.schedule(
+                        [&numInnerJobsDone]() { ++numInnerJobsDone; }, &innerCounter);
+                }
+                jobSystem.wait(innerCounter);
+                CHECK(innerCounter.isDone());
+            },
+            &outerCounter);
+    }
+    jobSystem.wait(outerCounter);
+
+    CHECK(outerCounter.isDone());
+    CHECK(numInnerJobsDone == NUM_OUTER_JOBS * NUM_INNER_JOBS);
+}
+
+// every index is visited exactly once, batches don't overlap
+void testParallelFor(JobSystem& jobSystem)
+{
+    for (const std::size_t count : {0, 1, 7, 64, 1000, 100'003}) {
+        for (const std::size_t batchSize : {0, 1, 16, 1000}) {
+            if (batchSize == 1 && count > 1000) {
+                continue; // too slow
+            }
+            std::vector<std::atomic<std::uint32_t>> visits(count);
+            jobSystem.parallelFor(count, batchSize, [&visits](std::size_t begin, std::size_t end) {
+                CHECK(begin < end);
+                for (auto i = begin; i < end; ++i) {
+                    ++visits[i];
+                }
+            });
+
+            std::size_t numWrongVisits = 0;
+            for (const auto& v : visits) {
+                if (v != 1) {
+                    ++numWrongVisits;
+                }
+            }
+            CHECK(numWrongVisits == 0);
+        }
+    }
+}
+
+void testNestedParallelFor(JobSystem& jobSystem)
+{
+    static constexpr std::size_t NUM_ROWS = 64;
+    static constexpr std::size_t NUM_COLUMNS = 1000;
+
+    std::vector<std::uint32_t> values(NUM_ROWS * NUM_COLUMNS);
+    jobSystem.parallelFor(NUM_ROWS, 1, [&](std::size_t rowBegin, std::size_t rowEnd) {
+        for (auto row = rowBegin; row < rowEnd; ++row) {
+            jobSystem.parallelFor(NUM_COLUMNS, 100, [&](std::size_t begin, std::size_t end) {
+                for (auto column = begin; column < end; ++column) {
+                    values[row * NUM_COLUMNS + column] += 1;
+                }
+            });
+        }
+    });
+
+    std::size_t sum = 0;
+    for (const auto& v : values) {
+        sum += v;
+    }
+    CHECK(sum == NUM_ROWS * NUM_COLUMNS);
+}
+
+// many small jobs scheduled while workers are stealing
+void testManyJobs(JobSystem& jobSystem)
+{
+    static constexpr std::size_t NUM_ROUNDS = 20;
+    static constexpr std::size_t NUM_JOBS = 10'000;
+
+    for (std::size_t round = 0; round < NUM_ROUNDS; ++round) {
+        std::atomic<std::size_t> sum{0};
+        JobCounter counter;
+        for (std::size_t i = 0; i < NUM_JOBS; ++i) {
+            jobSystem.schedule([&sum, i]() { sum += i; }, &counter);
+        }
+        jobSystem.wait(counter);
+        CHECK(sum == NUM_JOBS * (NUM_JOBS - 1) / 2);
+    }
+}
+
+// workers of one job system schedule and wait for jobs of another one with
+// fewer queues (like Game's jobSystem and loaderJobSystem)
+void testTwoJobSystems()
+{
+    static constexpr std::size_t NUM_OUTER_JOBS = 100;
+    static constexpr std::size_t NUM_INNER_JOBS = 20;
+
+    JobSystem bigSystem;
+    bigSystem.init(6);
+    JobSystem smallSystem;
+    smallSystem.init(1);
+
+    const auto scheduleFrom = [](JobSystem& outer, JobSystem& inner) {
+        std::atomic<std::size_t> numInnerJobsDone{0};
+        JobCounter outerCounter;
+        for (std::size_t i = 0; i < NUM_OUTER_JOBS; ++i) {
+            outer.schedule(
+                [&inner, &numInnerJobsDone]() {
+                    // give workers of the outer system time to take some of these jobs
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    JobCounter innerCounter;
+                    for (std::size_t j = 0; j < NUM_INNER_JOBS; ++j) {
+                        inner.schedule(
+                            [&numInnerJobsDone]() { ++numInnerJobsDone; }, &innerCounter);
+                    }
+                    inner.wait(innerCounter);
+                },
+                &outerCounter);
+        }
+        outer.wait(outerCounter);
+        CHECK(numInnerJobsDone == NUM_OUTER_JOBS * NUM_INNER_JOBS);
+    };
+    scheduleFrom(bigSystem, smallSystem);
+    scheduleFrom(smallSystem, bigSystem);
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    const auto maxNumWorkers = std::max(JobSystem::getDefaultNumWorkers(), std::size_t{3});
+    for (const auto numWorkers : {std::size_t{0}, std::size_t{1}, maxNumWorkers}) {
+        std::cout << "Workers: " << numWorkers << std::endl;
+
+        JobSystem jobSystem;
+        jobSystem.init(numWorkers);
+        CHECK(jobSystem.getNumThreads() == numWorkers + 1);
+
+        testNestedJobs(jobSystem);
+        testParallelFor(jobSystem);
+        testNestedParallelFor(jobSystem);
+        testManyJobs(jobSystem);
+
+        // can be restarted after shutdown
+        jobSystem.shutdown();
+        jobSystem.init(numWorkers);
+        testNestedJobs(jobSystem);
+    }
+
+    testTwoJobSystems();
+
+    return test::testsFailed();
+}
@@ -0,0 +1,284 @@
+#include <util/KTX2.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <vector>
+
+#include "TestUtil.h"
+
+namespace
+{
+constexpr std::uint32_t VK_FORMAT_BC7_UNORM_BLOCK = 145;
+constexpr std::uint32_t VK_FORMAT_BC7_SRGB_BLOCK = 146;
+
+// BC7 mode 6 block in which all texels are (r, 1, 1, 255). r must be odd,
+// because its low bit is a p-bit which is shared with other channels
+std::array<std::uint8_t, 16> makeSolidBC7Block(std::uint8_t r)
+{
+    std::array<std::uint8_t, 16> block{};
+    int pos = 0;
+    const auto write = [&block, &pos](std::uint32_t value, int numBits) {
+        for (int i = 0; i < numBits; ++i, ++pos) {
+            if ((value >> i) & 1) {
+                block[pos / 8] |= static_cast<std::uint8_t>(1 << (pos % 8));
+            }
+        }
+    };
+    write(1 << 6, 7); // mode 6
+    write(r >> 1, 7); // R0, R1
+    write(0, 7);
+    write(0, 7); // G0, G1
+    write(0, 7);
+    write(0, 7); // B0, B1
+    write(0, 7);
+    write(127, 7); // A0, A1
+    write(127, 7);
+    write(r & 1, 1); // p0
+    write(0, 1); // p1
+    // all indices are 0 (endpoint 0)
+    return block;
+}
+
+struct KTX2FileDesc {
+    std::uint32_t vkFormat;
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t numFaces{1};
+    std::uint32_t numLevels{1};
+    // red channel of all texels of a level's face
+    std::function<std::uint8_t(std::uint32_t level, std::uint32_t face)> getRed;
+};
+
+template<typename T>
+void append(std::vector<std::uint8_t>& data, T value)
+{
+    const auto offset = data.size();
+    data.resize(offset + sizeof(T));
+    std::memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+// Writes BC7 KTX2 file with levels stored from the smallest to the biggest one,
+// like KTX tools do
+void writeKTX2File(const std::filesystem::path& path, const KTX2FileDesc& desc)
+{
+    std::vector<std::vector<std::uint8_t>> levels(desc.numLevels);
+    for (std::uint32_t level = 0; level < desc.numLevels; ++level) {
+        const auto width = std::max(desc.width >> level, 1u);
+        const auto height = std::max(desc.height >> level, 1u);
+        const auto numBlocks = ((width + 3) / 4) * ((height + 3) / 4);
+        for (std::uint32_t face = 0; face < desc.numFaces; ++face) {
+            const auto block = makeSolidBC7Block(desc.getRed(level, face));
+            for (std::uint32_t i = 0; i < numBlocks; ++i) {
+                levels[level].insert(levels[level].end(), block.begin(), block.end());
+            }
+        }
+    }
+
+    std::vector<std::uint8_t> data{
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+    append(data, desc.vkFormat);
+    append(data, std::uint32_t{1}); // typeSize
+    append(data, desc.width);
+    append(data, desc.height);
+    append(data, std::uint32_t{0}); // pixelDepth
+    append(data, std::uint32_t{0}); // layerCount
+    append(data, desc.numFaces);
+    append(data, desc.numLevels);
+    append(data, std::uint32_t{0}); // supercompressionScheme
+    // no DFD, KVD or SGD
+    for (int i = 0; i < 4; ++i) {
+        append(data, std::uint32_t{0});
+    }
+    append(data, std::uint64_t{0});
+    append(data, std::uint64_t{0});
+
+    std::vector<std::uint64_t> levelOffsets(desc.numLevels);
+    auto offset = std::uint64_t{data.size() + desc.numLevels * 24};
+    for (auto level = desc.numLevels; level-- > 0;) {
+        levelOffsets[level] = offset;
+        offset += levels[level].size();
+    }
+    for (std::uint32_t level = 0; level < desc.numLevels; ++level) {
+        append(data, levelOffsets[level]);
+        append(data, std::uint64_t{levels[level].size()}); // byteLength
+        append(data, std::uint64_t{levels[level].size()}); // uncompressedByteLength
+    }
+    for (auto level = desc.numLevels; level-- > 0;) {
+        data.insert(data.end(), levels[level].begin(), levels[level].end());
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+}
+
+std::uint8_t getByte(const util::KTX2Image& image, std::size_t offset)
+{
+    return static_cast<std::uint8_t>(image.data[offset]);
+}
+
+void testMipmapped2D(const std::filesystem::path& dir)
+{
+    const auto path = dir / "mips.ktx2";
+    const auto getRed = [](std::uint32_t level, std::uint32_t) {
+        return static_cast<std::uint8_t>(255 - level * 50);
+    };
+    writeKTX2File(
+        path,
+        {
+            .vkFormat = VK_FORMAT_BC7_UNORM_BLOCK,
+            .width = 8,
+            .height = 8,
+            .numLevels = 4,
+            .getRed = getRed,
+        });
+
+    auto image = util::loadKTX2Image(path);
+    CHECK(image.format == wgpu::TextureFormat::BC7RGBAUnorm);
+    CHECK(image.width == 8 && image.height == 8 && image.numFaces == 1);
+    CHECK(image.levels.size() == 4);
+    if (image.levels.size() != 4) {
+        return;
+    }
+    // 2x2 blocks, then 1 block for each of the smaller levels
+    CHECK(image.levels[0].size == 64);
+    CHECK(image.levels[3].size == 16);
+    // levels are stored from the smallest one
+    CHECK(image.levels[3].offset == 80 + 4 * 24);
+    CHECK(image.levels[0].offset == 80 + 4 * 24 + 3 * 16);
+
+    CHECK(!util::needsTranscoding(image, true));
+    CHECK(util::needsTranscoding(image, false));
+
+    util::transcodeToRGBA8(image);
+    CHECK(image.format == wgpu::TextureFormat::RGBA8Unorm);
+    CHECK(image.levels.size() == 4);
+    CHECK(image.levels[0].size == 8 * 8 * 4);
+    CHECK(image.levels[1].size == 4 * 4 * 4);
+    CHECK(image.levels[3].size == 4);
+    CHECK(image.data.size() == (64 + 16 + 4 + 1) * 4);
+    for (std::size_t level = 0; level < image.levels.size(); ++level) {
+        const auto& l = image.levels[level];
+        const auto expectedRed = getRed(static_cast<std::uint32_t>(level), 0);
+        bool allTexelsMatch = true;
+        for (std::size_t offset = l.offset; offset < l.offset + l.size; offset += 4) {
+            allTexelsMatch = allTexelsMatch && getByte(image, offset) == expectedRed &&
+                             getByte(image, offset + 1) == 1 && getByte(image, offset + 3) == 255;
+        }
+        CHECK(allTexelsMatch);
+    }
+}
+
+void testUnalignedCubemap(const std::filesystem::path& dir)
+{
+    // 6x6 isn't a multiple of the block size, so it has to be transcoded even
+    // if BC formats are supported
+    const auto path = dir / "cubemap.ktx2";
+    const auto getRed = [](std::uint32_t, std::uint32_t face) {
+        return static_cast<std::uint8_t>(face * 40 + 1);
+    };
+    writeKTX2File(
+        path,
+        {
+            .vkFormat = VK_FORMAT_BC7_SRGB_BLOCK,
+            .width = 6,
+            .height = 6,
+            .numFaces = 6,
+            .numLevels = 3,
+            .getRed = getRed,
+        });
+
+    auto image = util::loadKTX2Image(path);
+    CHECK(image.format == wgpu::TextureFormat::BC7RGBAUnormSrgb);
+    CHECK(image.numFaces == 6);
+    CHECK(image.levels.size() == 3);
+    if (image.levels.size() != 3) {
+        return;
+    }
+    CHECK(image.levels[0].size == 4 * 16 * 6);
+    CHECK(util::needsTranscoding(image, true));
+
+    util::transcodeToRGBA8(image);
+    CHECK(image.format == wgpu::TextureFormat::RGBA8UnormSrgb);
+    CHECK(image.levels[0].size == 6 * 6 * 4 * 6);
+    CHECK(image.levels[1].size == 3 * 3 * 4 * 6);
+    CHECK(image.levels[2].size == 1 * 1 * 4 * 6);
+    // faces are stored one after another, the last texel of each face is
+    // decoded from a partially covered block
+    for (std::uint32_t face = 0; face < 6; ++face) {
+        const auto expectedRed = getRed(0, face);
+        const auto faceOffset = image.levels[0].offset + face * 6 * 6 * 4;
+        CHECK(getByte(image, faceOffset) == expectedRed);
+        CHECK(getByte(image, faceOffset + 35 * 4) == expectedRed);
+        CHECK(getByte(image, image.levels[2].offset + face * 4) == expectedRed);
+    }
+}
+
+void testInvalidFiles(const std::filesystem::path& dir)
+{
+    const auto getRed = [](std::uint32_t, std::uint32_t) { return std::uint8_t{1}; };
+
+    // 4x4 can have 3 levels (4x4, 2x2, 1x1), but not 4
+    const auto threeLevelsPath = dir / "three_levels.ktx2";
+    writeKTX2File(
+        threeLevelsPath,
+        {
+            .vkFormat = VK_FORMAT_BC7_UNORM_BLOCK,
+            .width = 4,
+            .height = 4,
+            .numLevels = 3,
+            .getRed = getRed,
+        });
+    CHECK(util::loadKTX2Image(threeLevelsPath).levels.size() == 3);
+
+    const auto tooManyLevelsPath = dir / "too_many_levels.ktx2";
+    writeKTX2File(
+        tooManyLevelsPath,
+        {
+            .vkFormat = VK_FORMAT_BC7_UNORM_BLOCK,
+            .width = 4,
+            .height = 4,
+            .numLevels = 4,
+            .getRed = getRed,
+        });
+    CHECK(util::loadKTX2Image(tooManyLevelsPath).format == wgpu::TextureFormat::Undefined);
+
+    const auto unsupportedFormatPath = dir / "unsupported_format.ktx2";
+    writeKTX2File(
+        unsupportedFormatPath,
+        {
+            .vkFormat = 147, // VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK
+            .width = 4,
+            .height = 4,
+            .getRed = getRed,
+        });
+    CHECK(util::loadKTX2Image(unsupportedFormatPath).format == wgpu::TextureFormat::Undefined);
+
+    // truncated level data
+    const auto truncatedPath = dir / "truncated.ktx2";
+    std::filesystem::copy_file(
+        threeLevelsPath, truncatedPath, std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(truncatedPath, std::filesystem::file_size(truncatedPath) - 1);
+    CHECK(util::loadKTX2Image(truncatedPath).format == wgpu::TextureFormat::Undefined);
+
+    CHECK(util::loadKTX2Image(dir / "missing.ktx2").format == wgpu::TextureFormat::Undefined);
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    const auto dir = std::filesystem::temp_directory_path() / "webgpu_test_ktx2";
+    std::filesystem::create_directories(dir);
+
+    testMipmapped2D(dir);
+    testUnalignedCubemap(dir);
+    testInvalidFiles(dir);
+
+    std::filesystem::remove_all(dir);
+    return test::testsFailed();
+}
@@ -0,0 +1,77 @@
+#include <util/RadixSort.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "TestUtil.h"
+
+namespace
+{
+// radix sort must give the same result as a stable comparison sort
+void checkSort(std::vector<util::SortKey> keys)
+{
+    auto expected = keys;
+    std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+        return a.key < b.key;
+    });
+
+    std::vector<util::SortKey> tmp;
+    util::radixSort(keys, tmp);
+
+    CHECK(keys.size() == expected.size());
+    bool same = true;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i].key != expected[i].key || keys[i].value != expected[i].value) {
+            same = false;
+            break;
+        }
+    }
+    CHECK(same);
+}
+
+std::vector<util::SortKey> makeRandomKeys(
+    std::mt19937_64& rng,
+    std::size_t count,
+    std::uint64_t keyMask)
+{
+    std::vector<util::SortKey> keys(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        keys[i] = util::SortKey{.key = rng() & keyMask, .value = static_cast<std::uint32_t>(i)};
+    }
+    return keys;
+}
+
+} // end of anonymous namespace
+
+int main()
+{
+    std::mt19937_64 rng(1234);
+
+    checkSort({});
+    checkSort(makeRandomKeys(rng, 1, ~std::uint64_t{0}));
+
+    for (const std::size_t count : {2, 100, 10'000, 100'000}) {
+        // all bytes differ
+        checkSort(makeRandomKeys(rng, count, ~std::uint64_t{0}));
+        // only low bytes are used (high passes are skipped)
+        checkSort(makeRandomKeys(rng, count, 0xFFFF));
+        // only some bytes in the middle and at the top are used, lots of
+        // equal keys (values must stay in the original order)
+        checkSort(makeRandomKeys(rng, count, 0xF000'0000'0F00'0000));
+        // all keys are equal
+        checkSort(makeRandomKeys(rng, count, 0));
+    }
+
+    { // tmp can be reused and can be bigger than keys
+        std::vector<util::SortKey> tmp(1000);
+        auto keys = makeRandomKeys(rng, 10, 0xFF);
+        util::radixSort(keys, tmp);
+        CHECK(std::is_sorted(keys.begin(), keys.end(), [](const auto& a, const auto& b) {
+            return a.key < b.key;
+        }));
+    }
+
+    return test::testsFailed();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <iostream>
+
+// Unlike assert, CHECK works in release builds and doesn't stop the test:
+// failed checks are printed and counted (CHECK can be used from any thread),
+// main returns the result of testsFailed()
+namespace test
+{
+inline std::atomic<int> numFailedChecks{0};
+
+inline void checkFailed(const char* expr, const char* file, int line)
+{
+    std::cout << file << ":" << line << ": CHECK(" << expr << ") failed" << std::endl;
+    ++numFailedChecks;
+}
+
+inline int testsFailed()
+{
+    if (numFailedChecks == 0) {
+        std::cout << "All checks passed" << std::endl;
+        return 0;
+    }
+    std::cout << numFailedChecks << " checks failed" << std::endl;
+    return 1;
+}
+
+} // end of namespace test
+
+#define CHECK(expr)                                       \
+    do {                                                  \
+        if (!(expr)) {                                    \
+            test::checkFailed(#expr, __FILE__, __LINE__); \
+        }                                                 \
+    } while (false)